@@ -0,0 +1,364 @@
+#include "common/logging.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/geometry.hpp"
+
+#include "GeometryTest/test_support.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace cg
+{
+
+namespace
+{
+
+// Threads used to build, so subtrees past PARALLEL_BUILD_THRESHOLD are built
+// in parallel even on a single core machine
+constexpr uint32_t TEST_BUILD_THREADS = 4;
+
+// Rays traced against each set of primitives
+constexpr uint32_t TEST_RAY_COUNT = 500;
+
+/**
+ * Primitives the hierarchy is built over: boxes, or spheres described to the
+ * hierarchy by their bounding boxes.
+ */
+struct TestPrimitives
+{
+    const char                 *name;
+    std::vector<AABB>           bounds;
+    std::vector<BoundingSphere> spheres; // Empty if the primitives are the boxes
+
+    void add_box(const Point3 &center, const Vector3 &half_size)
+    {
+        bounds.push_back(AABB(center - half_size, center + half_size));
+    }
+
+    void add_sphere(const Point3 &center, float radius)
+    {
+        spheres.push_back(BoundingSphere(center, radius));
+        add_box(center, Vector3(radius, radius, radius));
+    }
+
+    uint32_t size() const { return static_cast<uint32_t>(bounds.size()); }
+};
+
+// Distance along the ray to a primitive. Boxes use the slab test without the
+// padding of BVHRay, giving the entry distance (0 if the origin is inside).
+bool intersect_primitive(const TestPrimitives &primitives, uint32_t index, const Ray3 &ray, float &t)
+{
+    if(!primitives.spheres.empty())
+    {
+        RayObjectIntersectResult result = ray.intersect(primitives.spheres[index]);
+        t = result.distance;
+        return result.intersects;
+    }
+
+    Point3      p0 = primitives.bounds[index].min_pt();
+    Point3      p1 = primitives.bounds[index].max_pt();
+    const float bounds_min[3] = {p0.x, p0.y, p0.z};
+    const float bounds_max[3] = {p1.x, p1.y, p1.z};
+    const float origin[3] = {ray.o.x, ray.o.y, ray.o.z};
+    const float dir[3] = {ray.d.x, ray.d.y, ray.d.z};
+    float       t0 = 0.0f;
+    float       t1 = std::numeric_limits<float>::max();
+    for(uint32_t a = 0; a < 3; ++a)
+    {
+        float inv = 1.0f / dir[a];
+        float t_near = (bounds_min[a] - origin[a]) * inv;
+        float t_far = (bounds_max[a] - origin[a]) * inv;
+        if(inv < 0.0f) { std::swap(t_near, t_far); }
+        if(t_near > t0) t0 = t_near;
+        if(t_far < t1) t1 = t_far;
+    }
+    t = t0;
+    return t0 <= t1;
+}
+
+// Closest hit found by testing every primitive
+bool brute_force_closest(const TestPrimitives &primitives, const Ray3 &ray, float &t_min)
+{
+    bool hit = false;
+    t_min = std::numeric_limits<float>::max();
+    for(uint32_t i = 0; i < primitives.size(); ++i)
+    {
+        float t;
+        if(intersect_primitive(primitives, i, ray, t) && t < t_min)
+        {
+            t_min = t;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+// Closest hit found by traversing the hierarchy
+bool bvh_closest(const BVH &bvh, const TestPrimitives &primitives, const Ray3 &ray, float &t_min)
+{
+    bool hit = false;
+    t_min = std::numeric_limits<float>::max();
+    bvh.find_closest(ray, t_min, [&](uint32_t first, uint32_t count, float &t_max) {
+        for(uint32_t slot = first; slot < first + count; ++slot)
+        {
+            float t;
+            if(intersect_primitive(primitives, bvh.get_primitive_index(slot), ray, t) && t < t_max)
+            {
+                t_max = t;
+                hit = true;
+            }
+        }
+    });
+    return hit;
+}
+
+// Any hit closer than t_max found by traversing the hierarchy
+bool bvh_any_hit(const BVH &bvh, const TestPrimitives &primitives, const Ray3 &ray, float t_max)
+{
+    return bvh.any_hit(ray, t_max, [&](uint32_t first, uint32_t count) {
+        for(uint32_t slot = first; slot < first + count; ++slot)
+        {
+            float t;
+            if(intersect_primitive(primitives, bvh.get_primitive_index(slot), ray, t) && t < t_max)
+            {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+// Does box a contain box b
+bool contains(const float *a_min, const float *a_max, const Point3 &b_min, const Point3 &b_max)
+{
+    return a_min[0] <= b_min.x && a_min[1] <= b_min.y && a_min[2] <= b_min.z && a_max[0] >= b_max.x &&
+           a_max[1] >= b_max.y && a_max[2] >= b_max.z;
+}
+
+/**
+ * Check the structure of a hierarchy: every primitive is referenced by
+ * exactly one leaf slot, no leaf holds more than MAX_LEAF_PRIMITIVES and
+ * every node encloses its children (or its primitives).
+ */
+void check_structure(const BVH &bvh, const TestPrimitives &primitives, TestCounts &counts)
+{
+    const std::vector<BVHNode>  &nodes = bvh.get_nodes();
+    const std::vector<uint32_t> &indices = bvh.get_primitive_indices();
+    counts.check(indices.size() == primitives.size(), "primitive slot count", 0, 0);
+
+    std::vector<uint32_t> references(primitives.size(), 0);
+    for(uint32_t idx = 0; idx < nodes.size(); ++idx)
+    {
+        const BVHNode &node = nodes[idx];
+        if(node.is_leaf())
+        {
+            counts.check(node.primitive_count <= MAX_LEAF_PRIMITIVES, "leaf primitive count", idx, 0);
+            for(uint32_t slot = node.offset; slot < node.offset + node.primitive_count; ++slot)
+            {
+                uint32_t primitive = bvh.get_primitive_index(slot);
+                ++references[primitive];
+                const AABB &box = primitives.bounds[primitive];
+                counts.check(contains(node.bounds_min, node.bounds_max, box.min_pt(), box.max_pt()),
+                             "leaf encloses primitive",
+                             idx,
+                             slot);
+            }
+        }
+        else
+        {
+            for(uint32_t child : {idx + 1, node.offset})
+            {
+                const BVHNode &c = nodes[child];
+                counts.check(child > idx && child < nodes.size(), "child follows parent", idx, child);
+                counts.check(contains(node.bounds_min,
+                                      node.bounds_max,
+                                      Point3(c.bounds_min[0], c.bounds_min[1], c.bounds_min[2]),
+                                      Point3(c.bounds_max[0], c.bounds_max[1], c.bounds_max[2])),
+                             "node encloses child",
+                             idx,
+                             child);
+            }
+        }
+    }
+    for(uint32_t i = 0; i < primitives.size(); ++i)
+    {
+        counts.check(references[i] == 1, "primitive referenced once", i, 0);
+    }
+}
+
+/**
+ * Trace random rays (half aimed at a primitive) and compare the closest hit
+ * and any hit results of the hierarchy with testing every primitive.
+ */
+void check_queries(const BVH &bvh, const TestPrimitives &primitives, float extent, TestRandom &random,
+                   TestCounts &counts)
+{
+    for(uint32_t i = 0; i < TEST_RAY_COUNT; ++i)
+    {
+        Point3 origin = random.point(extent);
+        Ray3   ray(origin, random.direction());
+        if(i % 2 == 0)
+        {
+            uint32_t    aim = static_cast<uint32_t>(random.next(0.0f, 1.0f) * (primitives.size() - 1));
+            const AABB &box = primitives.bounds[aim];
+            Point3      p0 = box.min_pt();
+            Point3      p1 = box.max_pt();
+            Point3      target(random.next(p0.x, p1.x), random.next(p0.y, p1.y), random.next(p0.z, p1.z));
+            if(!(target == origin)) { ray = Ray3(origin, target, true); }
+        }
+
+        float expected_t, t;
+        bool  expected = brute_force_closest(primitives, ray, expected_t);
+        bool  hit = bvh_closest(bvh, primitives, ray, t);
+        counts.check(hit == expected, "closest hit", i, 0);
+        if(hit && expected)
+        {
+            ++counts.hits;
+            counts.check(same_bits(t, expected_t), "closest hit distance", i, 0);
+        }
+
+        // Any hit, with a limit both before and beyond the closest hit
+        float t_max = expected ? expected_t * random.next(0.5f, 1.5f) : std::numeric_limits<float>::max();
+        counts.check(bvh_any_hit(bvh, primitives, ray, t_max) == (expected && expected_t < t_max),
+                     "any hit",
+                     i,
+                     0);
+    }
+}
+
+/**
+ * Trace random rays and compare the closest hit and any hit results of a
+ * refit hierarchy with a hierarchy built over the same primitives.
+ */
+void check_refit_queries(const BVH &refit, const BVH &rebuilt, const TestPrimitives &primitives, float extent,
+                         TestRandom &random, TestCounts &counts)
+{
+    for(uint32_t i = 0; i < TEST_RAY_COUNT; ++i)
+    {
+        Ray3  ray(random.point(extent), random.direction());
+        float expected_t, t;
+        bool  expected = bvh_closest(rebuilt, primitives, ray, expected_t);
+        bool  hit = bvh_closest(refit, primitives, ray, t);
+        counts.check(hit == expected && (!hit || same_bits(t, expected_t)), "refit closest hit", i, 0);
+        if(hit && expected) { ++counts.hits; }
+
+        float t_max = expected ? expected_t * random.next(0.5f, 1.5f) : std::numeric_limits<float>::max();
+        counts.check(bvh_any_hit(refit, primitives, ray, t_max) == bvh_any_hit(rebuilt, primitives, ray, t_max),
+                     "refit any hit",
+                     i,
+                     0);
+    }
+}
+
+} // namespace
+
+void bvh_test()
+{
+    log_msg("BVH Tests (%u threads, parallel above %u primitives)", TEST_BUILD_THREADS, PARALLEL_BUILD_THRESHOLD);
+
+    TestRandom random;
+
+    // Scattered spheres, built on one thread
+    TestPrimitives spheres = {"Spheres"};
+    for(uint32_t i = 0; i < PARALLEL_BUILD_THRESHOLD / 4; ++i)
+    {
+        spheres.add_sphere(random.point(50.0f), random.next(0.2f, 2.0f));
+    }
+
+    // Scattered boxes, enough that subtrees are built in parallel
+    TestPrimitives boxes = {"Boxes"};
+    for(uint32_t i = 0; i < PARALLEL_BUILD_THRESHOLD * 3; ++i)
+    {
+        boxes.add_box(random.point(100.0f),
+                      Vector3(random.next(0.1f, 3.0f), random.next(0.1f, 3.0f), random.next(0.1f, 3.0f)));
+    }
+
+    // Identical boxes: the SAH finds no split, so leaves are capped at MAX_LEAF_PRIMITIVES
+    TestPrimitives stacked = {"Stacked boxes"};
+    for(uint32_t i = 0; i < 2000; ++i) { stacked.add_box(Point3(1.0f, 2.0f, 3.0f), Vector3(1.0f, 1.0f, 1.0f)); }
+
+    // Stacks of thin slabs along x, so wide in y and z that every node has
+    // the same rounded surface area. All SAH splits then tie, the first bin
+    // boundary is taken and each level peels off the stack with the lowest x
+    // (the gaps between stacks shrink geometrically). No stack fits in a leaf,
+    // so the tree reaches BVH_MAX_DEPTH and the depth limited median splits
+    // take over.
+    TestPrimitives chain = {"Stacked chain"};
+    for(uint32_t i = 0; i < 100; ++i)
+    {
+        float x = std::pow(0.9f, static_cast<float>(i));
+        for(uint32_t j = 0; j <= MAX_LEAF_PRIMITIVES; ++j)
+        {
+            chain.add_box(Point3(-x, 0.0f, 0.0f), Vector3(0.01f * x, 1.0e9f, 1.0e9f));
+        }
+    }
+
+    const struct
+    {
+        const TestPrimitives *primitives;
+        float                 extent; // Extent of the ray origins
+        bool                  reaches_depth_limit;
+    } tests[] = {{&spheres, 60.0f, false},
+                 {&boxes, 120.0f, false},
+                 {&stacked, 5.0f, false},
+                 {&chain, 50.0f, true}};
+
+    uint32_t total_mismatches = 0;
+    for(const auto &test : tests)
+    {
+        BVH bvh;
+        bvh.build(test.primitives->bounds, 4, TEST_BUILD_THREADS);
+        const BVHBuildStats &stats = bvh.get_build_stats();
+
+        TestCounts counts;
+        counts.check(stats.max_depth < BVH_MAX_DEPTH, "depth within BVH_MAX_DEPTH", stats.max_depth, 0);
+        counts.check(!test.reaches_depth_limit || stats.max_depth + 1 == BVH_MAX_DEPTH,
+                     "depth reaches BVH_MAX_DEPTH",
+                     stats.max_depth,
+                     0);
+        check_structure(bvh, *test.primitives, counts);
+        check_queries(bvh, *test.primitives, test.extent, random, counts);
+        log_msg("   %s: %u primitives, %u nodes, depth %u: %u comparisons, %u hits, %u mismatches",
+                test.primitives->name,
+                test.primitives->size(),
+                stats.node_count,
+                stats.max_depth,
+                counts.comparisons,
+                counts.hits,
+                counts.mismatches);
+        total_mismatches += counts.mismatches;
+    }
+
+    // Move every third box and refit: queries must match a hierarchy built
+    // over the moved boxes as well as brute force
+    TestPrimitives moved = boxes;
+    moved.name = "Refit boxes";
+    BVH refit;
+    refit.build(moved.bounds, 4, TEST_BUILD_THREADS);
+    for(uint32_t i = 0; i < moved.size(); i += 3)
+    {
+        Vector3 offset(random.next(-20.0f, 20.0f), random.next(-20.0f, 20.0f), random.next(-20.0f, 20.0f));
+        moved.bounds[i] = AABB(moved.bounds[i].min_pt() + offset, moved.bounds[i].max_pt() + offset);
+    }
+    refit.refit(moved.bounds);
+    BVH rebuilt;
+    rebuilt.build(moved.bounds, 4, TEST_BUILD_THREADS);
+
+    TestCounts counts;
+    check_structure(refit, moved, counts);
+    check_queries(refit, moved, 140.0f, random, counts);
+    check_refit_queries(refit, rebuilt, moved, 140.0f, random, counts);
+    log_msg("   %s: %u primitives, %u moved: %u comparisons, %u hits, %u mismatches",
+            moved.name,
+            moved.size(),
+            (moved.size() + 2) / 3,
+            counts.comparisons,
+            counts.hits,
+            counts.mismatches);
+    total_mismatches += counts.mismatches;
+
+    log_msg(total_mismatches == 0 ? "   BVH queries match brute force" : "   BVH queries DIFFER from brute force");
+}
+
+} // namespace cg
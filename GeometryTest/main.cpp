@@ -20,6 +20,8 @@ namespace cg
 void vector_test_module1();
 void matrix_test_module4();
 void vector_test_module5();
+void simd_intersect_test();
+void bvh_test();
 
 } // namespace cg
 
@@ -30,5 +32,7 @@ int main(int argc, char *argv[])
 {
     cg::init_logging("GeometryTest_Module5.log");
     cg::vector_test_module1();
+    cg::simd_intersect_test();
+    cg::bvh_test();
     return 1;
 }
@@ -0,0 +1,264 @@
+#include "common/logging.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/geometry.hpp"
+#include "geometry/ray_packet.hpp"
+#include "geometry/triangle_block.hpp"
+
+#include "GeometryTest/test_support.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace cg
+{
+
+namespace
+{
+
+// Rays aimed at a triangle (with jitter so some miss) from either side, so
+// front and back faces are both tested
+Ray3 ray_toward(TestRandom &random, const Point3 &v0, const Point3 &v1, const Point3 &v2)
+{
+    float  a = random.next(-0.2f, 1.0f);
+    float  b = random.next(-0.2f, 1.0f - a);
+    Point3 target(v0.x + a * (v1.x - v0.x) + b * (v2.x - v0.x),
+                  v0.y + a * (v1.y - v0.y) + b * (v2.y - v0.y),
+                  v0.z + a * (v1.z - v0.z) + b * (v2.z - v0.z));
+    Point3 origin = random.point(20.0f);
+    return Ray3(origin, Vector3(origin, target));
+}
+
+void test_packet_triangles(TestRandom &random, TestCounts &counts)
+{
+    for(uint32_t i = 0; i < 2000; ++i)
+    {
+        Point3 v0 = random.point(5.0f);
+        Point3 v1 = random.point(5.0f);
+        Point3 v2 = random.point(5.0f);
+
+        // Partial packets as well as full ones
+        uint32_t count = 1 + i % SIMD_WIDTH;
+        Ray3     rays[SIMD_WIDTH];
+        for(uint32_t lane = 0; lane < count; ++lane) { rays[lane] = ray_toward(random, v0, v1, v2); }
+        RayPacket packet(rays, count);
+
+        SimdFloat t, u, v;
+        uint32_t  hit = packet.intersect(v0, v1, v2, t, u, v).bits();
+        SimdFloat et, eu, ev;
+        uint32_t  edge_hit = packet.intersect(v0, Vector3(v0, v1), Vector3(v0, v2), et, eu, ev).bits();
+        counts.check(hit == edge_hit, "packet triangle (edges)", i, 0);
+        counts.check((hit >> count) == 0, "packet triangle (inactive lanes)", i, count);
+
+        for(uint32_t lane = 0; lane < count; ++lane)
+        {
+            RayTriangleIntersectResult expected = rays[lane].intersect(v0, v1, v2);
+            bool                       lane_hit = (hit >> lane) & 1;
+            counts.check(lane_hit == expected.intersects, "packet triangle hit", i, lane);
+            if(lane_hit && expected.intersects)
+            {
+                ++counts.hits;
+                counts.check(same_bits(cg::lane(t, lane), expected.distance) &&
+                                 same_bits(cg::lane(u, lane), expected.barycentric_u) &&
+                                 same_bits(cg::lane(v, lane), expected.barycentric_v),
+                             "packet triangle t/u/v",
+                             i,
+                             lane);
+                counts.check(same_bits(cg::lane(et, lane), expected.distance) &&
+                                 same_bits(cg::lane(eu, lane), expected.barycentric_u) &&
+                                 same_bits(cg::lane(ev, lane), expected.barycentric_v),
+                             "packet triangle (edges) t/u/v",
+                             i,
+                             lane);
+            }
+        }
+    }
+}
+
+void test_packet_spheres(TestRandom &random, TestCounts &counts)
+{
+    for(uint32_t i = 0; i < 2000; ++i)
+    {
+        BoundingSphere sphere(random.point(5.0f), random.next(0.5f, 4.0f));
+        uint32_t       count = 1 + i % SIMD_WIDTH;
+        Ray3           rays[SIMD_WIDTH];
+        for(uint32_t lane = 0; lane < count; ++lane)
+        {
+            // Some origins inside the sphere
+            Point3 origin = lane % 3 == 0 ? sphere.center : random.point(15.0f);
+            Point3 target = sphere.center + random.direction() * random.next(0.0f, 1.5f * sphere.radius);
+            rays[lane] = Ray3(origin, random.direction());
+            if(lane % 2 == 0 && !(origin == target)) { rays[lane] = Ray3(origin, Vector3(origin, target)); }
+        }
+        RayPacket packet(rays, count);
+
+        SimdFloat t;
+        uint32_t  hit = packet.intersect(sphere, t).bits();
+        counts.check((hit >> count) == 0, "packet sphere (inactive lanes)", i, count);
+        for(uint32_t lane = 0; lane < count; ++lane)
+        {
+            RayObjectIntersectResult expected = rays[lane].intersect(sphere);
+            bool                     lane_hit = (hit >> lane) & 1;
+            counts.check(lane_hit == expected.intersects, "packet sphere hit", i, lane);
+            if(lane_hit && expected.intersects)
+            {
+                ++counts.hits;
+                counts.check(same_bits(cg::lane(t, lane), expected.distance), "packet sphere t", i, lane);
+            }
+        }
+    }
+}
+
+void test_packet_boxes(TestRandom &random, TestCounts &counts)
+{
+    for(uint32_t i = 0; i < 2000; ++i)
+    {
+        BVHNode node = {};
+        Point3  p0 = random.point(5.0f);
+        Point3  p1 = random.point(5.0f);
+        node.bounds_min[0] = std::min(p0.x, p1.x);
+        node.bounds_min[1] = std::min(p0.y, p1.y);
+        node.bounds_min[2] = std::min(p0.z, p1.z);
+        node.bounds_max[0] = std::max(p0.x, p1.x);
+        node.bounds_max[1] = std::max(p0.y, p1.y);
+        node.bounds_max[2] = std::max(p0.z, p1.z);
+
+        uint32_t count = 1 + i % SIMD_WIDTH;
+        Ray3     rays[SIMD_WIDTH];
+        for(uint32_t lane = 0; lane < count; ++lane)
+        {
+            // Aim at a point in or near the box so that about half hit
+            Point3 target(random.next(node.bounds_min[0] - 1.0f, node.bounds_max[0] + 1.0f),
+                          random.next(node.bounds_min[1] - 1.0f, node.bounds_max[1] + 1.0f),
+                          random.next(node.bounds_min[2] - 1.0f, node.bounds_max[2] + 1.0f));
+            Point3  origin = random.point(15.0f);
+            Vector3 d(origin, target);
+            d.normalize();
+            if(lane % 2 == 1)
+            {
+                // Ray in the plane of a slab: zero direction component with the
+                // origin on the slab boundary gives 0 * inf = NaN
+                uint32_t axis = (i + lane) % 3;
+                float   *o = axis == 0 ? &origin.x : (axis == 1 ? &origin.y : &origin.z);
+                float   *c = axis == 0 ? &d.x : (axis == 1 ? &d.y : &d.z);
+                *o = lane % 4 == 1 ? node.bounds_min[axis] : node.bounds_max[axis];
+                *c = 0.0f;
+                d.normalize();
+            }
+            rays[lane] = Ray3(origin, d);
+        }
+        RayPacket packet(rays, count);
+
+        float    t_max = random.next(1.0f, 40.0f);
+        uint32_t hit = packet.intersect_box(node.bounds_min, node.bounds_max, SimdFloat(t_max)).bits();
+        counts.check((hit >> count) == 0, "packet box (inactive lanes)", i, count);
+        for(uint32_t lane = 0; lane < count; ++lane)
+        {
+            bool expected = BVHRay(rays[lane]).intersect(node, t_max);
+            counts.hits += expected ? 1 : 0;
+            counts.check(((hit >> lane) & 1) == (expected ? 1u : 0u), "packet box hit", i, lane);
+        }
+    }
+}
+
+void test_triangle_blocks(TestRandom &random, TestCounts &counts)
+{
+    for(uint32_t i = 0; i < 2000; ++i)
+    {
+        // Partly filled blocks leave padded slots
+        uint32_t            count = 1 + i % TRIANGLE_BLOCK_SIZE;
+        TriangleBlock       block;
+        std::vector<Point3> vertices;
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            Point3 center = random.point(3.0f);
+            Point3 v0 = center + random.direction() * 2.0f;
+            Point3 v1 = center + random.direction() * 2.0f;
+            Point3 v2 = center + random.direction() * 2.0f;
+            block.add(v0, v1, v2, 100 + slot);
+            vertices.push_back(v0);
+            vertices.push_back(v1);
+            vertices.push_back(v2);
+        }
+
+        uint32_t aim = 3 * (i % count);
+        Ray3     ray = ray_toward(random, vertices[aim], vertices[aim + 1], vertices[aim + 2]);
+        float    t_min = i % 4 == 0 ? random.next(1.0f, 30.0f) : std::numeric_limits<float>::max();
+
+        // Sequential search of the slots with the scalar test
+        RayMeshIntersectResult expected = {false, t_min, 0.0f, 0.0f, 0};
+        for(uint32_t slot = 0; slot < count; ++slot)
+        {
+            RayTriangleIntersectResult r =
+                ray.intersect(vertices[3 * slot], vertices[3 * slot + 1], vertices[3 * slot + 2]);
+            if(r.intersects && r.distance > EPSILON && r.distance < expected.distance)
+            {
+                expected = {true, r.distance, r.barycentric_u, r.barycentric_v, 100 + slot};
+            }
+        }
+
+        RayMeshIntersectResult result = ray.intersect(block, t_min);
+        counts.check(result.intersects == expected.intersects, "block hit", i, 0);
+        counts.check(ray.does_intersect_exist(block, t_min) == expected.intersects, "block any hit", i, 0);
+        if(result.intersects && expected.intersects)
+        {
+            ++counts.hits;
+            counts.check(same_bits(result.distance, expected.distance) &&
+                             same_bits(result.barycentric_u, expected.barycentric_u) &&
+                             same_bits(result.barycentric_v, expected.barycentric_v) &&
+                             result.face_index == expected.face_index,
+                         "block t/u/v/face",
+                         i,
+                         0);
+        }
+    }
+
+    // A ray meeting the back of a triangle misses it in every test
+    TriangleBlock block;
+    Point3        v0(0.0f, 0.0f, 0.0f), v1(1.0f, 0.0f, 0.0f), v2(0.0f, 1.0f, 0.0f);
+    block.add(v0, v1, v2, 0);
+    Ray3 front(Point3(0.25f, 0.25f, 1.0f), Vector3(0.0f, 0.0f, -1.0f));
+    Ray3 back(Point3(0.25f, 0.25f, -1.0f), Vector3(0.0f, 0.0f, 1.0f));
+    counts.check(front.intersect(v0, v1, v2).intersects, "front face (scalar)", 0, 0);
+    counts.check(front.intersect(block, 10.0f).intersects, "front face (block)", 0, 0);
+    counts.check(!back.intersect(v0, v1, v2).intersects, "back face (scalar)", 0, 0);
+    counts.check(!back.intersect(block, 10.0f).intersects, "back face (block)", 0, 0);
+    Ray3      rays[2] = {front, back};
+    RayPacket packet(rays, 2);
+    SimdFloat t, u, v;
+    counts.check(packet.intersect(v0, v1, v2, t, u, v).bits() == 1u, "front and back face (packet)", 0, 0);
+}
+
+} // namespace
+
+void simd_intersect_test()
+{
+    log_msg("SIMD Intersection Tests (%u lanes)", SIMD_WIDTH);
+
+    TestRandom random;
+    const struct
+    {
+        const char *name;
+        void (*run)(TestRandom &, TestCounts &);
+    } tests[] = {{"Packet triangles", test_packet_triangles},
+                 {"Packet spheres", test_packet_spheres},
+                 {"Packet boxes", test_packet_boxes},
+                 {"Triangle blocks", test_triangle_blocks}};
+
+    uint32_t total_mismatches = 0;
+    for(const auto &test : tests)
+    {
+        TestCounts counts;
+        test.run(random, counts);
+        log_msg("   %s: %u comparisons, %u hits, %u mismatches",
+                test.name,
+                counts.comparisons,
+                counts.hits,
+                counts.mismatches);
+        total_mismatches += counts.mismatches;
+    }
+    log_msg(total_mismatches == 0 ? "   SIMD results match the scalar tests"
+                                  : "   SIMD results DIFFER from the scalar tests");
+}
+
+} // namespace cg
@@ -0,0 +1,68 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    test_support.hpp
+//	Purpose: Random inputs and mismatch counting shared by the GeometryTest
+//           modules that compare optimized code against reference code.
+//============================================================================
+
+#ifndef __GEOMETRY_TEST_SUPPORT_HPP__
+#define __GEOMETRY_TEST_SUPPORT_HPP__
+
+#include "common/logging.hpp"
+#include "geometry/geometry.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace cg
+{
+
+// Deterministic pseudo random values so every run tests the same cases
+struct TestRandom
+{
+    uint32_t state = 12345u;
+
+    float next(float lo, float hi)
+    {
+        state = state * 1664525u + 1013904223u;
+        return lo + (hi - lo) * static_cast<float>(state >> 8) / static_cast<float>(1u << 24);
+    }
+
+    Point3 point(float extent)
+    {
+        return Point3(next(-extent, extent), next(-extent, extent), next(-extent, extent));
+    }
+
+    Vector3 direction()
+    {
+        Vector3 d(next(-1.0f, 1.0f), next(-1.0f, 1.0f), next(-1.0f, 1.0f));
+        d.normalize();
+        return d;
+    }
+};
+
+// Results must match to the bit, not just within a tolerance
+inline bool same_bits(float a, float b) { return std::memcmp(&a, &b, sizeof(float)) == 0; }
+
+struct TestCounts
+{
+    uint32_t comparisons = 0;
+    uint32_t hits = 0;
+    uint32_t mismatches = 0;
+
+    void check(bool ok, const char *test, uint32_t index, uint32_t lane)
+    {
+        ++comparisons;
+        if(!ok)
+        {
+            ++mismatches;
+            log_msg("   MISMATCH: %s case %u lane %u", test, index, lane);
+        }
+    }
+};
+
+} // namespace cg
+
+#endif
@@ -159,6 +159,9 @@ std::shared_ptr<cg::MaterialSelector>              g_mat_select;
 std::vector<std::shared_ptr<cg::SceneNode>> g_geo_list(19);
 std::shared_ptr<cg::NodeSelector>           g_geo_select;
 
+// Loads textures and models in the background while the scene is shown
+std::unique_ptr<cg::AssetLoader> g_asset_loader;
+
 // Sleep function to help run a reasonable timer
 void sleep(int32_t milliseconds)
 {
@@ -340,8 +343,12 @@ void build_materials()
     earth_texture->set_material_diffuse(cg::Color4(0.5f, 0.5f, 0.5f));
     earth_texture->set_material_specular(cg::Color4(0.6f, 0.6f, 0.6f));
     earth_texture->set_material_shininess(50);
-    earth_texture->set_texture(
-        "earthp2.jpg", GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    g_asset_loader->load_texture(earth_texture,
+                                 "earthp2.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
     g_mat_list[e_val(MatType::EARTH_TEXTURE)] = earth_texture;
 
     // Material 10 ('-'): coke texture
@@ -350,8 +357,12 @@ void build_materials()
     coke_texture->set_material_diffuse(cg::Color4(0.5f, 0.5f, 0.5f));
     coke_texture->set_material_specular(cg::Color4(0.6f, 0.6f, 0.6f));
     coke_texture->set_material_shininess(50);
-    coke_texture->set_texture(
-        "cokecan.jpg", GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    g_asset_loader->load_texture(coke_texture,
+                                 "cokecan.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
     g_mat_list[e_val(MatType::COKE_TEXTURE)] = coke_texture;
 
     // Material 11 ('-'): grainy wood texture
@@ -360,8 +371,12 @@ void build_materials()
     wood_texture->set_material_diffuse(cg::Color4(0.5f, 0.5f, 0.5f));
     wood_texture->set_material_specular(cg::Color4(0.6f, 0.6f, 0.6f));
     wood_texture->set_material_shininess(50);
-    wood_texture->set_texture(
-        "grainy_wood.jpg", GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    g_asset_loader->load_texture(wood_texture,
+                                 "grainy_wood.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
     g_mat_list[e_val(MatType::WOOD_TEXTURE)] = wood_texture;
 
     g_mat_select = std::make_shared<cg::MaterialSelector>(g_mat_list);
@@ -556,9 +571,9 @@ void build_geometry(int32_t position_loc, int32_t normal_loc, int32_t texture_lo
     trough_transform->add_child(trough);
     g_geo_list[e_val(ObjType::TROUGH)] = trough_transform;
 
-    // A10 Model
-    auto model_node_1 =
-        std::make_shared<cg::ModelNode>(position_loc, normal_loc, texture_loc, "A10/A10.3ds");
+    // A10 Model (shown once loaded)
+    auto model_node_1 = std::make_shared<cg::ModelNode>();
+    g_asset_loader->load_model(model_node_1, "A10/A10.3ds", position_loc, normal_loc, texture_loc);
     auto model_pres_1 = std::make_shared<cg::PresentationNode>();
     model_pres_1->set_material_ambient_and_diffuse(cg::Color4(1.0f, 1.0f, 1.0f));
     model_pres_1->set_material_specular(cg::Color4(0.2f, 0.2f, 0.2f));
@@ -569,9 +584,9 @@ void build_geometry(int32_t position_loc, int32_t normal_loc, int32_t texture_lo
     model_pres_1->add_child(model_transform_1);
     g_geo_list[e_val(ObjType::A10)] = model_pres_1;
 
-    // Bug Model
-    auto model_node_2 =
-        std::make_shared<cg::ModelNode>(position_loc, normal_loc, texture_loc, "bug/bug.3ds");
+    // Bug Model (shown once loaded)
+    auto model_node_2 = std::make_shared<cg::ModelNode>();
+    g_asset_loader->load_model(model_node_2, "bug/bug.3ds", position_loc, normal_loc, texture_loc);
     auto model_pres_2 = std::make_shared<cg::PresentationNode>();
     model_pres_2->set_material_ambient_and_diffuse(cg::Color4(1.0f, 1.0f, 1.0f));
     model_pres_2->set_material_specular(cg::Color4(0.2f, 0.2f, 0.2f));
@@ -637,6 +652,10 @@ void construct_scene()
     // Construct the object rotation TransformNode
     g_object_rotation = std::make_shared<cg::TransformNode>();
 
+    // Textures and models are decoded on worker threads and finished in the
+    // main loop. Until then materials show their colors and models nothing.
+    g_asset_loader = std::make_unique<cg::AssetLoader>();
+
     // Build the material list and initialize the material selector
     build_materials();
 
@@ -1079,6 +1098,18 @@ int main(int argc, char **argv)
 
         if(event_result & cg::EventType::EXIT) break;
 
+        // Finish any assets loaded since the last frame and redraw to show them
+        if(g_asset_loader && g_asset_loader->update() > 0)
+        {
+            if(g_asset_loader->get_pending_count() == 0)
+            {
+                // Log the textures loaded and the memory they use
+                cg::log_texture_cache_report();
+                g_asset_loader.reset();
+            }
+            display();
+        }
+
         if(g_animate_camera || g_animate_light)
         {
             animate_view();
@@ -1089,6 +1120,9 @@ int main(int argc, char **argv)
         sleep(DRAW_INTERVAL_MILLIS);
     }
 
+    // Stop loading before the GL context is destroyed
+    g_asset_loader.reset();
+
     // Destroy OpenGL Context, SDL Window and SDL
     SDL_GL_DestroyContext(g_gl_context);
     SDL_DestroyWindow(g_sdl_window);
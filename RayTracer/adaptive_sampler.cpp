@@ -0,0 +1,188 @@
+#include "RayTracer/adaptive_sampler.hpp"
+
+#include "common/logging.hpp"
+
+#include <algorithm>
+
+namespace cg
+{
+
+namespace
+{
+
+// Deterministic jitter in [0, 1) so repeated renders of a scene match
+float jitter(int32_t x, int32_t y, uint32_t sample, uint32_t axis)
+{
+    uint32_t h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^
+                 sample * 83492791u ^ axis * 2654435761u;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+
+} // namespace
+
+AdaptiveSampler::AdaptiveSampler(float contrast, uint32_t max_level)
+    : contrast_(contrast), max_level_(max_level), width_(0), edge_pixels_(0), samples_(0)
+{
+}
+
+void AdaptiveSampler::begin(const PixelBuffer &buffer)
+{
+    width_ = buffer.get_width();
+    size_t count = static_cast<size_t>(buffer.get_width()) * buffer.get_height();
+    colors_.resize(count);
+    refined_.assign(count, 0);
+    edge_pixels_ = 0;
+    samples_ = 0;
+}
+
+void AdaptiveSampler::refine_tile(const Tile        &tile,
+                                  const PixelBuffer &buffer,
+                                  RayTracer         &ray_tracer,
+                                  const CameraNode  &camera,
+                                  int32_t            depth,
+                                  float              adaptive_threshold)
+{
+    if(max_level_ == 0) { return; }
+
+    int32_t  x1 = std::min(tile.x1, static_cast<int32_t>(buffer.get_width()));
+    int32_t  y1 = std::min(tile.y1, static_cast<int32_t>(buffer.get_height()));
+    uint64_t edge_pixels = 0;
+    uint64_t samples = 0;
+    for(int32_t y = tile.y0; y < y1; ++y)
+    {
+        for(int32_t x = tile.x0; x < x1; ++x)
+        {
+            if(!is_edge(buffer, x, y)) { continue; }
+
+            size_t idx = static_cast<size_t>(y) * width_ + x;
+            colors_[idx] =
+                sample_cell(ray_tracer, camera, depth, adaptive_threshold, x, y, 0.0f, 0.0f, 1.0f, 0, samples);
+            refined_[idx] = 1;
+            ++edge_pixels;
+        }
+    }
+
+    edge_pixels_ += edge_pixels;
+    samples_ += samples;
+}
+
+void AdaptiveSampler::resolve(PixelBuffer &buffer)
+{
+    if(max_level_ == 0) { return; }
+
+    int32_t height = static_cast<int32_t>(buffer.get_height());
+    for(int32_t y = 0; y < height; ++y)
+    {
+        for(int32_t x = 0; x < static_cast<int32_t>(width_); ++x)
+        {
+            size_t idx = static_cast<size_t>(y) * width_ + x;
+            if(refined_[idx] != 0) { buffer.set(x, y, colors_[idx], 1, buffer.get_id(x, y)); }
+        }
+    }
+
+    uint64_t pixels = static_cast<uint64_t>(width_) * buffer.get_height();
+    uint64_t edge_pixels = edge_pixels_;
+    uint64_t samples = samples_;
+    log_msg("Anti-aliasing: %llu of %llu pixels refined (%.1f%%), %llu samples (%.2f per refined pixel)",
+            static_cast<unsigned long long>(edge_pixels),
+            static_cast<unsigned long long>(pixels),
+            pixels > 0 ? 100.0 * edge_pixels / pixels : 0.0,
+            static_cast<unsigned long long>(samples),
+            edge_pixels > 0 ? static_cast<double>(samples) / edge_pixels : 0.0);
+}
+
+bool AdaptiveSampler::is_edge(const PixelBuffer &buffer, int32_t x, int32_t y) const
+{
+    const int32_t offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    const Color3 &color = buffer.get_color(x, y);
+    uint32_t      id = buffer.get_id(x, y);
+    for(const auto &offset : offsets)
+    {
+        int32_t nx = x + offset[0];
+        int32_t ny = y + offset[1];
+        if(nx < 0 || ny < 0 || nx >= static_cast<int32_t>(buffer.get_width()) ||
+           ny >= static_cast<int32_t>(buffer.get_height()))
+        {
+            continue;
+        }
+        if(buffer.get_id(nx, ny) != id || color_difference(buffer.get_color(nx, ny), color) > contrast_)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Color3 AdaptiveSampler::sample_cell(RayTracer        &ray_tracer,
+                                    const CameraNode &camera,
+                                    int32_t           depth,
+                                    float             adaptive_threshold,
+                                    int32_t           x,
+                                    int32_t           y,
+                                    float             cx,
+                                    float             cy,
+                                    float             size,
+                                    uint32_t          level,
+                                    uint64_t         &samples) const
+{
+    // One jittered sample in each quarter of the cell, traced as a packet.
+    // The camera adds 0.5 to sample pixel centers so subtract it here.
+    float    half = 0.5f * size;
+    float    sub_x[4];
+    float    sub_y[4];
+    Ray3     rays[4];
+    Color3   colors[4];
+    uint32_t ids[4];
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        sub_x[i] = cx + (i & 1) * half;
+        sub_y[i] = cy + (i >> 1) * half;
+
+        // Distinct jitter for each cell of each level
+        uint32_t sample = (level << 24) ^ (static_cast<uint32_t>(sub_x[i] * 256.0f) << 12) ^
+                          (static_cast<uint32_t>(sub_y[i] * 256.0f) << 2) ^ i;
+        float sx = sub_x[i] + jitter(x, y, sample, 0) * half;
+        float sy = sub_y[i] + jitter(x, y, sample, 1) * half;
+        rays[i] = camera.construct_ray(x + sx - 0.5f, y + sy - 0.5f);
+    }
+    RayPacket packet(rays, 4);
+    ray_tracer.trace_packet(packet, depth, adaptive_threshold, colors, ids);
+    samples += 4;
+
+    Color3 mean = (colors[0] + colors[1] + colors[2] + colors[3]) * 0.25f;
+    if(level + 1 >= max_level_) { return mean; }
+
+    // Subdivide quarters that see a different object than another quarter or
+    // whose color is far from the mean. The mean of a subdivided quarter's
+    // samples replaces its own sample.
+    Color3 sum;
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        bool refine = color_difference(colors[i], mean) > contrast_;
+        for(uint32_t j = 0; j < 4 && !refine; ++j) { refine = ids[j] != ids[i]; }
+
+        if(refine)
+        {
+            sum += sample_cell(ray_tracer,
+                               camera,
+                               depth,
+                               adaptive_threshold,
+                               x,
+                               y,
+                               sub_x[i],
+                               sub_y[i],
+                               half,
+                               level + 1,
+                               samples);
+        }
+        else { sum += colors[i]; }
+    }
+    return sum * 0.25f;
+}
+
+} // namespace cg
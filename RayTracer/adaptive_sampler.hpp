@@ -0,0 +1,124 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    adaptive_sampler.hpp
+//	Purpose: Adaptive supersampling anti-aliasing. Pixels whose color or
+//           object id differs from a neighbour are resampled with stratified
+//           sub-pixel rays, refined recursively where the samples disagree.
+//============================================================================
+
+#ifndef __RAY_TRACER_ADAPTIVE_SAMPLER_HPP__
+#define __RAY_TRACER_ADAPTIVE_SAMPLER_HPP__
+
+#include "RayTracer/pixel_buffer.hpp"
+#include "RayTracer/ray_tracer.hpp"
+#include "RayTracer/tile_scheduler.hpp"
+#include "scene/camera_node.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace cg
+{
+
+// Default color difference (per channel, 0 to 1) that marks an edge
+constexpr float DEFAULT_AA_CONTRAST = 0.1f;
+
+// Default subdivision levels. Each level traces 4 samples in a cell and
+// splits the quarters that disagree 2x2, so 2 levels trace at most 4 + 16 = 20
+// samples per edge pixel besides its first ray.
+constexpr uint32_t DEFAULT_AA_LEVELS = 2;
+
+/**
+ * Adaptive supersampler. Runs after every pixel of a PixelBuffer has been
+ * traced with one ray: begin(), then refine_tile() for each tile (tiles may
+ * be refined concurrently), then resolve() to write the refined pixels back.
+ * Only the pixels of the buffer as traced are read while refining, so
+ * neighbouring tiles never see each other's refined colors.
+ */
+class AdaptiveSampler
+{
+  public:
+    /**
+     * Constructor.
+     * @param  contrast   Color difference (any channel) between neighbouring
+     *                    pixels or samples that requires more samples.
+     * @param  max_level  Maximum subdivision levels (0 disables anti-aliasing).
+     */
+    explicit AdaptiveSampler(float contrast = DEFAULT_AA_CONTRAST, uint32_t max_level = DEFAULT_AA_LEVELS);
+
+    /**
+     * Set the maximum subdivision levels.
+     * @param  max_level  Maximum subdivision levels (0 disables anti-aliasing).
+     */
+    void set_max_level(uint32_t max_level) { max_level_ = max_level; }
+
+    /**
+     * Get the maximum subdivision levels.
+     */
+    uint32_t get_max_level() const { return max_level_; }
+
+    /**
+     * Prepare to refine a buffer. Clears the refined pixels and the counts.
+     * @param  buffer  Buffer with every pixel traced.
+     */
+    void begin(const PixelBuffer &buffer);
+
+    /**
+     * Find the edge pixels within a tile and supersample them.
+     * @param  tile                Pixels to refine.
+     * @param  buffer              Buffer passed to begin.
+     * @param  ray_tracer          Ray tracer used to trace the samples.
+     * @param  camera              Camera the buffer was traced from.
+     * @param  depth               Maximum trace depth.
+     * @param  adaptive_threshold  Adaptive depth threshold.
+     */
+    void refine_tile(const Tile        &tile,
+                     const PixelBuffer &buffer,
+                     RayTracer         &ray_tracer,
+                     const CameraNode  &camera,
+                     int32_t            depth,
+                     float              adaptive_threshold);
+
+    /**
+     * Replace the refined pixels of the buffer and log the sample counts.
+     * @param  buffer  Buffer passed to begin.
+     */
+    void resolve(PixelBuffer &buffer);
+
+  private:
+    float    contrast_;
+    uint32_t max_level_;
+    uint32_t width_;
+
+    // Refined color of each image pixel, valid where refined_ is set (one byte
+    // per pixel so threads refining neighbouring tiles never share a word)
+    std::vector<Color3>  colors_;
+    std::vector<uint8_t> refined_;
+
+    std::atomic<uint64_t> edge_pixels_;
+    std::atomic<uint64_t> samples_;
+
+    // Does the color or id of a pixel differ from a neighbour
+    bool is_edge(const PixelBuffer &buffer, int32_t x, int32_t y) const;
+
+    // Average color of a square cell of pixel (x, y) with lower left corner
+    // (cx, cy) relative to the pixel and the given size (in pixels)
+    Color3 sample_cell(RayTracer        &ray_tracer,
+                       const CameraNode &camera,
+                       int32_t           depth,
+                       float             adaptive_threshold,
+                       int32_t           x,
+                       int32_t           y,
+                       float             cx,
+                       float             cy,
+                       float             size,
+                       uint32_t          level,
+                       uint64_t         &samples) const;
+};
+
+} // namespace cg
+
+#endif
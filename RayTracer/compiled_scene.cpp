@@ -0,0 +1,142 @@
+#include "RayTracer/compiled_scene.hpp"
+
+#include "RayTracer/texture_node.hpp"
+#include "common/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace cg
+{
+
+CompiledScene::CompiledScene() : compiled_(false), version_(0), transform_version_(0) {}
+
+void CompiledScene::compile(std::shared_ptr<SceneNode> scene_root)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Read the versions first so changes made while compiling force a recompile
+    version_ = SceneNode::get_graph_version();
+    transform_version_ = SceneNode::get_transform_version();
+    compiled_ = true;
+
+    primitives_.clear();
+    object_bounds_.clear();
+    bounds_.clear();
+    materials_.clear();
+    textures_.clear();
+    transforms_.clear();
+    transform_nodes_.clear();
+    transform_parents_.clear();
+
+    if(scene_root)
+    {
+        compile_node(scene_root.get(), COMPILED_NO_INDEX, COMPILED_NO_INDEX, COMPILED_NO_INDEX);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    log_msg("Compiled scene: %u primitives, %u materials, %u textures, %u transforms in %.3f ms",
+            static_cast<uint32_t>(primitives_.size()),
+            static_cast<uint32_t>(materials_.size()),
+            static_cast<uint32_t>(textures_.size()),
+            static_cast<uint32_t>(transforms_.size()),
+            elapsed.count());
+}
+
+void CompiledScene::update_transforms()
+{
+    transform_version_ = SceneNode::get_transform_version();
+
+    // Parents precede children so each parent is updated before it is used
+    for(uint32_t i = 0; i < transforms_.size(); ++i)
+    {
+        transforms_[i] = compose_transform(transform_nodes_[i], transform_parents_[i]);
+    }
+    for(uint32_t i = 0; i < primitives_.size(); ++i)
+    {
+        if(primitives_[i].transform != COMPILED_NO_INDEX)
+        {
+            bounds_[i] = get_world_bounds(object_bounds_[i], primitives_[i].transform);
+        }
+    }
+}
+
+void CompiledScene::compile_node(SceneNode *node, uint32_t material, uint32_t texture, uint32_t transform)
+{
+    // Materials, textures and transforms apply to all nodes below them
+    if(auto *m = dynamic_cast<MaterialNode *>(node)) { material = find_or_add(materials_, m); }
+    else if(dynamic_cast<TextureNode *>(node) != nullptr) { texture = find_or_add(textures_, node); }
+    else if(node->node_type() == SceneNodeType::TRANSFORM)
+    {
+        // Each path through a transform gets its own entry so shared
+        // sub-graphs are instanced
+        auto *transform_node = static_cast<TransformNode *>(node);
+        transforms_.push_back(compose_transform(transform_node, transform));
+        transform_nodes_.push_back(transform_node);
+        transform_parents_.push_back(transform);
+        transform = static_cast<uint32_t>(transforms_.size() - 1);
+    }
+
+    if(node->node_type() == SceneNodeType::GEOMETRY)
+    {
+        auto *geometry = static_cast<GeometryNode *>(node);
+        AABB  box = geometry->get_bounding_box();
+        if(!box.is_empty())
+        {
+            primitives_.push_back({geometry, material, texture, transform});
+            object_bounds_.push_back(box);
+            bounds_.push_back(get_world_bounds(box, transform));
+        }
+    }
+
+    for(auto &child : node->get_children()) { compile_node(child.get(), material, texture, transform); }
+}
+
+CompiledTransform CompiledScene::compose_transform(const TransformNode *node, uint32_t parent) const
+{
+    // Right-multiply as in TransformNode::draw. The inverse is composed from
+    // the inverses each transform node caches rather than inverting the
+    // world matrix.
+    Matrix4x4 world = node->get_matrix();
+    Matrix4x4 world_inverse = node->get_inverse_matrix();
+    if(parent != COMPILED_NO_INDEX)
+    {
+        world = transforms_[parent].matrix * world;
+        world_inverse *= transforms_[parent].inverse_matrix;
+    }
+    return {world, world_inverse, world_inverse.get_transpose()};
+}
+
+AABB CompiledScene::get_world_bounds(const AABB &box, uint32_t transform) const
+{
+    if(transform == COMPILED_NO_INDEX) { return box; }
+
+    // World bounds enclose the transformed corners of the object bounds.
+    // Accumulated directly since this runs for every object on each refit.
+    const Matrix4x4 &world = transforms_[transform].matrix;
+    Point3           p0 = box.min_pt();
+    Point3           p1 = box.max_pt();
+    Point3           world_min(world * p0);
+    Point3           world_max = world_min;
+    for(uint32_t c = 1; c < 8; ++c)
+    {
+        Point3 corner(world * Point3((c & 1) ? p1.x : p0.x, (c & 2) ? p1.y : p0.y, (c & 4) ? p1.z : p0.z));
+        if(corner.x < world_min.x) world_min.x = corner.x;
+        if(corner.y < world_min.y) world_min.y = corner.y;
+        if(corner.z < world_min.z) world_min.z = corner.z;
+        if(corner.x > world_max.x) world_max.x = corner.x;
+        if(corner.y > world_max.y) world_max.y = corner.y;
+        if(corner.z > world_max.z) world_max.z = corner.z;
+    }
+    return AABB(world_min, world_max);
+}
+
+template <typename T> uint32_t CompiledScene::find_or_add(std::vector<T *> &table, T *node)
+{
+    auto it = std::find(table.begin(), table.end(), node);
+    if(it != table.end()) { return static_cast<uint32_t>(it - table.begin()); }
+    table.push_back(node);
+    return static_cast<uint32_t>(table.size() - 1);
+}
+
+} // namespace cg
@@ -0,0 +1,168 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    compiled_scene.hpp
+//	Purpose: Flattened form of the scene graph used for ray tracing. Each
+//           geometry leaf becomes a primitive holding indices of its
+//           material, texture and baked world transform. Transforms can be
+//           updated in place when only transform nodes have changed.
+//============================================================================
+
+#ifndef __RAY_TRACER_COMPILED_SCENE_HPP__
+#define __RAY_TRACER_COMPILED_SCENE_HPP__
+
+#include "RayTracer/material_node.hpp"
+#include "geometry/aabb.hpp"
+#include "geometry/matrix.hpp"
+#include "scene/geometry_node.hpp"
+#include "scene/transform_node.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace cg
+{
+
+// Index used when a primitive has no material, texture or transform
+constexpr uint32_t COMPILED_NO_INDEX = 0xFFFFFFFF;
+
+/**
+ * World transform of a primitive, composed from all transform nodes above it.
+ */
+struct CompiledTransform
+{
+    Matrix4x4 matrix;         // Object to world
+    Matrix4x4 inverse_matrix; // World to object (transforms rays)
+    Matrix4x4 normal_matrix;  // Transpose of the inverse (object normals to world)
+};
+
+/**
+ * A geometry leaf of the scene graph with the state in effect where it was
+ * reached. Indices refer to the tables of the compiled scene.
+ */
+struct CompiledPrimitive
+{
+    GeometryNode *geometry;
+    uint32_t      material;  // Material index or COMPILED_NO_INDEX
+    uint32_t      texture;   // Texture index or COMPILED_NO_INDEX
+    uint32_t      transform; // Transform index or COMPILED_NO_INDEX (identity)
+};
+
+/**
+ * Scene graph compiled to flat arrays. Compiling resolves the material,
+ * texture and transform stacks once so rays never walk the graph.
+ */
+class CompiledScene
+{
+  public:
+    /**
+     * Constructor. Creates an empty scene.
+     */
+    CompiledScene();
+
+    /**
+     * Compile the scene graph below a root node. Records the graph version
+     * the result corresponds to.
+     * @param  scene_root  Root of the scene graph.
+     */
+    void compile(std::shared_ptr<SceneNode> scene_root);
+
+    /**
+     * Does the compiled scene match the current scene graph.
+     * @return Returns false if the graph or any transform has changed since
+     *         the last compile or transform update.
+     */
+    bool is_current() const
+    {
+        return is_structure_current() && transform_version_ == SceneNode::get_transform_version();
+    }
+
+    /**
+     * Does the compiled scene match the structure of the current scene graph.
+     * If so but the scene is not current, only transforms have changed and
+     * update_transforms brings it up to date.
+     * @return Returns false if nodes have been added or removed since the
+     *         last compile.
+     */
+    bool is_structure_current() const { return compiled_ && version_ == SceneNode::get_graph_version(); }
+
+    /**
+     * Recompute the world transforms and the world bounds of the primitives
+     * from the current transform nodes. Primitives, materials and textures
+     * are unchanged.
+     */
+    void update_transforms();
+
+    /**
+     * Get the primitives.
+     */
+    const std::vector<CompiledPrimitive> &get_primitives() const { return primitives_; }
+
+    /**
+     * Get the world space bounding box of each primitive.
+     */
+    const std::vector<AABB> &get_bounds() const { return bounds_; }
+
+    /**
+     * Get a material by index.
+     * @param  index  Material index (COMPILED_NO_INDEX for none).
+     * @return Returns the material node or nullptr.
+     */
+    MaterialNode *get_material(uint32_t index) const
+    {
+        return index == COMPILED_NO_INDEX ? nullptr : materials_[index];
+    }
+
+    /**
+     * Get a texture by index.
+     * @param  index  Texture index (COMPILED_NO_INDEX for none).
+     * @return Returns the texture node or nullptr.
+     */
+    SceneNode *get_texture(uint32_t index) const
+    {
+        return index == COMPILED_NO_INDEX ? nullptr : textures_[index];
+    }
+
+    /**
+     * Get a transform by index.
+     * @param  index  Transform index (COMPILED_NO_INDEX for identity).
+     * @return Returns the transform or nullptr for the identity.
+     */
+    const CompiledTransform *get_transform(uint32_t index) const
+    {
+        return index == COMPILED_NO_INDEX ? nullptr : &transforms_[index];
+    }
+
+  private:
+    bool                           compiled_;
+    uint32_t                       version_;
+    uint32_t                       transform_version_;
+    std::vector<CompiledPrimitive> primitives_;
+    std::vector<AABB>              object_bounds_; // Bounds of each primitive in object space
+    std::vector<AABB>              bounds_;
+    std::vector<MaterialNode *>    materials_;
+    std::vector<SceneNode *>       textures_;
+    std::vector<CompiledTransform> transforms_;
+
+    // Transform node and parent transform index of each transform. Parents
+    // always precede their children.
+    std::vector<TransformNode *> transform_nodes_;
+    std::vector<uint32_t>        transform_parents_;
+
+    // Walks the scene graph, tracking the current material, texture and transform
+    void compile_node(SceneNode *node, uint32_t material, uint32_t texture, uint32_t transform);
+
+    // Composes the world transform of a transform node with its parent's
+    CompiledTransform compose_transform(const TransformNode *node, uint32_t parent) const;
+
+    // World space bounds of a primitive
+    AABB get_world_bounds(const AABB &box, uint32_t transform) const;
+
+    // Finds (or adds) a node in a table
+    template <typename T> static uint32_t find_or_add(std::vector<T *> &table, T *node);
+};
+
+} // namespace cg
+
+#endif
@@ -0,0 +1,218 @@
+#include "RayTracer/demo_scene.hpp"
+
+#include "RayTracer/material_node.hpp"
+#include "RayTracer/rt_mesh_node.hpp"
+#include "RayTracer/rt_quad_node.hpp"
+#include "RayTracer/rt_sphere_node.hpp"
+#include "scene/transform_node.hpp"
+
+namespace cg
+{
+
+std::shared_ptr<SceneNode> construct_demo_scene(std::vector<LightNode *> &lights)
+{
+    // 605.767 - Student to define. Create a scene graph to describe your scene
+    auto scene_node = std::make_shared<SceneNode>();
+
+    // // Red sphere at origin
+    // auto material = std::make_shared<MaterialNode>();
+    // material->set_ambient_and_diffuse(Color4(0.8f, 0.2f, 0.2f, 1.0f));
+    // material->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    // material->set_shininess(64.0f);
+    // auto sphere = std::make_shared<RTSphereNode>(Point3(0.0f, 0.0f, 0.0f), 0.5f);
+    // material->add_child(std::static_pointer_cast<SceneNode>(sphere));
+    // scene_node->add_child(material);
+
+    // Add a floor using a very large sphere (appears nearly flat)
+    auto floor_material = std::make_shared<MaterialNode>();
+    floor_material->set_ambient_and_diffuse(Color4(0.4f, 0.4f, 0.5f, 1.0f));
+    floor_material->set_specular(Color4(0.3f, 0.3f, 0.3f, 1.0f));
+    floor_material->set_shininess(16.0f);
+
+    // Large sphere with center far below, surface at y = -1
+    // Radius 1000, center at (0, -1001, 0) puts the top of the sphere at y = -1
+    auto floor = std::make_shared<RTSphereNode>(Point3(0.0f, -1001.0f, 0.0f), 1000.0f);
+    floor_material->add_child(std::static_pointer_cast<SceneNode>(floor));
+    scene_node->add_child(floor_material);
+
+    // // Mirror ball (reflective)
+    auto mirror_material = std::make_shared<MaterialNode>();
+    mirror_material->set_ambient_and_diffuse(Color4(0.1f, 0.1f, 0.1f, 1.0f));
+    mirror_material->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    mirror_material->set_shininess(128.0f);
+    mirror_material->set_global_reflectivity(0.9f, 0.9f, 0.9f);
+    auto mirror_sphere = std::make_shared<RTSphereNode>(
+        Point3(-1.5f, 0.0f, 0.0f), 0.5f);
+    mirror_material->add_child(std::static_pointer_cast<SceneNode>(mirror_sphere));
+    scene_node->add_child(mirror_material);
+
+    // // Green sphere
+    // auto green_material = std::make_shared<MaterialNode>();
+    // green_material->set_ambient_and_diffuse(Color4(0.2f, 0.8f, 0.2f, 1.0f));
+    // green_material->set_specular(Color4(0.5f, 0.5f, 0.5f, 1.0f));
+    // green_material->set_shininess(32.0f);
+    // auto green_sphere = std::make_shared<RTSphereNode>(
+    //     Point3(1.5f, 0.0f, 3.0f), 0.4f);
+    // green_material->add_child(std::static_pointer_cast<SceneNode>(green_sphere));
+    // scene_node->add_child(green_material);
+
+    // // Glass ball (transparent/refractive)
+    // auto glass_material = std::make_shared<MaterialNode>();
+    // glass_material->set_ambient_and_diffuse(Color4(0.1f, 0.1f, 0.15f, 1.0f));
+    // glass_material->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    // glass_material->set_shininess(128.0f);
+    // glass_material->set_global_transmission(0.95f, 0.95f, 0.95f);
+    // glass_material->set_index_of_refraction(1.0f);
+    // auto glass_sphere = std::make_shared<RTSphereNode>(
+    //     Point3(1.2f, 0.0f, 0.0f), 0.5f);
+    // glass_material->add_child(std::static_pointer_cast<SceneNode>(glass_sphere));
+    // scene_node->add_child(glass_material);
+
+    // ========== PLANAR SURFACES (2 walls) ==========
+
+    // Back wall (blue-ish)
+    auto back_wall_material = std::make_shared<MaterialNode>();
+    back_wall_material->set_ambient_and_diffuse(Color4(0.3f, 0.3f, 0.6f, 1.0f));
+    back_wall_material->set_specular(Color4(0.2f, 0.2f, 0.2f, 1.0f));
+    back_wall_material->set_shininess(8.0f);
+
+    auto back_wall = std::make_shared<RTQuadNode>(
+        Point3(5.0f, -1.0f, 8.0f),    // bottom-right
+        Point3(-5.0f, -1.0f, 8.0f),   // bottom-left
+        Point3(-5.0f, 4.0f, 8.0f),    // top-left
+        Point3(5.0f, 4.0f, 8.0f));    // top-right (reversed for normal toward -Z)
+    back_wall_material->add_child(std::static_pointer_cast<SceneNode>(back_wall));
+    scene_node->add_child(back_wall_material);
+
+    // Left wall (tan/beige)
+    auto left_wall_material = std::make_shared<MaterialNode>();
+    left_wall_material->set_ambient_and_diffuse(Color4(0.6f, 0.5f, 0.4f, 1.0f));
+    left_wall_material->set_specular(Color4(0.2f, 0.2f, 0.2f, 1.0f));
+    left_wall_material->set_shininess(8.0f);
+
+    auto left_wall = std::make_shared<RTQuadNode>(
+        Point3(-5.0f, -1.0f, 8.0f),   // bottom-back
+        Point3(-5.0f, -1.0f, -2.0f),  // bottom-front
+        Point3(-5.0f, 4.0f, -2.0f),   // top-front
+        Point3(-5.0f, 4.0f, 8.0f));   // top-back (reversed for normal toward +X)
+    left_wall_material->add_child(std::static_pointer_cast<SceneNode>(left_wall));
+    scene_node->add_child(left_wall_material);
+
+    // ========== TRIANGLE MESH OBJECTS (3 meshes) ==========
+
+    // Pyramid built from one face mesh instanced four times. The face is
+    // defined relative to the center of the base; each instance moves it to
+    // the base center and turns it to face its own direction.
+    auto pyramid_face = std::make_shared<RTMeshNode>(
+        std::vector<Point3>{
+            Point3(0.5f, 0.0f, -0.5f),    // base front-right
+            Point3(-0.5f, 0.0f, -0.5f),   // base front-left
+            Point3(0.0f, 1.5f, 0.0f)},    // apex
+        std::vector<uint16_t>{0, 1, 2});
+
+    // Face color and rotation about Y: front (facing -Z) red, right (facing +X)
+    // green, back (facing +Z) blue, left (facing -X) yellow
+    struct PyramidFace
+    {
+        Color4 color;
+        float      angle;
+    };
+    const PyramidFace pyramid_faces[] = {{Color4(1.0f, 0.0f, 0.0f, 1.0f), 0.0f},
+                                         {Color4(0.0f, 1.0f, 0.0f, 1.0f), -90.0f},
+                                         {Color4(0.0f, 0.0f, 1.0f, 1.0f), 180.0f},
+                                         {Color4(1.0f, 1.0f, 0.0f, 1.0f), 90.0f}};
+    for(const PyramidFace &face : pyramid_faces)
+    {
+        auto face_mat = std::make_shared<MaterialNode>();
+        face_mat->set_ambient_and_diffuse(face.color);
+        face_mat->set_specular(Color4(0.3f, 0.3f, 0.3f, 1.0f));
+        face_mat->set_shininess(16.0f);
+        auto face_transform = std::make_shared<TransformNode>();
+        face_transform->translate(-2.5f, -1.0f, 2.5f);
+        face_transform->rotate_y(face.angle);
+        face_transform->add_child(pyramid_face);
+        face_mat->add_child(face_transform);
+        scene_node->add_child(face_mat);
+    }
+
+    // // Mesh 2: Simple box/cube (cyan) - reflective
+    // auto box_material = std::make_shared<MaterialNode>();
+    // box_material->set_ambient_and_diffuse(Color4(0.1f, 0.5f, 0.5f, 1.0f));
+    // box_material->set_specular(Color4(0.8f, 0.8f, 0.8f, 1.0f));
+    // box_material->set_shininess(64.0f);
+    // box_material->set_global_reflectivity(0.3f, 0.3f, 0.3f);
+    // float bx = 2.5f, by = -1.0f, bz = 4.0f;
+    // float bs = 0.8f;
+    // std::vector<Point3> box_verts = {
+    //     Point3(bx, by, bz),
+    //     Point3(bx + bs, by, bz),
+    //     Point3(bx + bs, by + bs, bz),
+    //     Point3(bx, by + bs, bz),
+    //     Point3(bx, by, bz + bs),
+    //     Point3(bx + bs, by, bz + bs),
+    //     Point3(bx + bs, by + bs, bz + bs),
+    //     Point3(bx, by + bs, bz + bs)
+    // };
+    // std::vector<uint16_t> box_faces = {
+    //     0, 1, 2,  0, 2, 3,
+    //     5, 4, 7,  5, 7, 6,
+    //     4, 0, 3,  4, 3, 7,
+    //     1, 5, 6,  1, 6, 2,
+    //     3, 2, 6,  3, 6, 7,
+    //     4, 5, 1,  4, 1, 0
+    // };
+    // auto box_mesh = std::make_shared<RTMeshNode>(box_verts, box_faces);
+    // box_material->add_child(std::static_pointer_cast<SceneNode>(box_mesh));
+    // scene_node->add_child(box_material);
+
+    // Mesh 3: Simple wedge/ramp (purple)
+    auto wedge_material = std::make_shared<MaterialNode>();
+    wedge_material->set_ambient_and_diffuse(Color4(0.6f, 0.2f, 0.6f, 1.0f));
+    wedge_material->set_specular(Color4(0.4f, 0.4f, 0.4f, 1.0f));
+    wedge_material->set_shininess(16.0f);
+
+    std::vector<Point3> wedge_verts = {
+        Point3(-4.0f, -1.0f, 5.0f),   // 0 front-left bottom
+        Point3(-3.0f, -1.0f, 5.0f),   // 1 front-right bottom
+        Point3(-3.0f, -1.0f, 7.0f),   // 2 back-right bottom
+        Point3(-4.0f, -1.0f, 7.0f),   // 3 back-left bottom
+        Point3(-4.0f, 0.0f, 7.0f),    // 4 back-left top
+        Point3(-3.0f, 0.0f, 7.0f)     // 5 back-right top
+    };
+    std::vector<uint16_t> wedge_faces = {
+        // Bottom (facing -Y, CCW from below)
+        0, 1, 2,  0, 2, 3,
+        // Back vertical face (facing +Z, CCW from back)
+        2, 5, 4,  2, 4, 3,
+        // Slope face (facing -Z/+Y, CCW from front-above)
+        1, 0, 4,  1, 4, 5,
+        // Left triangle (facing -X, CCW from left)
+        3, 4, 0,
+        // Right triangle (facing +X, CCW from right)
+        1, 5, 2
+    };
+    auto wedge_mesh = std::make_shared<RTMeshNode>(wedge_verts, wedge_faces);
+    wedge_material->add_child(std::static_pointer_cast<SceneNode>(wedge_mesh));
+    scene_node->add_child(wedge_material);
+
+    // Single strong directional light - positioned high and at an angle
+    // so each face of pyramid/wedge receives different illumination
+    auto light = std::make_shared<LightNode>(0);
+    light->set_position(HPoint3(4.0f, 6.0f, -1.0f, 1.0f));  // High, front-right
+    light->set_diffuse(Color4(1.2f, 1.2f, 1.1f, 1.0f));     // Strong white light (>1 for intensity)
+    light->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    light->enable();
+    scene_node->add_child(light);
+    lights.push_back(light.get());
+
+    return scene_node;
+}
+
+void set_demo_camera(CameraNode &camera)
+{
+    // Move camera much further back to see the sphere better
+    camera.set_position_and_look_at_pt(Point3(7.0f, 0.5f, -5.0f), Point3(0.0f, 0.0f, 0.0f));
+    camera.set_view_up(Vector3(0.0f, 1.0f, 0.0f)); // Y is up
+}
+
+} // namespace cg
@@ -0,0 +1,36 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    demo_scene.hpp
+//	Purpose: Scene rendered by the RayTracer application. Shared with the
+//           benchmark so both render the same scene.
+//============================================================================
+
+#ifndef __RAY_TRACER_DEMO_SCENE_HPP__
+#define __RAY_TRACER_DEMO_SCENE_HPP__
+
+#include "scene/scene.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace cg
+{
+
+/**
+ * Construct the demo scene graph.
+ * @param  lights  (OUT) Lights of the scene are appended (to add to the ray tracer).
+ * @return Returns the root of the scene graph.
+ */
+std::shared_ptr<SceneNode> construct_demo_scene(std::vector<LightNode *> &lights);
+
+/**
+ * Set the camera position and orientation used to view the demo scene.
+ * @param  camera  Camera to set.
+ */
+void set_demo_camera(CameraNode &camera);
+
+} // namespace cg
+
+#endif
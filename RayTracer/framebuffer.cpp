@@ -13,126 +13,76 @@
 #include "RayTracer/framebuffer.hpp"
 #include "RayTracer/shader_src.hpp"
 
-#include <cstring>
+#include <algorithm>
 #include <iostream>
 
 namespace cg
 {
 
-Framebuffer::Framebuffer() {}
+Framebuffer::Framebuffer() : PixelBuffer(0, 0) {}
 
-Framebuffer::Framebuffer(uint32_t w, uint32_t h)
+Framebuffer::Framebuffer(uint32_t w, uint32_t h) : PixelBuffer(w, h)
 {
-    // Round up width and height to BLOCK_SIZE increment
-    buffer_width_ = ((w / FB_BLOCK_SIZE) + 1) * FB_BLOCK_SIZE;
-    buffer_height_ = ((h / FB_BLOCK_SIZE) + 1) * FB_BLOCK_SIZE;
-
-    tex_width_ = w;
-    tex_height_ = h;
-
-    // Size the vectors
-    pixel_set_.resize(buffer_width_ * buffer_height_);
-
-    // Allocate pixel storage
-    pixels_ = new cColor3[buffer_width_ * buffer_height_];
-    tex_pixels_ = new cColor3[tex_width_ * tex_height_];
-
     if(!init_shader_texture_buffers()) { exit(-1); }
 }
 
-Framebuffer::~Framebuffer()
-{
-    delete[] pixels_;
-    delete[] tex_pixels_;
-}
-
-void Framebuffer::clear()
-{
-    // Clear all the set flags
-    for(auto s : pixel_set_) { s = false; }
-}
-
-void Framebuffer::set(int32_t x_LL, int32_t y_LL, Color3 &color, uint32_t block_size)
-{
-    // Mark this pixel as being set so it doesn't get calculated again
-    pixel_set_[get_pixel_index(x_LL, y_LL)] = true;
-
-    cColor3 c_color = {color.r_byte(), color.g_byte(), color.b_byte()};
-
-    // Set pixels within the "block"
-    for(uint32_t y = y_LL; y < y_LL + block_size; ++y)
-    {
-        // Get pointer to pixel at the left of the block for this row
-        cColor3 *p = pixels_ + (get_pixel_index(x_LL, y));
-        for(uint32_t x = x_LL; x < x_LL + block_size; ++x, ++p) { *p = c_color; }
-    }
-}
-
-bool Framebuffer::set(int32_t x, int32_t y) { return pixel_set_[get_pixel_index(x, y)]; }
+Framebuffer::~Framebuffer() {}
 
 void Framebuffer::render()
 {
-    for(uint32_t row = 0; row < tex_height_; ++row)
-    {
-        cColor3 *pixel_ptr = pixels_ + buffer_width_ * row;
-        cColor3 *tex_pixel_ptr = tex_pixels_ + tex_width_ * row;
-        std::memcpy(tex_pixel_ptr, pixel_ptr, tex_width_ * sizeof(cColor3));
-    }
-
     shader_program_.use();
 
     glUniform1i(texture_loc_, 0);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_id_);
-    glTexSubImage2D(
-        GL_TEXTURE_2D, 0, 0, 0, tex_width_, tex_height_, GL_RGB, GL_UNSIGNED_BYTE, tex_pixels_);
 
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-void Framebuffer::anti_alias()
-{
+    // Upload straight from the pixel rows (which are wider than the image).
+    // Each run of changed tiles along a tile row is one upload.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, buffer_width_);
+    for(uint32_t ty = 0; ty < tiles_y_; ++ty)
     {
-        int32_t r, g, b;
-        int32_t lo_idx, up_idx;
+        uint32_t y0 = ty * FB_TILE_SIZE;
+        if(y0 >= image_height_) { break; }
+        uint32_t rows = std::min(FB_TILE_SIZE, image_height_ - y0);
 
-        for(uint32_t x = 0; x < buffer_width_ - 1; x++)
+        uint32_t tx = 0;
+        while(tx < tiles_x_)
         {
-            for(uint32_t y = 0; y < buffer_height_ - 1; y++)
+            if(!take_dirty(tx, ty))
             {
-                // Get the total RGB for a 4 pixel square
-                lo_idx = get_pixel_index(x, y);
-                up_idx = get_pixel_index(x, y + 1);
-
-                cColor3       &p00 = pixels_[lo_idx];
-                const cColor3 &p10 = pixels_[lo_idx + 1];
-                const cColor3 &p01 = pixels_[up_idx];
-                const cColor3 &p11 = pixels_[up_idx + 1];
-
-                r = (static_cast<int32_t>(p00.r) + static_cast<int32_t>(p10.r) +
-                     static_cast<int32_t>(p01.r) + static_cast<int32_t>(p11.r));
-
-                g = (static_cast<int32_t>(p00.g) + static_cast<int32_t>(p10.g) +
-                     static_cast<int32_t>(p01.g) + static_cast<int32_t>(p11.g));
-
-                b = (static_cast<int32_t>(p00.b) + static_cast<int32_t>(p10.b) +
-                     static_cast<int32_t>(p01.b) + static_cast<int32_t>(p11.b));
+                ++tx;
+                continue;
+            }
+            uint32_t run_end = tx + 1;
+            while(run_end < tiles_x_ && take_dirty(run_end, ty)) { ++run_end; }
 
-                p00.r = static_cast<uint8_t>(std::min<int32_t>(std::max<int32_t>(r / 4, 0), 255));
-                p00.g = static_cast<uint8_t>(std::min<int32_t>(std::max<int32_t>(g / 4, 0), 255));
-                p00.b = static_cast<uint8_t>(std::min<int32_t>(std::max<int32_t>(b / 4, 0), 255));
+            uint32_t x0 = tx * FB_TILE_SIZE;
+            if(x0 < image_width_)
+            {
+                uint32_t columns = std::min(run_end * FB_TILE_SIZE, image_width_) - x0;
+                glTexSubImage2D(GL_TEXTURE_2D,
+                                0,
+                                x0,
+                                y0,
+                                columns,
+                                rows,
+                                GL_RGB,
+                                GL_UNSIGNED_BYTE,
+                                pixels_.data() + get_pixel_index(x0, y0));
             }
+            tx = run_end + 1;
         }
     }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    render();
-}
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
 
-int32_t Framebuffer::get_pixel_index(int32_t x, int32_t y) const { return y * buffer_width_ + x; }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
 bool Framebuffer::init_shader_texture_buffers()
 {
@@ -179,16 +129,16 @@ bool Framebuffer::init_shader_texture_buffers()
     glGenTextures(1, &texture_id_);
     glBindTexture(GL_TEXTURE_2D, texture_id_);
 
-    // Load image data and generate mipmaps
+    // Allocate texture storage. Tiles are uploaded as they are rendered.
     glTexImage2D(GL_TEXTURE_2D,
                  0,
                  GL_RGB,
-                 tex_width_,
-                 tex_height_,
+                 image_width_,
+                 image_height_,
                  0,
                  GL_RGB,
                  GL_UNSIGNED_BYTE,
-                 tex_pixels_);
+                 nullptr);
 
     // Set texture filters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -0,0 +1,31 @@
+#include "RayTracer/g_buffer.hpp"
+
+#include <algorithm>
+
+namespace cg
+{
+
+GBuffer::GBuffer(uint32_t w, uint32_t h) : width_(w)
+{
+    samples_.resize(static_cast<size_t>(w) * h);
+    valid_.resize(static_cast<size_t>(w) * h);
+}
+
+void GBuffer::invalidate() { std::fill(valid_.begin(), valid_.end(), 0); }
+
+void GBuffer::update_lights(const std::vector<LightNode *> &lights)
+{
+    uint32_t moved = 0;
+    for(uint32_t i = 0; i < lights.size() && i < GBUFFER_SHADOW_LIGHTS; ++i)
+    {
+        Point3 position = lights[i]->get_position();
+        if(i >= light_positions_.size() || !(light_positions_[i] == position)) { moved |= 1u << i; }
+    }
+    light_positions_.resize(lights.size());
+    for(uint32_t i = 0; i < lights.size(); ++i) { light_positions_[i] = lights[i]->get_position(); }
+
+    if(moved == 0) { return; }
+    for(GBufferSample &sample : samples_) { sample.shadow_known &= ~moved; }
+}
+
+} // namespace cg
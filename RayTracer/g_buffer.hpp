@@ -0,0 +1,107 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    g_buffer.hpp
+//	Purpose: Per pixel record of the primary hit of the last render. Lets
+//           the ray tracer re-shade a pixel after light or material changes
+//           without tracing its primary ray again.
+//============================================================================
+
+#ifndef __RAY_TRACER_G_BUFFER_HPP__
+#define __RAY_TRACER_G_BUFFER_HPP__
+
+#include "geometry/point2.hpp"
+#include "geometry/point3.hpp"
+#include "geometry/vector3.hpp"
+#include "scene/light_node.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace cg
+{
+
+// Lights whose shadow tests are cached (one bit each)
+constexpr uint32_t GBUFFER_SHADOW_LIGHTS = 32;
+
+/**
+ * Primary hit of one pixel.
+ */
+struct GBufferSample
+{
+    SceneNode *geometry_node; // Null if the ray hit nothing
+    SceneNode *material_node;
+    SceneNode *texture_node;
+    uint32_t   instance_index;
+    Point3     position;      // World space hit point
+    Vector3    normal;        // World space unit normal
+    Point2     texture_coord;
+    Vector3    direction;     // Primary ray direction
+    float      cone_width;    // Width of the primary ray cone at the hit
+    Color3     texture_color; // Filtered texture color (white if untextured)
+    uint32_t   shadow_known;  // Lights whose shadow test is cached
+    uint32_t   shadow_mask;   // Lights found to be occluded
+};
+
+/**
+ * G-buffer. Holds a sample for each pixel once traced. The samples stay valid
+ * while the camera and the scene geometry are unchanged; the owner must call
+ * invalidate() when either changes. Light positions are tracked here so moving
+ * a light only drops its cached shadow tests.
+ */
+class GBuffer
+{
+  public:
+    /**
+     * Constructor.
+     * @param  w  Image width in pixels.
+     * @param  h  Image height in pixels.
+     */
+    GBuffer(uint32_t w, uint32_t h);
+
+    /**
+     * Drop every sample.
+     */
+    void invalidate();
+
+    /**
+     * Drop the cached shadow tests of lights that have moved (or were added)
+     * since the last call. Call before re-shading.
+     * @param  lights  Lights of the ray tracer, in the order they were added.
+     */
+    void update_lights(const std::vector<LightNode *> &lights);
+
+    /**
+     * Get the sample of a pixel. Threads may write the samples of different
+     * pixels concurrently.
+     * @param  x  x pixel value
+     * @param  y  y pixel value
+     */
+    GBufferSample &get_sample(int32_t x, int32_t y) { return samples_[y * width_ + x]; }
+
+    /**
+     * Has the pixel's sample been recorded since the last invalidate.
+     * @param  x  x pixel value
+     * @param  y  y pixel value
+     */
+    bool is_valid(int32_t x, int32_t y) const { return valid_[y * width_ + x] != 0; }
+
+    /**
+     * Mark the pixel's sample as recorded.
+     * @param  x  x pixel value
+     * @param  y  y pixel value
+     */
+    void set_valid(int32_t x, int32_t y) { valid_[y * width_ + x] = 1; }
+
+  private:
+    uint32_t                   width_;
+    std::vector<GBufferSample> samples_;
+    // One byte per pixel so threads never write the same word
+    std::vector<uint8_t>       valid_;
+    std::vector<Point3>        light_positions_;
+};
+
+} // namespace cg
+
+#endif
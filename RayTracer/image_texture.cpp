@@ -1,45 +1,74 @@
 #include "RayTracer/image_texture.hpp"
 
+#include "scene/texture_cache.hpp"
+
+#include <algorithm>
 #include <cmath>
-#include <cstring>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 
 namespace cg
 {
 
+namespace
+{
+
+// Mip pyramids by resolved image path, held weakly so a pyramid is freed with
+// the last texture using it
+std::mutex                                                        pyramid_mutex;
+std::map<std::string, std::weak_ptr<const std::vector<MipLevel>>> pyramids;
+
+} // namespace
+
 ImageTexture::ImageTexture(const char *filename)
 {
-    ImageData im_data;
-    load_image_data(im_data, filename, false);
-    if(im_data.data == nullptr)
+    node_type_ = SceneNodeType::IMAGE_TEXTURE;
+
+    // The decoded image is shared with any other users of the file and only
+    // held until the mip pyramid is built
+    std::shared_ptr<const CachedImage> cached = acquire_image(filename);
+    if(!cached)
     {
         std::cout << "Error loading texture " << filename << '\n';
         return;
     }
 
-    // Get the image dimensions
-    width_ = im_data.w;
-    height_ = im_data.h;
-
-    // Crate pixel_map_ memory and copy image to pixel_map_
-    const size_t pixmap_size = width_ * height_ * im_data.channels;
-    pixel_map_ = new uint8_t[pixmap_size];
-    std::memcpy(pixel_map_, im_data.data, pixmap_size);
-
-    // Compute the difference between texels
-    s_diff_ = (1.0f / static_cast<float>(width_ - 1));
-    t_diff_ = (1.0f / static_cast<float>(height_ - 1));
+    // Textures of the same file share one pyramid
+    {
+        std::lock_guard<std::mutex> lock(pyramid_mutex);
+        levels_ = pyramids[cached->get_path()].lock();
+    }
+    if(levels_) { return; }
+
+    // Copy the image as RGB (gray images are replicated into each channel)
+    const ImageData     &im_data = cached->get_image();
+    const int32_t        channels = im_data.channels;
+    const size_t         texel_count = static_cast<size_t>(im_data.w) * im_data.h;
+    std::vector<uint8_t> image(texel_count * 3);
+    for(size_t i = 0; i < texel_count; ++i)
+    {
+        const uint8_t *src = im_data.data + i * channels;
+        for(int32_t c = 0; c < 3; ++c) { image[i * 3 + c] = src[channels >= 3 ? c : 0]; }
+    }
+    auto levels = std::make_shared<std::vector<MipLevel>>(build_levels(std::move(image), im_data.w, im_data.h));
 
-    // Number of bytes per row of the image
-    bytes_per_row_ = width_ * 3;
+    // Another texture of the file may have built its pyramid meanwhile
+    std::lock_guard<std::mutex> lock(pyramid_mutex);
+    levels_ = pyramids[cached->get_path()].lock();
+    if(!levels_)
+    {
+        // Drop the entries of pyramids that have been freed
+        remove_expired(pyramids);
+        levels_ = levels;
+        pyramids[cached->get_path()] = levels_;
+    }
 
     // May want to set OpenGL texture properites
-
-    node_type_ = SceneNodeType::IMAGE_TEXTURE;
 }
 
-ImageTexture::~ImageTexture() { delete[] pixel_map_; }
-
 void ImageTexture::draw(SceneState &scene_state)
 {
     // Draw children of this node
@@ -48,50 +77,128 @@ void ImageTexture::draw(SceneState &scene_state)
 
 Color3 ImageTexture::get_color(const Point3 &) { return Color3(0.0f, 0.0f, 0.0f); }
 
-Color3 ImageTexture::get_color(const TextureCoord2 &tex_coord)
+Color3 ImageTexture::get_color(const TextureCoord2 &tex_coord) { return get_color(tex_coord, 0.0f); }
+
+Color3 ImageTexture::get_color(const TextureCoord2 &tex_coord, float footprint)
 {
-    float s = tex_coord.s;
-    float t = tex_coord.t;
+    // A texture that failed to load leaves the surface color unchanged
+    if(!levels_) { return Color3(1.0f, 1.0f, 1.0f); }
+    const std::vector<MipLevel> &levels = *levels_;
+
+    // Clamping does not remove a NaN, which would then be converted to a
+    // texel index. Treat a non-finite coordinate like a missing texture.
+    if(!std::isfinite(tex_coord.s) || !std::isfinite(tex_coord.t)) { return Color3(1.0f, 1.0f, 1.0f); }
+
+    float s = std::min(std::max(tex_coord.s, 0.0f), 1.0f);
+    float t = std::min(std::max(tex_coord.t, 0.0f), 1.0f);
+
+    // Level of detail: level n texels are 2^n full resolution texels wide.
+    // Non-square images use the mean of their dimensions.
+    const MipLevel &base = levels.front();
+    float           lod = 0.0f;
+    if(footprint > 0.0f)
+    {
+        float texels = std::sqrt(static_cast<float>(base.width) * static_cast<float>(base.height));
+        lod = std::log2(footprint * texels);
+    }
+    if(!(lod > 0.0f)) { return sample_level(base, s, t); }
+
+    uint32_t last = static_cast<uint32_t>(levels.size()) - 1;
+    if(lod >= static_cast<float>(last)) { return sample_level(levels[last], s, t); }
 
+    uint32_t level = static_cast<uint32_t>(lod);
+    float    f = lod - static_cast<float>(level);
+    Color3   fine = sample_level(levels[level], s, t);
+    Color3   coarse = sample_level(levels[level + 1], s, t);
+    return Color3(fine.r + (coarse.r - fine.r) * f, fine.g + (coarse.g - fine.g) * f, fine.b + (coarse.b - fine.b) * f);
+}
+
+std::vector<MipLevel> ImageTexture::build_levels(std::vector<uint8_t> image, int32_t width, int32_t height)
+{
+    std::vector<MipLevel> levels;
+    while(true)
+    {
+        // Store the level a tile at a time. Tiles past the image edge are padded.
+        MipLevel level;
+        level.width = width;
+        level.height = height;
+        level.tiles_per_row = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        int32_t tile_rows = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        level.texels.assign(
+            static_cast<size_t>(level.tiles_per_row) * tile_rows * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE * 4, 0);
+        for(int32_t row = 0; row < height; ++row)
+        {
+            for(int32_t col = 0; col < width; ++col)
+            {
+                uint8_t       *dst = &level.texels[texel_offset(level, row, col)];
+                const uint8_t *src = &image[(static_cast<size_t>(row) * width + col) * 3];
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+        levels.push_back(std::move(level));
+        if(width == 1 && height == 1) { break; }
+
+        // Next level: average each 2 x 2 block (the last row or column of an
+        // odd sized level is repeated)
+        int32_t              next_width = std::max(width / 2, 1);
+        int32_t              next_height = std::max(height / 2, 1);
+        std::vector<uint8_t> next(static_cast<size_t>(next_width) * next_height * 3);
+        for(int32_t row = 0; row < next_height; ++row)
+        {
+            int32_t r0 = std::min(row * 2, height - 1);
+            int32_t r1 = std::min(row * 2 + 1, height - 1);
+            for(int32_t col = 0; col < next_width; ++col)
+            {
+                int32_t c0 = std::min(col * 2, width - 1);
+                int32_t c1 = std::min(col * 2 + 1, width - 1);
+                for(int32_t c = 0; c < 3; ++c)
+                {
+                    uint32_t sum = image[(static_cast<size_t>(r0) * width + c0) * 3 + c] +
+                                   image[(static_cast<size_t>(r0) * width + c1) * 3 + c] +
+                                   image[(static_cast<size_t>(r1) * width + c0) * 3 + c] +
+                                   image[(static_cast<size_t>(r1) * width + c1) * 3 + c];
+                    next[(static_cast<size_t>(row) * next_width + col) * 3 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        image = std::move(next);
+        width = next_width;
+        height = next_height;
+    }
+    return levels;
+}
+
+Color3 ImageTexture::sample_level(const MipLevel &level, float s, float t) const
+{
     // Get the row and column positions
-    int32_t r0 = static_cast<int32_t>((height_ - 1) * t);
-    int32_t r1 = std::min<int32_t>(r0 + 1, height_ - 1);
-    int32_t c0 = static_cast<int32_t>((width_ - 1) * s);
-    int32_t c1 = std::min<int32_t>(c0 + 1, width_ - 1);
+    float   x = s * static_cast<float>(level.width - 1);
+    float   y = t * static_cast<float>(level.height - 1);
+    int32_t c0 = static_cast<int32_t>(x);
+    int32_t c1 = std::min<int32_t>(c0 + 1, level.width - 1);
+    int32_t r0 = static_cast<int32_t>(y);
+    int32_t r1 = std::min<int32_t>(r0 + 1, level.height - 1);
 
     // Compute the weighting factors
-    float ds = s / s_diff_ - static_cast<float>(c0);
-    float dt = t / t_diff_ - static_cast<float>(r0);
+    float ds = x - static_cast<float>(c0);
+    float dt = y - static_cast<float>(r0);
     float w00 = (1.0f - ds) * (1.0f - dt);
     float w10 = (1.0f - ds) * dt;
     float w01 = ds * (1.0f - dt);
     float w11 = ds * dt;
 
-    // Get the 4 texel colors
-    uint8_t r00, r10, r01, r11;
-    uint8_t g00, g10, g01, g11;
-    uint8_t b00, b10, b01, b11;
-    get_texel(r0, c0, r00, g00, b00);
-    get_texel(r1, c0, r10, g10, b10);
-    get_texel(r0, c1, r01, g01, b01);
-    get_texel(r1, c1, r11, g11, b11);
-
-    // Calculate a linear, weighted average
-    uint8_t r = static_cast<uint8_t>(w00 * r00 + w01 * r01 + w10 * r10 + w11 * r11);
-    uint8_t g = static_cast<uint8_t>(w00 * g00 + w01 * g01 + w10 * g10 + w11 * g11);
-    uint8_t b = static_cast<uint8_t>(w00 * b00 + w01 * b01 + w10 * b10 + w11 * b11);
+    // Calculate a linear, weighted average of the 4 texel colors
+    const uint8_t *t00 = get_texel(level, r0, c0);
+    const uint8_t *t10 = get_texel(level, r1, c0);
+    const uint8_t *t01 = get_texel(level, r0, c1);
+    const uint8_t *t11 = get_texel(level, r1, c1);
+    float          r = w00 * t00[0] + w01 * t01[0] + w10 * t10[0] + w11 * t11[0];
+    float          g = w00 * t00[1] + w01 * t01[1] + w10 * t10[1] + w11 * t11[1];
+    float          b = w00 * t00[2] + w01 * t01[2] + w10 * t10[2] + w11 * t11[2];
 
     constexpr float COLOR_BYTE_SCALING = 1.0f / 255.0f;
     return Color3(r * COLOR_BYTE_SCALING, g * COLOR_BYTE_SCALING, b * COLOR_BYTE_SCALING);
 }
 
-void ImageTexture::get_texel(int32_t row, int32_t col, uint8_t &r, uint8_t &g, uint8_t &b)
-{
-    // Note - invert the y
-    uint8_t *texptr = pixel_map_ + (row * bytes_per_row_) + (col * 3);
-    r = *texptr++;
-    g = *texptr++;
-    b = *texptr;
-}
-
 } // namespace cg
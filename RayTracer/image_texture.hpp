@@ -16,11 +16,36 @@
 
 #include "scene/image_data.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 namespace cg
 {
 
+// Texels are stored in square tiles of this many texels on a side, so the
+// texels a filter reads are usually within one tile rather than spread over
+// rows of the image
+constexpr int32_t TEXTURE_TILE_SIZE = 8;
+
+/**
+ * One level of a texture's mip pyramid. Texels are 4 bytes (RGB and a pad
+ * byte) stored a tile at a time, tiles in row order.
+ */
+struct MipLevel
+{
+    int32_t              width;
+    int32_t              height;
+    int32_t              tiles_per_row;
+    std::vector<uint8_t> texels;
+};
+
 /**
- * Image texture for use in ray tracing
+ * Image texture for use in ray tracing. Builds a mip pyramid when loaded so
+ * lookups covering many texels read a coarser level instead. The image is
+ * decoded through the texture cache and textures of the same file share one
+ * pyramid.
  */
 class ImageTexture : public TextureNode
 {
@@ -31,10 +56,6 @@ class ImageTexture : public TextureNode
      */
     ImageTexture(const char *filename);
 
-    /**
-     * Destructor. Deletes the pixmap memory.
-     */
-    ~ImageTexture();
 
     /**
      * Draw. May want to set texture properties so we can draw using OpenGL.
@@ -48,24 +69,52 @@ class ImageTexture : public TextureNode
 
     /**
      * Get the color based given the texture coordinates. Uses linear filtering
-     * among the 4 nearest texels.
-     * NOTE: does not currently support wrap and will cause issues if texture coords
-     * are outside of [0-1] range.
+     * among the 4 nearest texels of the full resolution image. Texture
+     * coordinates are clamped to [0,1]; non-finite ones leave the surface
+     * color unchanged (white).
      * @param   tex_coord Texture coordinate (s,t)
      * @return  Returns the color from the texture lookup
      */
     Color3 get_color(const TextureCoord2 &tex_coord) override;
 
+    /**
+     * Get the color filtered over a footprint. Picks the two mip levels whose
+     * texels are nearest the footprint in size, filters each linearly and
+     * blends them (trilinear filtering).
+     * @param   tex_coord  Texture coordinate (s,t)
+     * @param   footprint  Width of the area seen, in texture coordinate units.
+     * @return  Returns the filtered color.
+     */
+    Color3 get_color(const TextureCoord2 &tex_coord, float footprint) override;
+
+    /**
+     * Get the number of mip levels (0 if the image failed to load).
+     */
+    uint32_t get_level_count() const { return levels_ ? static_cast<uint32_t>(levels_->size()) : 0; }
+
   protected:
-    uint8_t *pixel_map_;
-    int32_t  width_;
-    int32_t  height_;
-    float    s_diff_;
-    float    t_diff_;
-    int32_t  bytes_per_row_;
-
-    // Get a texel given the row and column
-    void get_texel(int32_t row, int32_t col, uint8_t &r, uint8_t &g, uint8_t &b);
+    // Full resolution first, down to 1 x 1. Shared by textures of the same file.
+    std::shared_ptr<const std::vector<MipLevel>> levels_;
+
+    // Build the mip pyramid from an RGB image in row order
+    static std::vector<MipLevel> build_levels(std::vector<uint8_t> image, int32_t width, int32_t height);
+
+    // Linear filtering among the 4 nearest texels of one level
+    Color3 sample_level(const MipLevel &level, float s, float t) const;
+
+    // Get the offset of a texel within its level given the row and column
+    static size_t texel_offset(const MipLevel &level, int32_t row, int32_t col)
+    {
+        size_t tile = static_cast<size_t>(row / TEXTURE_TILE_SIZE) * level.tiles_per_row + col / TEXTURE_TILE_SIZE;
+        size_t texel = (row % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE + col % TEXTURE_TILE_SIZE;
+        return (tile * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + texel) * 4;
+    }
+
+    // Get a texel (RGB) given the row and column
+    static const uint8_t *get_texel(const MipLevel &level, int32_t row, int32_t col)
+    {
+        return &level.texels[texel_offset(level, row, col)];
+    }
 };
 
 } // namespace cg
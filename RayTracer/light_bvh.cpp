@@ -0,0 +1,92 @@
+#include "RayTracer/light_bvh.hpp"
+
+#include <algorithm>
+
+namespace cg
+{
+
+namespace
+{
+
+// Farthest influence radius searched for. Lights reaching further are
+// treated as unbounded.
+constexpr float MAX_INFLUENCE_RADIUS = 1.0e6f;
+
+// Distance beyond which a light's attenuated intensity is below the cutoff,
+// or a negative value if there is none. Attenuation falls with distance so
+// the distance is found by bisection.
+float influence_radius(const LightNode &light)
+{
+    if(!light.is_attenuation_enabled()) { return -1.0f; }
+
+    const Color4 &diffuse = light.get_diffuse();
+    const Color4 &specular = light.get_specular();
+    float intensity = std::max({diffuse.r, diffuse.g, diffuse.b, specular.r, specular.g, specular.b});
+    if(intensity <= 0.0f) { return 0.0f; }
+
+    float far = 1.0f;
+    while(intensity * light.get_attenuation(far) >= LIGHT_INFLUENCE_CUTOFF)
+    {
+        far *= 2.0f;
+        if(far > MAX_INFLUENCE_RADIUS) { return -1.0f; }
+    }
+    float near = 0.0f;
+    for(uint32_t i = 0; i < 24; ++i)
+    {
+        float mid = 0.5f * (near + far);
+        if(intensity * light.get_attenuation(mid) >= LIGHT_INFLUENCE_CUTOFF) { near = mid; }
+        else { far = mid; }
+    }
+    return far;
+}
+
+} // namespace
+
+void LightBVH::build(const std::vector<LightNode *> &lights)
+{
+    unbounded_.clear();
+    bounded_.clear();
+    centers_.clear();
+    radius_squared_.clear();
+
+    std::vector<AABB> bounds;
+    for(uint32_t i = 0; i < lights.size(); ++i)
+    {
+        float radius = influence_radius(*lights[i]);
+        if(radius < 0.0f)
+        {
+            unbounded_.push_back(i);
+            continue;
+        }
+
+        Point3 center = lights[i]->get_position();
+        bounded_.push_back(i);
+        centers_.push_back(center);
+        radius_squared_.push_back(radius * radius);
+        bounds.emplace_back(Point3(center.x - radius, center.y - radius, center.z - radius),
+                            Point3(center.x + radius, center.y + radius, center.z + radius));
+    }
+
+    if(bounds.empty()) { bvh_.clear(); }
+    else { bvh_.build(bounds, 2, 1); }
+}
+
+void LightBVH::find_lights(const Point3 &point, std::vector<uint32_t> &indices) const
+{
+    indices.assign(unbounded_.begin(), unbounded_.end());
+    if(bounded_.empty()) { return; }
+
+    bvh_.find_containing(point, [&](uint32_t first, uint32_t count) {
+        for(uint32_t slot = first; slot < first + count; ++slot)
+        {
+            uint32_t primitive = bvh_.get_primitive_index(slot);
+            Vector3  to_light(point, centers_[primitive]);
+            if(to_light.norm_squared() <= radius_squared_[primitive]) { indices.push_back(bounded_[primitive]); }
+        }
+    });
+
+    // Lights are shaded in the order they were added
+    if(!unbounded_.empty() || indices.size() > 1) { std::sort(indices.begin(), indices.end()); }
+}
+
+} // namespace cg
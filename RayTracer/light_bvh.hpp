@@ -0,0 +1,65 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    light_bvh.hpp
+//	Purpose: Hierarchy over the region each light can illuminate, so shading
+//           only considers the lights that can reach a surface point.
+//============================================================================
+
+#ifndef __RAY_TRACER_LIGHT_BVH_HPP__
+#define __RAY_TRACER_LIGHT_BVH_HPP__
+
+#include "geometry/bvh.hpp"
+#include "scene/light_node.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace cg
+{
+
+// Attenuated intensity below which a light is treated as reaching nothing.
+// Diffuse and specular material colors are at most 1, so beyond this the
+// light changes an 8 bit color by well under one step.
+constexpr float LIGHT_INFLUENCE_CUTOFF = 1.0f / 1024.0f;
+
+/**
+ * Light hierarchy. Lights with distance attenuation are bounded by the sphere
+ * beyond which their attenuated intensity is below LIGHT_INFLUENCE_CUTOFF and
+ * are held in a BVH over those spheres. Lights without attenuation reach
+ * everywhere and are always returned.
+ */
+class LightBVH
+{
+  public:
+    /**
+     * Build the hierarchy. Call again when lights move or their color or
+     * attenuation changes.
+     * @param  lights  Lights, in the order they are indexed.
+     */
+    void build(const std::vector<LightNode *> &lights);
+
+    /**
+     * Find the lights that can reach a point.
+     * @param  point    Surface point.
+     * @param  indices  (OUT) Indices of the lights, in increasing order.
+     */
+    void find_lights(const Point3 &point, std::vector<uint32_t> &indices) const;
+
+    /**
+     * Get the number of lights bounded by the hierarchy.
+     */
+    uint32_t get_bounded_count() const { return static_cast<uint32_t>(centers_.size()); }
+
+  private:
+    BVH                   bvh_;
+    std::vector<uint32_t> unbounded_;      // Lights without attenuation
+    std::vector<uint32_t> bounded_;        // Light index of each primitive of the BVH
+    std::vector<Point3>   centers_;        // Position of each bounded light
+    std::vector<float>    radius_squared_; // Squared influence radius of each bounded light
+};
+
+} // namespace cg
+
+#endif
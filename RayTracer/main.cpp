@@ -16,16 +16,24 @@
 #include "scene/graphics.hpp"
 #include "scene/scene.hpp"
 
+#include "RayTracer/adaptive_sampler.hpp"
+#include "RayTracer/demo_scene.hpp"
 #include "RayTracer/framebuffer.hpp"
+#include "RayTracer/g_buffer.hpp"
 #include "RayTracer/lighting.hpp"
-#include "RayTracer/material_node.hpp"
+#include "RayTracer/pixel_buffer.hpp"
 #include "RayTracer/ray_tracer.hpp"
-#include "RayTracer/rt_sphere_node.hpp"
-#include "RayTracer/rt_quad_node.hpp"
-#include "RayTracer/rt_mesh_node.hpp"
+#include "RayTracer/tile_scheduler.hpp"
 
+#include <cerrno>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -53,318 +61,578 @@ std::shared_ptr<cg::CameraNode> g_camera;
 // Framebuffer
 std::unique_ptr<cg::Framebuffer> g_frame_buffer;
 
-// Maximum depth to trace and adaptive threshold.
+// Primary hits of the last frame, so light and material changes are re-shaded
+// without tracing primary rays. Null if disabled.
+std::unique_ptr<cg::GBuffer> g_gbuffer;
+bool                         g_use_gbuffer = true;
+
+// Trace each tile's rays breadth first, as one wavefront per recursion level,
+// rather than one packet of primary rays at a time. Disables the G-buffer.
+bool g_wavefront = false;
+
+// Maximum depth to trace and adaptive threshold. Reflected and refracted
+// rays whose throughput falls below the threshold are dropped, or with
+// Russian roulette traced at random.
 int32_t     g_max_depth = 15;
 const float DEPTH_THRESHOLD = 0.025f;
+bool        g_russian_roulette = false;
+
+// Lights sampled at each surface point when more than this many can reach it
+// (0 shades with all of them).
+uint32_t g_light_samples = 0;
+
+// Blocks up to this size whose corner samples agree (same object, colors
+// within UNIFORM_CONTRAST) are interpolated rather than subdivided. 0 traces
+// every pixel. Larger blocks save more rays but can miss small objects.
+uint32_t    g_max_uniform_block = 4;
+const float UNIFORM_CONTRAST = 0.05f;
 
 // Ray Tracer
 cg::RayTracer *g_ray_tracer = 0;
 
+// Persistent render workers. Tile size is a multiple of the largest pixel
+// block so each block is rendered by a single worker.
+std::unique_ptr<cg::TileScheduler> g_tile_scheduler;
+uint32_t                           g_num_threads = 0;
+
+// Adaptive anti-aliasing of the final pass
+cg::AdaptiveSampler g_adaptive_sampler;
+
+// Output image file. When set the scene is rendered once without a window.
+std::string g_output_file;
+
+// Rays and intersection tests of the current frame, gathered from the render
+// threads after each tile. Logged when the frame is done, and written as one
+// line of JSON per frame to the metrics file if one is given.
+cg::RenderMetrics g_frame_metrics;
+std::mutex        g_metrics_mutex;
+std::string       g_metrics_file;
+std::ofstream     g_metrics_out;
+
 // Lights (need to keep pointers to add to ray tracer)
 std::vector<cg::LightNode *> g_lights;
 
 // Scene construction
 std::shared_ptr<cg::SceneNode> g_scene_root;
 
-std::shared_ptr<cg::SceneNode> construct_scene(std::shared_ptr<cg::CameraNode> camera)
+/**
+ * Add the counts of the calling render thread to the frame's metrics.
+ */
+void gather_metrics()
 {
-    // 605.767 - Student to define. Create a scene graph to describe your scene
-    auto scene_node = std::make_shared<cg::SceneNode>();
-
-    // // Red sphere at origin
-    // auto material = std::make_shared<cg::MaterialNode>();
-    // material->set_ambient_and_diffuse(cg::Color4(0.8f, 0.2f, 0.2f, 1.0f));
-    // material->set_specular(cg::Color4(1.0f, 1.0f, 1.0f, 1.0f));
-    // material->set_shininess(64.0f);
-    // auto sphere = std::make_shared<cg::RTSphereNode>(cg::Point3(0.0f, 0.0f, 0.0f), 0.5f);
-    // material->add_child(std::static_pointer_cast<cg::SceneNode>(sphere));
-    // scene_node->add_child(material);
-
-    // Add a floor using a very large sphere (appears nearly flat)
-    auto floor_material = std::make_shared<cg::MaterialNode>();
-    floor_material->set_ambient_and_diffuse(cg::Color4(0.4f, 0.4f, 0.5f, 1.0f));
-    floor_material->set_specular(cg::Color4(0.3f, 0.3f, 0.3f, 1.0f));
-    floor_material->set_shininess(16.0f);
-
-    // Large sphere with center far below, surface at y = -1
-    // Radius 1000, center at (0, -1001, 0) puts the top of the sphere at y = -1
-    auto floor = std::make_shared<cg::RTSphereNode>(cg::Point3(0.0f, -1001.0f, 0.0f), 1000.0f);
-    floor_material->add_child(std::static_pointer_cast<cg::SceneNode>(floor));
-    scene_node->add_child(floor_material);
-
-    // // Mirror ball (reflective)
-    auto mirror_material = std::make_shared<cg::MaterialNode>();
-    mirror_material->set_ambient_and_diffuse(cg::Color4(0.1f, 0.1f, 0.1f, 1.0f));
-    mirror_material->set_specular(cg::Color4(1.0f, 1.0f, 1.0f, 1.0f));
-    mirror_material->set_shininess(128.0f);
-    mirror_material->set_global_reflectivity(0.9f, 0.9f, 0.9f);
-    auto mirror_sphere = std::make_shared<cg::RTSphereNode>(
-        cg::Point3(-1.5f, 0.0f, 0.0f), 0.5f);
-    mirror_material->add_child(std::static_pointer_cast<cg::SceneNode>(mirror_sphere));
-    scene_node->add_child(mirror_material);
-
-    // // Green sphere
-    // auto green_material = std::make_shared<cg::MaterialNode>();
-    // green_material->set_ambient_and_diffuse(cg::Color4(0.2f, 0.8f, 0.2f, 1.0f));
-    // green_material->set_specular(cg::Color4(0.5f, 0.5f, 0.5f, 1.0f));
-    // green_material->set_shininess(32.0f);
-    // auto green_sphere = std::make_shared<cg::RTSphereNode>(
-    //     cg::Point3(1.5f, 0.0f, 3.0f), 0.4f);
-    // green_material->add_child(std::static_pointer_cast<cg::SceneNode>(green_sphere));
-    // scene_node->add_child(green_material);
-
-    // // Glass ball (transparent/refractive)
-    // auto glass_material = std::make_shared<cg::MaterialNode>();
-    // glass_material->set_ambient_and_diffuse(cg::Color4(0.1f, 0.1f, 0.15f, 1.0f));
-    // glass_material->set_specular(cg::Color4(1.0f, 1.0f, 1.0f, 1.0f));
-    // glass_material->set_shininess(128.0f);
-    // glass_material->set_global_transmission(0.95f, 0.95f, 0.95f);
-    // glass_material->set_index_of_refraction(1.0f);
-    // auto glass_sphere = std::make_shared<cg::RTSphereNode>(
-    //     cg::Point3(1.2f, 0.0f, 0.0f), 0.5f);
-    // glass_material->add_child(std::static_pointer_cast<cg::SceneNode>(glass_sphere));
-    // scene_node->add_child(glass_material);
-
-    // ========== PLANAR SURFACES (2 walls) ==========
-
-    // Back wall (blue-ish)
-    auto back_wall_material = std::make_shared<cg::MaterialNode>();
-    back_wall_material->set_ambient_and_diffuse(cg::Color4(0.3f, 0.3f, 0.6f, 1.0f));
-    back_wall_material->set_specular(cg::Color4(0.2f, 0.2f, 0.2f, 1.0f));
-    back_wall_material->set_shininess(8.0f);
-
-    auto back_wall = std::make_shared<cg::RTQuadNode>(
-        cg::Point3(5.0f, -1.0f, 8.0f),    // bottom-right
-        cg::Point3(-5.0f, -1.0f, 8.0f),   // bottom-left
-        cg::Point3(-5.0f, 4.0f, 8.0f),    // top-left
-        cg::Point3(5.0f, 4.0f, 8.0f));    // top-right (reversed for normal toward -Z)
-    back_wall_material->add_child(std::static_pointer_cast<cg::SceneNode>(back_wall));
-    scene_node->add_child(back_wall_material);
-
-    // Left wall (tan/beige)
-    auto left_wall_material = std::make_shared<cg::MaterialNode>();
-    left_wall_material->set_ambient_and_diffuse(cg::Color4(0.6f, 0.5f, 0.4f, 1.0f));
-    left_wall_material->set_specular(cg::Color4(0.2f, 0.2f, 0.2f, 1.0f));
-    left_wall_material->set_shininess(8.0f);
-
-    auto left_wall = std::make_shared<cg::RTQuadNode>(
-        cg::Point3(-5.0f, -1.0f, 8.0f),   // bottom-back
-        cg::Point3(-5.0f, -1.0f, -2.0f),  // bottom-front
-        cg::Point3(-5.0f, 4.0f, -2.0f),   // top-front
-        cg::Point3(-5.0f, 4.0f, 8.0f));   // top-back (reversed for normal toward +X)
-    left_wall_material->add_child(std::static_pointer_cast<cg::SceneNode>(left_wall));
-    scene_node->add_child(left_wall_material);
-
-    // ========== TRIANGLE MESH OBJECTS (3 meshes) ==========
-
-    // Pyramid vertices (shared across faces)
-    cg::Point3 pv0(-3.0f, -1.0f, 2.0f);   // base front-left
-    cg::Point3 pv1(-2.0f, -1.0f, 2.0f);   // base front-right
-    cg::Point3 pv2(-2.0f, -1.0f, 3.0f);   // base back-right
-    cg::Point3 pv3(-3.0f, -1.0f, 3.0f);   // base back-left
-    cg::Point3 pv4(-2.5f, 0.5f, 2.5f);    // apex
-
-    // Front face (facing -Z) - RED
-    auto front_mat = std::make_shared<cg::MaterialNode>();
-    front_mat->set_ambient_and_diffuse(cg::Color4(1.0f, 0.0f, 0.0f, 1.0f));
-    front_mat->set_specular(cg::Color4(0.3f, 0.3f, 0.3f, 1.0f));
-    front_mat->set_shininess(16.0f);
-    auto front_face = std::make_shared<cg::RTMeshNode>(
-        std::vector<cg::Point3>{pv1, pv0, pv4},
-        std::vector<uint16_t>{0, 1, 2});
-    front_mat->add_child(front_face);
-    scene_node->add_child(front_mat);
-
-    // Right face (facing +X) - GREEN
-    auto right_mat = std::make_shared<cg::MaterialNode>();
-    right_mat->set_ambient_and_diffuse(cg::Color4(0.0f, 1.0f, 0.0f, 1.0f));
-    right_mat->set_specular(cg::Color4(0.3f, 0.3f, 0.3f, 1.0f));
-    right_mat->set_shininess(16.0f);
-    auto right_face = std::make_shared<cg::RTMeshNode>(
-        std::vector<cg::Point3>{pv2, pv1, pv4},
-        std::vector<uint16_t>{0, 1, 2});
-    right_mat->add_child(right_face);
-    scene_node->add_child(right_mat);
-
-    // Back face (facing +Z) - BLUE
-    auto back_mat = std::make_shared<cg::MaterialNode>();
-    back_mat->set_ambient_and_diffuse(cg::Color4(0.0f, 0.0f, 1.0f, 1.0f));
-    back_mat->set_specular(cg::Color4(0.3f, 0.3f, 0.3f, 1.0f));
-    back_mat->set_shininess(16.0f);
-    auto back_face = std::make_shared<cg::RTMeshNode>(
-        std::vector<cg::Point3>{pv3, pv2, pv4},
-        std::vector<uint16_t>{0, 1, 2});
-    back_mat->add_child(back_face);
-    scene_node->add_child(back_mat);
-
-    // Left face (facing -X) - YELLOW
-    auto left_mat = std::make_shared<cg::MaterialNode>();
-    left_mat->set_ambient_and_diffuse(cg::Color4(1.0f, 1.0f, 0.0f, 1.0f));
-    left_mat->set_specular(cg::Color4(0.3f, 0.3f, 0.3f, 1.0f));
-    left_mat->set_shininess(16.0f);
-    auto left_face = std::make_shared<cg::RTMeshNode>(
-        std::vector<cg::Point3>{pv0, pv3, pv4},
-        std::vector<uint16_t>{0, 1, 2});
-    left_mat->add_child(left_face);
-    scene_node->add_child(left_mat);
-
-    // // Mesh 2: Simple box/cube (cyan) - reflective
-    // auto box_material = std::make_shared<cg::MaterialNode>();
-    // box_material->set_ambient_and_diffuse(cg::Color4(0.1f, 0.5f, 0.5f, 1.0f));
-    // box_material->set_specular(cg::Color4(0.8f, 0.8f, 0.8f, 1.0f));
-    // box_material->set_shininess(64.0f);
-    // box_material->set_global_reflectivity(0.3f, 0.3f, 0.3f);
-    // float bx = 2.5f, by = -1.0f, bz = 4.0f;
-    // float bs = 0.8f;
-    // std::vector<cg::Point3> box_verts = {
-    //     cg::Point3(bx, by, bz),
-    //     cg::Point3(bx + bs, by, bz),
-    //     cg::Point3(bx + bs, by + bs, bz),
-    //     cg::Point3(bx, by + bs, bz),
-    //     cg::Point3(bx, by, bz + bs),
-    //     cg::Point3(bx + bs, by, bz + bs),
-    //     cg::Point3(bx + bs, by + bs, bz + bs),
-    //     cg::Point3(bx, by + bs, bz + bs)
-    // };
-    // std::vector<uint16_t> box_faces = {
-    //     0, 1, 2,  0, 2, 3,
-    //     5, 4, 7,  5, 7, 6,
-    //     4, 0, 3,  4, 3, 7,
-    //     1, 5, 6,  1, 6, 2,
-    //     3, 2, 6,  3, 6, 7,
-    //     4, 5, 1,  4, 1, 0
-    // };
-    // auto box_mesh = std::make_shared<cg::RTMeshNode>(box_verts, box_faces);
-    // box_material->add_child(std::static_pointer_cast<cg::SceneNode>(box_mesh));
-    // scene_node->add_child(box_material);
-
-    // Mesh 3: Simple wedge/ramp (purple)
-    auto wedge_material = std::make_shared<cg::MaterialNode>();
-    wedge_material->set_ambient_and_diffuse(cg::Color4(0.6f, 0.2f, 0.6f, 1.0f));
-    wedge_material->set_specular(cg::Color4(0.4f, 0.4f, 0.4f, 1.0f));
-    wedge_material->set_shininess(16.0f);
-
-    std::vector<cg::Point3> wedge_verts = {
-        cg::Point3(-4.0f, -1.0f, 5.0f),   // 0 front-left bottom
-        cg::Point3(-3.0f, -1.0f, 5.0f),   // 1 front-right bottom
-        cg::Point3(-3.0f, -1.0f, 7.0f),   // 2 back-right bottom
-        cg::Point3(-4.0f, -1.0f, 7.0f),   // 3 back-left bottom
-        cg::Point3(-4.0f, 0.0f, 7.0f),    // 4 back-left top
-        cg::Point3(-3.0f, 0.0f, 7.0f)     // 5 back-right top
-    };
-    std::vector<uint16_t> wedge_faces = {
-        // Bottom (facing -Y, CCW from below)
-        0, 1, 2,  0, 2, 3,
-        // Back vertical face (facing +Z, CCW from back)
-        2, 5, 4,  2, 4, 3,
-        // Slope face (facing -Z/+Y, CCW from front-above)
-        1, 0, 4,  1, 4, 5,
-        // Left triangle (facing -X, CCW from left)
-        3, 4, 0,
-        // Right triangle (facing +X, CCW from right)
-        1, 5, 2
-    };
-    auto wedge_mesh = std::make_shared<cg::RTMeshNode>(wedge_verts, wedge_faces);
-    wedge_material->add_child(std::static_pointer_cast<cg::SceneNode>(wedge_mesh));
-    scene_node->add_child(wedge_material);
-
-    // Single strong directional light - positioned high and at an angle
-    // so each face of pyramid/wedge receives different illumination
-    auto light = std::make_shared<cg::LightNode>(0);
-    light->set_position(cg::HPoint3(4.0f, 6.0f, -1.0f, 1.0f));  // High, front-right
-    light->set_diffuse(cg::Color4(1.2f, 1.2f, 1.1f, 1.0f));     // Strong white light (>1 for intensity)
-    light->set_specular(cg::Color4(1.0f, 1.0f, 1.0f, 1.0f));
-    light->enable();
-    scene_node->add_child(light);
-    g_lights.push_back(light.get());
-
-    return scene_node;
+    cg::RenderMetrics           metrics = cg::RayTracer::take_thread_metrics();
+    std::lock_guard<std::mutex> lock(g_metrics_mutex);
+    g_frame_metrics += metrics;
 }
 
-void render_rows(int32_t start_row, int32_t end_row, int32_t block_size)
+/**
+ * Report the metrics of a finished frame and reset them for the next one.
+ * No render thread may be running.
+ * @param  frame    Frame number.
+ * @param  wall_ms  Time taken to render the frame in milliseconds.
+ */
+void report_metrics(uint32_t frame, double wall_ms)
 {
-    for(int32_t row = start_row; row <= end_row; ++row)
+    std::string label = "Frame " + std::to_string(frame);
+    g_frame_metrics.log(label.c_str(), wall_ms);
+    if(g_metrics_out.is_open())
     {
-        int32_t y = row * block_size;
-        for(int32_t x = 0; x < g_image_width; x += block_size)
+        g_metrics_out << "{\"frame\": " << frame << ", \"width\": " << g_image_width << ", \"height\": "
+                      << g_image_height << ", \"wall_ms\": " << wall_ms << ", \"metrics\": ";
+        g_frame_metrics.write_json(g_metrics_out);
+        g_metrics_out << "}" << std::endl;
+    }
+    g_frame_metrics = cg::RenderMetrics();
+}
+
+/**
+ * Fill the blocks of the previous pass within a tile whose corner samples
+ * agree, so none of their pixels are traced. The corners are samples of the
+ * previous pass, which no thread writes during this one.
+ */
+void fill_uniform_blocks(cg::PixelBuffer &buffer, const cg::Tile &tile, int32_t parent_size)
+{
+    int32_t child_size = parent_size / 2;
+    for(int32_t y = tile.y0; y < tile.y1 && y + parent_size < g_image_height; y += parent_size)
+    {
+        for(int32_t x = tile.x0; x < tile.x1 && x + parent_size < g_image_width; x += parent_size)
         {
-            // Check if framebuffer has been set for this pixel
-            if(!g_frame_buffer->set(x, y))
+            // Skip blocks within a block that has already been filled
+            if(!buffer.set(x + child_size, y))
             {
-                // Construct a ray through the specified pixel and find the color
-                // using the recursive ray tracer
-                cg::Ray3 ray =
-                    g_camera->construct_ray(static_cast<float>(x), static_cast<float>(y));
-                cg::Color3 color = g_ray_tracer->trace_ray(ray, g_max_depth, DEPTH_THRESHOLD);
-                g_frame_buffer->set(x, y, color, block_size);
+                buffer.fill_if_uniform(x, y, parent_size, UNIFORM_CONTRAST);
             }
         }
     }
 }
 
-#ifdef MULTITHREAD
+/**
+ * Trace the pixel blocks of a tile not yet set as a single wavefront.
+ */
+void trace_tile_wavefront(cg::PixelBuffer &buffer, const cg::Tile &tile, int32_t block_size)
+{
+    static thread_local std::vector<cg::Ray3>   rays;
+    static thread_local std::vector<int32_t>    pixels;
+    static thread_local std::vector<cg::Color3> colors;
+    static thread_local std::vector<uint32_t>   ids;
+    rays.clear();
+    pixels.clear();
+
+    for(int32_t y = tile.y0; y < tile.y1; y += block_size)
+    {
+        for(int32_t x = tile.x0; x < tile.x1; x += block_size)
+        {
+            if(buffer.set(x, y)) { continue; }
+            rays.push_back(g_camera->construct_ray(static_cast<float>(x), static_cast<float>(y)));
+            pixels.push_back(x);
+            pixels.push_back(y);
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(rays.size());
+    colors.resize(count);
+    ids.resize(count);
+    g_ray_tracer->trace_wavefront(rays.data(), count, g_max_depth, DEPTH_THRESHOLD, colors.data(), ids.data());
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        buffer.set(pixels[2 * i], pixels[2 * i + 1], colors[i], block_size, ids[i]);
+    }
+}
 
 /**
- * Display function, multi-threaded
+ * Render the pixel blocks whose lower left corner lies within a tile. Tiles
+ * are multiples of the block size so blocks never straddle two tiles. Blocks
+ * not yet set are traced as packets of neighbouring pixels along each row,
+ * or re-shaded if their primary hit is in the G-buffer. Tiles already
+ * rendered at this block size are skipped.
  */
-void display()
+void render_tile(cg::PixelBuffer &buffer, cg::GBuffer *gbuffer, const cg::Tile &tile, int32_t block_size)
 {
-    int32_t num_threads = std::thread::hardware_concurrency() - 1;
-    num_threads = num_threads > 0 ? num_threads : 1;
+    if(buffer.is_complete(tile, block_size)) { return; }
 
-    // Clear the memory framebuffer
-    g_frame_buffer->clear();
+    // Subdivide only the blocks of the previous pass that are not uniform
+    int32_t parent_size = 2 * block_size;
+    if(parent_size <= static_cast<int32_t>(std::min(g_max_uniform_block, cg::FB_BLOCK_SIZE)))
+    {
+        fill_uniform_blocks(buffer, tile, parent_size);
+    }
 
-    for(int32_t block_size = cg::FB_BLOCK_SIZE; block_size > 0; block_size /= 2)
+    if(g_wavefront)
     {
-        std::thread *threads = new std::thread[num_threads];
-        int32_t      num_rows = g_image_height / block_size;
-        int32_t      start_row = 0;
+        trace_tile_wavefront(buffer, tile, block_size);
+        buffer.complete(tile, block_size);
+        gather_metrics();
+        return;
+    }
+
+    cg::Ray3   rays[cg::SIMD_WIDTH];
+    int32_t    pixel_x[cg::SIMD_WIDTH];
+    cg::Color3        colors[cg::SIMD_WIDTH];
+    uint32_t          ids[cg::SIMD_WIDTH];
+    cg::GBufferSample samples[cg::SIMD_WIDTH];
 
-        for(int32_t t_i = 0; t_i < num_threads; ++t_i)
+    for(int32_t y = tile.y0; y < tile.y1; y += block_size)
+    {
+        uint32_t count = 0;
+        for(int32_t x = tile.x0; x < tile.x1; x += block_size)
         {
-            int32_t end_row = std::min((t_i + 1) * num_rows / num_threads, num_rows - 1);
-            threads[t_i] = std::thread(render_rows, start_row, end_row, block_size);
-            start_row = end_row + 1;
+            // Check if framebuffer has been set for this pixel
+            if(!buffer.set(x, y))
+            {
+                if(gbuffer != nullptr && gbuffer->is_valid(x, y))
+                {
+                    cg::GBufferSample &sample = gbuffer->get_sample(x, y);
+                    cg::Color3         color = g_ray_tracer->reshade(sample, g_max_depth, DEPTH_THRESHOLD);
+                    buffer.set(x, y, color, block_size, sample.instance_index);
+                }
+                else
+                {
+                    // Construct a ray through the specified pixel
+                    rays[count] = g_camera->construct_ray(static_cast<float>(x), static_cast<float>(y));
+                    pixel_x[count++] = x;
+                }
+            }
+
+            // Trace a full packet, or the partial packet left at the end of the row
+            bool row_end = x + block_size >= tile.x1;
+            if(count == cg::SIMD_WIDTH || (row_end && count > 0))
+            {
+                cg::RayPacket packet(rays, count);
+                g_ray_tracer->trace_packet(
+                    packet, g_max_depth, DEPTH_THRESHOLD, colors, ids, gbuffer != nullptr ? samples : nullptr);
+                for(uint32_t i = 0; i < count; ++i)
+                {
+                    buffer.set(pixel_x[i], y, colors[i], block_size, ids[i]);
+                    if(gbuffer != nullptr)
+                    {
+                        gbuffer->get_sample(pixel_x[i], y) = samples[i];
+                        gbuffer->set_valid(pixel_x[i], y);
+                    }
+                }
+                count = 0;
+            }
         }
+    }
+    buffer.complete(tile, block_size);
+    gather_metrics();
+}
 
-        // Wait for threads to complete
-        for(int32_t t_i = 0; t_i < num_threads; ++t_i) { threads[t_i].join(); }
+/**
+ * Supersample the edge pixels of a tile of a buffer with every pixel traced.
+ */
+void refine_tile(cg::PixelBuffer &buffer, const cg::Tile &tile)
+{
+    g_adaptive_sampler.refine_tile(tile, buffer, *g_ray_tracer, *g_camera, g_max_depth, DEPTH_THRESHOLD);
+    gather_metrics();
+}
 
-        g_frame_buffer->render();
-        SDL_GL_SwapWindow(g_sdl_window);
+/**
+ * Adaptive anti-aliasing of a buffer with every pixel traced. Pixels at edges
+ * are supersampled tile by tile (by the scheduler's workers if one is given)
+ * and then written back to the buffer.
+ */
+void anti_alias(cg::PixelBuffer &buffer, cg::TileScheduler *scheduler)
+{
+    g_adaptive_sampler.begin(buffer);
+    auto refine = [&buffer](const cg::Tile &tile) { refine_tile(buffer, tile); };
+    if(scheduler != nullptr) { scheduler->run(g_image_width, g_image_height, refine); }
+    else { refine({0, 0, g_image_width, g_image_height}); }
+    g_adaptive_sampler.resolve(buffer);
+}
+
+/**
+ * Interactive frame. Rendered a pass at a time from the main loop so input is
+ * handled while it renders. While the view keeps changing each frame stops at
+ * FRAME_BUDGET_MS, leaving the coarser passes on screen; the finer passes and
+ * anti-aliasing run once the view has been still for STILL_MS.
+ */
+enum class RenderStage
+{
+    PASSES,
+    ANTI_ALIAS,
+    DONE
+};
+
+struct RenderJob
+{
+    RenderStage                           stage = RenderStage::DONE;
+    int32_t                               block_size = 0;      // Block size of the current pass
+    bool                                  running = false;     // Pass in flight
+    bool                                  interactive = false; // Frame limited to the budget
+    std::chrono::steady_clock::time_point start;               // Start of the frame (last input)
+    uint32_t                              frame = 0;
+};
+
+RenderJob    g_render_job;
+const double FRAME_BUDGET_MS = 33.0;
+const double STILL_MS = 150.0;
+const double POLL_MS = 10.0; // Longest wait on a pass before checking for input
+
+double elapsed_ms(const std::chrono::steady_clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#ifdef MULTITHREAD
+
+/**
+ * Start the current pass (or the anti-aliasing) of the frame on the
+ * persistent worker pool.
+ */
+void start_step()
+{
+    if(g_render_job.stage == RenderStage::PASSES)
+    {
+        int32_t block_size = g_render_job.block_size;
+        g_tile_scheduler->start(g_image_width, g_image_height, [block_size](const cg::Tile &tile) {
+            render_tile(*g_frame_buffer, g_gbuffer.get(), tile, block_size);
+        });
+    }
+    else
+    {
+        g_adaptive_sampler.begin(*g_frame_buffer);
+        g_tile_scheduler->start(g_image_width, g_image_height, [](const cg::Tile &tile) {
+            refine_tile(*g_frame_buffer, tile);
+        });
     }
+}
 
-    // Final scene - simple anti-aliasing (without shooting additional rays)
-    g_frame_buffer->anti_alias();
-    SDL_GL_SwapWindow(g_sdl_window);
+/**
+ * Wait for the current step of the frame.
+ * @param  timeout_ms  Longest time to wait in milliseconds.
+ * @return Returns true if the step is finished.
+ */
+bool wait_step(double timeout_ms) { return g_tile_scheduler->wait(timeout_ms); }
+
+/**
+ * Stop rendering so the camera or framebuffer can be changed. Tiles already
+ * rendered are kept, so an unfinished pass resumes where it stopped.
+ */
+void stop_render()
+{
+    if(!g_render_job.running) { return; }
+    g_tile_scheduler->cancel();
+    g_tile_scheduler->wait();
+    g_render_job.running = false;
 }
 
 #else
 
 /**
- * Display function, single-threaded
+ * Render the current pass (or the anti-aliasing) of the frame. Single
+ * threaded, so the step is finished on return.
  */
-void display()
+void start_step()
 {
+    cg::Tile image = {0, 0, g_image_width, g_image_height};
+    if(g_render_job.stage == RenderStage::PASSES)
+    {
+        render_tile(*g_frame_buffer, g_gbuffer.get(), image, g_render_job.block_size);
+    }
+    else
+    {
+        g_adaptive_sampler.begin(*g_frame_buffer);
+        refine_tile(*g_frame_buffer, image);
+    }
+}
+
+bool wait_step(double) { return true; }
+
+void stop_render() { g_render_job.running = false; }
+
+#endif
+
+/**
+ * Start a new frame of the current view.
+ */
+void start_frame()
+{
+    stop_render();
+
+    // Rebuild the compiled scene if the scene graph changed. Primary hits are
+    // kept unless the geometry moved; shadow tests unless their light moved.
+    bool scene_changed = g_ray_tracer->update_scene();
+    g_ray_tracer->update_lights();
+    g_ray_tracer->set_pixel_spread(g_camera->get_pixel_spread());
+    if(g_gbuffer)
+    {
+        if(scene_changed) { g_gbuffer->invalidate(); }
+        g_gbuffer->update_lights(g_lights);
+    }
+
     // Clear the memory framebuffer
     g_frame_buffer->clear();
+    g_tile_scheduler->reset_stats();
+    g_frame_metrics = cg::RenderMetrics();
+
+    g_render_job.stage = RenderStage::PASSES;
+    g_render_job.block_size = cg::FB_BLOCK_SIZE;
+    g_render_job.interactive = true;
+    g_render_job.start = std::chrono::steady_clock::now();
+}
 
-    for(int32_t block_size = cg::FB_BLOCK_SIZE; block_size > 0; block_size /= 2)
+/**
+ * Display the framebuffer after a step of the frame finishes and move to the
+ * next step.
+ */
+void finish_step()
+{
+    RenderJob &job = g_render_job;
+    if(job.stage == RenderStage::PASSES)
     {
-        render_rows(0, g_image_height+1, block_size);
-        
-        g_frame_buffer->render();
-        SDL_GL_SwapWindow(g_sdl_window);
+        job.block_size /= 2;
+        if(job.block_size == 0) { job.stage = RenderStage::ANTI_ALIAS; }
+    }
+    else
+    {
+        // Final scene - supersample the edges
+        g_adaptive_sampler.resolve(*g_frame_buffer);
+        job.stage = RenderStage::DONE;
+
+        std::string label = "Frame " + std::to_string(job.frame);
+        g_tile_scheduler->log_stats(label.c_str());
+        report_metrics(job.frame++, elapsed_ms(job.start));
     }
 
-    // Final scene - simple anti-aliasing (without shooting additional rays)
-    g_frame_buffer->anti_alias();
+    g_frame_buffer->render();
     SDL_GL_SwapWindow(g_sdl_window);
 }
 
+/**
+ * Advance the frame. Waits at most POLL_MS (or to the end of the frame budget)
+ * so the caller can check for input.
+ * @return Returns false if there is nothing to render until the view is still
+ *         or changes again.
+ */
+bool advance_frame()
+{
+    RenderJob &job = g_render_job;
+    if(job.stage == RenderStage::DONE) { return false; }
+
+    if(!job.running)
+    {
+        // A changing view gets no more than its budget and no anti-aliasing
+        bool out_of_budget = elapsed_ms(job.start) >= FRAME_BUDGET_MS;
+        if(job.interactive && (job.stage == RenderStage::ANTI_ALIAS || out_of_budget))
+        {
+            if(elapsed_ms(job.start) < STILL_MS) { return false; }
+            job.interactive = false;
+        }
+        start_step();
+        job.running = true;
+    }
+
+    double timeout = POLL_MS;
+    if(job.interactive)
+    {
+        timeout = std::min(timeout, std::max(FRAME_BUDGET_MS - elapsed_ms(job.start), 0.0));
+    }
+    if(!wait_step(timeout))
+    {
+        // Out of time: drop the rest of the pass and show what is done
+        if(job.interactive && elapsed_ms(job.start) >= FRAME_BUDGET_MS)
+        {
+            stop_render();
+            g_frame_buffer->render();
+            SDL_GL_SwapWindow(g_sdl_window);
+        }
+        return true;
+    }
+
+    job.running = false;
+    finish_step();
+    return true;
+}
+
+/**
+ * Render the scene once without a window or OpenGL context and write it to
+ * the output file. Only the passes that may interpolate uniform blocks are
+ * rendered, and the image is then anti-aliased as in the final interactive
+ * pass.
+ * @return  Returns the process exit code.
+ */
+int32_t render_headless()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Start at the largest block that may be interpolated (no passes are
+    // displayed so coarser ones would be wasted)
+    uint32_t first_block_size = std::min(std::max(g_max_uniform_block, 1u), cg::FB_BLOCK_SIZE);
+
+    cg::PixelBuffer buffer(g_image_width, g_image_height);
+#ifdef MULTITHREAD
+    cg::TileScheduler scheduler(g_num_threads, 2 * cg::FB_BLOCK_SIZE);
+    for(int32_t block_size = static_cast<int32_t>(first_block_size); block_size > 0; block_size /= 2)
+    {
+        scheduler.run(g_image_width, g_image_height, [&buffer, block_size](const cg::Tile &tile) {
+            render_tile(buffer, nullptr, tile, block_size);
+        });
+    }
+    scheduler.log_stats("Headless");
+    anti_alias(buffer, &scheduler);
+#else
+    for(int32_t block_size = static_cast<int32_t>(first_block_size); block_size > 0; block_size /= 2)
+    {
+        render_tile(buffer, nullptr, {0, 0, g_image_width, g_image_height}, block_size);
+    }
+    anti_alias(buffer, nullptr);
 #endif
 
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    report_metrics(0, elapsed.count());
+    std::cout << "Rendered " << g_image_width << "x" << g_image_height << " in " << elapsed.count()
+              << " ms\n";
+
+    if(!buffer.write_image(g_output_file)) { return 1; }
+    std::cout << "Wrote " << g_output_file << '\n';
+    return 0;
+}
+
+/**
+ * Parse a command line value as a decimal integer.
+ * @param  value   Text of the value.
+ * @param  number  (OUT) Parsed integer.
+ * @return  Returns false if the text is not entirely an integer in range.
+ */
+bool parse_integer(const char *value, int32_t &number)
+{
+    char *end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(value, &end, 10);
+    if(end == value || *end != '\0' || errno == ERANGE || parsed < INT32_MIN || parsed > INT32_MAX)
+    {
+        return false;
+    }
+    number = static_cast<int32_t>(parsed);
+    return true;
+}
+
+/**
+ * Parse the command line.
+ * @return  Returns false if the command line is invalid or help was requested.
+ */
+bool parse_command_line(int argc, char **argv)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if(std::strcmp(arg, "--help") == 0) { return false; }
+
+        // Remaining options all take a value
+        if(i + 1 >= argc)
+        {
+            std::cout << "Missing value for " << arg << '\n';
+            return false;
+        }
+        const char *value = argv[++i];
+
+        // Numeric options are rejected unless the whole value is an integer
+        int32_t number = 0;
+        bool    numeric = parse_integer(value, number);
+        if(std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--output") == 0) { g_output_file = value; }
+        else if(std::strcmp(arg, "--metrics") == 0) { g_metrics_file = value; }
+        else if(std::strcmp(arg, "--width") == 0 && numeric && number > 0) { g_image_width = number; }
+        else if(std::strcmp(arg, "--height") == 0 && numeric && number > 0) { g_image_height = number; }
+        else if(std::strcmp(arg, "--depth") == 0 && numeric && number > 0) { g_max_depth = number; }
+        else if(std::strcmp(arg, "--threads") == 0 && numeric && number >= 0)
+        {
+            g_num_threads = static_cast<uint32_t>(number);
+        }
+        else if(std::strcmp(arg, "--uniform-block") == 0 && numeric && number >= 0)
+        {
+            g_max_uniform_block = static_cast<uint32_t>(number);
+        }
+        else if(std::strcmp(arg, "--gbuffer") == 0 && numeric && number >= 0) { g_use_gbuffer = number != 0; }
+        else if(std::strcmp(arg, "--wavefront") == 0 && numeric && number >= 0) { g_wavefront = number != 0; }
+        else if(std::strcmp(arg, "--roulette") == 0 && numeric && number >= 0)
+        {
+            g_russian_roulette = number != 0;
+        }
+        else if(std::strcmp(arg, "--light-samples") == 0 && numeric && number >= 0)
+        {
+            g_light_samples = static_cast<uint32_t>(number);
+        }
+        else if(std::strcmp(arg, "--aa-levels") == 0 && numeric && number >= 0)
+        {
+            g_adaptive_sampler.set_max_level(static_cast<uint32_t>(number));
+        }
+        else
+        {
+            std::cout << "Invalid option " << arg << " " << value << '\n';
+            return false;
+        }
+    }
+
+    if(g_wavefront) { g_use_gbuffer = false; }
+
+    if(!g_output_file.empty() && !cg::PixelBuffer::is_supported_format(g_output_file))
+    {
+        std::cout << "Unsupported image format: " << g_output_file << '\n';
+        return false;
+    }
+    return true;
+}
+
 /**
  * Reshape method.
  */
@@ -378,6 +646,7 @@ void reshape(int32_t width, int32_t height)
 
     // Create framebuffer (old pointer is automatically deleted)
     g_frame_buffer = std::make_unique<cg::Framebuffer>(width, height);
+    if(g_use_gbuffer) { g_gbuffer = std::make_unique<cg::GBuffer>(width, height); }
 
     glViewport(0, 0, width, height);
 }
@@ -402,6 +671,14 @@ cg::EventType handle_window_event(const SDL_Event &event)
     return result;
 }
 
+/**
+ * The camera has moved so the primary hits in the G-buffer no longer apply.
+ */
+void view_changed()
+{
+    if(g_gbuffer) { g_gbuffer->invalidate(); }
+}
+
 /**
  * Keyboard event handler.
  */
@@ -419,6 +696,7 @@ cg::EventType handle_key_event(const SDL_Event &event)
         case SDLK_R:
             if(upper_case) g_camera->roll(-5);
             else g_camera->roll(5);
+            view_changed();
             result = cg::EventType::REDRAW;
             break;
 
@@ -426,6 +704,7 @@ cg::EventType handle_key_event(const SDL_Event &event)
         case SDLK_P:
             if(upper_case) g_camera->pitch(-5);
             else g_camera->pitch(5);
+            view_changed();
             result = cg::EventType::REDRAW;
             break;
 
@@ -433,9 +712,37 @@ cg::EventType handle_key_event(const SDL_Event &event)
         case SDLK_H:
             if(upper_case) g_camera->heading(-5);
             else g_camera->heading(5);
+            view_changed();
             result = cg::EventType::REDRAW;
             break;
 
+        // Brighten/dim the lights (re-shaded from the G-buffer)
+        case SDLK_I:
+        {
+            float scale = upper_case ? 1.25f : 0.8f;
+            for(cg::LightNode *light : g_lights)
+            {
+                const cg::Color4 &d = light->get_diffuse();
+                const cg::Color4 &s = light->get_specular();
+                light->set_diffuse(cg::Color4(d.r * scale, d.g * scale, d.b * scale, d.a));
+                light->set_specular(cg::Color4(s.r * scale, s.g * scale, s.b * scale, s.a));
+            }
+            result = cg::EventType::REDRAW;
+            break;
+        }
+
+        // Halve/double the render tile size (kept a multiple of the pixel block size)
+        case SDLK_T:
+        {
+            uint32_t tile_size = g_tile_scheduler->get_tile_size();
+            if(upper_case) tile_size = std::min(tile_size * 2, 16 * cg::FB_BLOCK_SIZE);
+            else tile_size = std::max(tile_size / 2, cg::FB_BLOCK_SIZE);
+            g_tile_scheduler->set_tile_size(tile_size);
+            std::cout << "Tile size " << tile_size << '\n';
+            result = cg::EventType::REDRAW;
+            break;
+        }
+
         default: break;
     }
 
@@ -456,11 +763,18 @@ cg::EventType handle_events()
             case SDL_EVENT_QUIT:
             case SDL_EVENT_WINDOW_CLOSE_REQUESTED: result |= cg::EventType::EXIT; break;
 
+            // Stop the render workers before the camera or framebuffer changes
             case SDL_EVENT_WINDOW_RESIZED:
-            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED: result |= handle_window_event(e); break;
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+                stop_render();
+                result |= handle_window_event(e);
+                break;
 
             case SDL_EVENT_KEY_UP: break;
-            case SDL_EVENT_KEY_DOWN: result |= handle_key_event(e); break;
+            case SDL_EVENT_KEY_DOWN:
+                stop_render();
+                result |= handle_key_event(e);
+                break;
 
             default: break;
         }
@@ -482,99 +796,157 @@ int main(int argc, char **argv)
     cg::set_root_paths(argv[0]);
     cg::init_logging("RayTracer.log");
 
-    // Print options
-    std::cout << "Transforms:" << std::endl;
-    std::cout << "r,R - Change camera roll\n";
-    std::cout << "p,P - Change camera pitch\n";
-    std::cout << "h,H - Change camera heading\n";
-
-    // Initialize SDL
-    if(!SDL_Init(SDL_INIT_VIDEO))
+    if(!parse_command_line(argc, argv))
     {
-        std::cout << "Error initializing SDL: " << SDL_GetError() << '\n';
+        std::cout << "Usage: RayTracer [-o|--output image.png|.ppm|.hdr] [--width w] [--height h]\n"
+                     "                 [--depth d] [--threads n] [--uniform-block n] [--aa-levels n]\n"
+                     "                 [--gbuffer 0|1] [--wavefront 0|1] [--roulette 0|1]\n"
+                     "                 [--light-samples n] [--metrics metrics.jsonl]\n"
+                     "With an output file the scene is rendered once without a window.\n"
+                     "--aa-levels sets the adaptive anti-aliasing subdivisions (default 2,\n"
+                     "at most 20 more samples per edge pixel; 0 disables anti-aliasing).\n"
+                     "--uniform-block sets the largest block interpolated when its corners\n"
+                     "agree (default 4; 0 traces every pixel).\n"
+                     "--gbuffer 0 turns off re-shading light changes from the last frame's hits.\n"
+                     "--wavefront 1 traces each tile breadth first, one recursion level at a time\n"
+                     "(turns off the G-buffer).\n"
+                     "--roulette 1 traces rays below the depth threshold at random instead of\n"
+                     "dropping them.\n"
+                     "--light-samples n shades each point with n lights picked by their contribution\n"
+                     "when more can reach it (default 0, all lights).\n"
+                     "--metrics appends the ray and intersection counts of each frame as a line of JSON.\n";
         exit(1);
     }
+    bool headless = !g_output_file.empty();
 
-    // Initialize display mode and window
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-
-    SDL_PropertiesID props = SDL_CreateProperties();
-    if(props == 0)
+    if(!g_metrics_file.empty())
     {
-        std::cout << "Error creating SDL Window Properties: " << SDL_GetError() << '\n';
-        exit(1);
+        g_metrics_out.open(g_metrics_file, std::ios::app);
+        if(!g_metrics_out)
+        {
+            std::cout << "Error opening " << g_metrics_file << '\n';
+            exit(1);
+        }
     }
 
-    // Initialize display mode and window
-    SDL_SetStringProperty(props, SDL_PROP_WINDOW_CREATE_TITLE_STRING, "Ray Tracer Mesh Objects");
-    SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_RESIZABLE_BOOLEAN, true);
-    SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_OPENGL_BOOLEAN, true);
-    SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_WIDTH_NUMBER, g_image_width);
-    SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_HEIGHT_NUMBER, g_image_height);
-    SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_X_NUMBER, 100);
-    SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_Y_NUMBER, 100);
-
-    g_sdl_window = SDL_CreateWindowWithProperties(props);
-    if(g_sdl_window == nullptr)
+    if(!headless)
     {
-        std::cout << "Error initializing SDL Window" << SDL_GetError() << '\n';
-        exit(1);
-    }
+        // Print options
+        std::cout << "Transforms:" << std::endl;
+        std::cout << "r,R - Change camera roll\n";
+        std::cout << "p,P - Change camera pitch\n";
+        std::cout << "h,H - Change camera heading\n";
+        std::cout << "t,T - Halve/double render tile size\n";
+        std::cout << "i,I - Dim/brighten the lights\n";
+
+        // Initialize SDL
+        if(!SDL_Init(SDL_INIT_VIDEO))
+        {
+            std::cout << "Error initializing SDL: " << SDL_GetError() << '\n';
+            exit(1);
+        }
+
+        // Initialize display mode and window
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+        SDL_PropertiesID props = SDL_CreateProperties();
+        if(props == 0)
+        {
+            std::cout << "Error creating SDL Window Properties: " << SDL_GetError() << '\n';
+            exit(1);
+        }
+
+        // Initialize display mode and window
+        SDL_SetStringProperty(props, SDL_PROP_WINDOW_CREATE_TITLE_STRING, "Ray Tracer Mesh Objects");
+        SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_RESIZABLE_BOOLEAN, true);
+        SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_OPENGL_BOOLEAN, true);
+        SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_WIDTH_NUMBER, g_image_width);
+        SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_HEIGHT_NUMBER, g_image_height);
+        SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_X_NUMBER, 100);
+        SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_Y_NUMBER, 100);
+
+        g_sdl_window = SDL_CreateWindowWithProperties(props);
+        if(g_sdl_window == nullptr)
+        {
+            std::cout << "Error initializing SDL Window" << SDL_GetError() << '\n';
+            exit(1);
+        }
 
-    // Initialize OpenGL
-    g_gl_context = SDL_GL_CreateContext(g_sdl_window);
+        // Initialize OpenGL
+        g_gl_context = SDL_GL_CreateContext(g_sdl_window);
 
-    std::cout << "OpenGL  " << glGetString(GL_VERSION) << ", GLSL "
-              << glGetString(GL_SHADING_LANGUAGE_VERSION) << '\n';
+        std::cout << "OpenGL  " << glGetString(GL_VERSION) << ", GLSL "
+                  << glGetString(GL_SHADING_LANGUAGE_VERSION) << '\n';
 
 #if BUILD_WINDOWS
-    int32_t glew_init_result = glewInit();
-    if(GLEW_OK != glew_init_result)
-    {
-        std::cout << "GLEW Error: " << glewGetErrorString(glew_init_result) << std::endl;
-        exit(EXIT_FAILURE);
-    }
+        int32_t glew_init_result = glewInit();
+        if(GLEW_OK != glew_init_result)
+        {
+            std::cout << "GLEW Error: " << glewGetErrorString(glew_init_result) << std::endl;
+            exit(EXIT_FAILURE);
+        }
 #endif
 
-    g_frame_buffer = std::make_unique<cg::Framebuffer>(g_image_width, g_image_height);
+        g_frame_buffer = std::make_unique<cg::Framebuffer>(g_image_width, g_image_height);
+        if(g_use_gbuffer) { g_gbuffer = std::make_unique<cg::GBuffer>(g_image_width, g_image_height); }
+    }
 
     // 605.767 - Student to define. Set up camera parameters for initial view.
     g_camera = std::make_shared<cg::CameraNode>();
 
     // Initialize camera position and orientation
-    // Move camera much further back to see the sphere better
-    g_camera->set_position_and_look_at_pt(cg::Point3(7.0f, 0.5f, -5.0f), cg::Point3(0.0f, 0.0f, 0.0f));
-    g_camera->set_view_up(cg::Vector3(0.0f, 1.0f, 0.0f));  // Y is up
+    cg::set_demo_camera(*g_camera);
     // Initialize view volume for ray tracing
     g_camera->set_view_volume(
         g_image_width, g_image_height, g_field_of_view, g_near_plane_distance, g_far_plane_distance);
 
-    // Construct the scene, pass in the camera node to add to the root node.
-    auto scene_root = construct_scene(g_camera);
+    // Construct the scene and collect its lights
+    auto scene_root = cg::construct_demo_scene(g_lights);
 
     // Construct ray tracer. Pass in the scene graph root node
     g_ray_tracer = new cg::RayTracer(scene_root);
 
     // Add lights to the ray tracer
     for(cg::LightNode *light : g_lights) { g_ray_tracer->add_light(light); }
+    g_ray_tracer->set_russian_roulette(g_russian_roulette);
+    g_ray_tracer->set_light_samples(g_light_samples);
+    g_ray_tracer->set_pixel_spread(g_camera->get_pixel_spread());
 
     // Set view position for lighting calculations
     g_ray_tracer->set_view_position(g_camera->get_position());
 
+    if(headless)
+    {
+        int32_t result = render_headless();
+        delete g_ray_tracer;
+        return result;
+    }
+
+    // Start the render workers
+    g_tile_scheduler = std::make_unique<cg::TileScheduler>(g_num_threads, 2 * cg::FB_BLOCK_SIZE);
+
     // Main loop
     cg::EventType event_result = cg::EventType::NONE;
 
-    // Trigger initial render
-    display();
+    // Trigger initial render. Each new view restarts the frame; input is
+    // checked between (and during) its passes.
+    start_frame();
     while(true)
     {
         event_result = handle_events();
 
         if(event_result & cg::EventType::EXIT) break;
 
-        if(event_result & cg::EventType::REDRAW) display();
+        if(event_result & cg::EventType::REDRAW) start_frame();
+
+        // Idle while waiting for the view to settle or for input
+        if(!advance_frame()) sleep(5);
     }
 
+    // Stop the render workers
+    stop_render();
+    g_tile_scheduler.reset();
+
     // Destroy OpenGL Context, SDL Window and SDL
     SDL_GL_DestroyContext(g_gl_context);
     SDL_DestroyWindow(g_sdl_window);
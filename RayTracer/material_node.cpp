@@ -72,7 +72,7 @@ void MaterialNode::draw(SceneState &scene_state)
     SceneNode::draw(scene_state);
 }
 
-void MaterialNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+void MaterialNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     // Push material onto stack within the current state
     current_state.push_material();
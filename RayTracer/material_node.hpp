@@ -161,7 +161,7 @@ class MaterialNode : public SceneNode
      * @param  current_state  Current state, updated as the scene is traversed
      * @param  closest        Closest object information
      */
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
 
   protected:
     bool    reflective_;
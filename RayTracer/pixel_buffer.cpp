@@ -0,0 +1,251 @@
+#include "RayTracer/pixel_buffer.hpp"
+
+// https://github.com/nothings/stb
+#ifndef STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+#undef STB_IMAGE_WRITE_IMPLEMENTATION
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace cg
+{
+
+float color_difference(Color3 a, Color3 b)
+{
+    a.clamp();
+    b.clamp();
+    return std::max(std::fabs(a.r - b.r), std::max(std::fabs(a.g - b.g), std::fabs(a.b - b.b)));
+}
+
+PixelBuffer::PixelBuffer() {}
+
+PixelBuffer::PixelBuffer(uint32_t w, uint32_t h)
+{
+    // Round up width and height to BLOCK_SIZE increment
+    buffer_width_ = ((w / FB_BLOCK_SIZE) + 1) * FB_BLOCK_SIZE;
+    buffer_height_ = ((h / FB_BLOCK_SIZE) + 1) * FB_BLOCK_SIZE;
+
+    image_width_ = w;
+    image_height_ = h;
+
+    // Size the vectors
+    pixel_set_.resize(buffer_width_ * buffer_height_);
+    pixels_.resize(buffer_width_ * buffer_height_);
+    radiance_.resize(buffer_width_ * buffer_height_);
+    ids_.resize(buffer_width_ * buffer_height_);
+
+    // Every tile starts out changed so the first display shows the whole image
+    tiles_x_ = buffer_width_ / FB_TILE_SIZE;
+    tiles_y_ = buffer_height_ / FB_TILE_SIZE;
+    tile_states_ = std::make_unique<TileState[]>(tiles_x_ * tiles_y_);
+    for(uint32_t i = 0; i < tiles_x_ * tiles_y_; ++i)
+    {
+        tile_states_[i].dirty.store(1, std::memory_order_relaxed);
+        tile_states_[i].block_size.store(0, std::memory_order_relaxed);
+    }
+}
+
+PixelBuffer::~PixelBuffer() {}
+
+void PixelBuffer::clear()
+{
+    // Clear all the set flags
+    std::fill(pixel_set_.begin(), pixel_set_.end(), 0);
+    for(uint32_t i = 0; i < tiles_x_ * tiles_y_; ++i)
+    {
+        tile_states_[i].block_size.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PixelBuffer::set(int32_t x_LL, int32_t y_LL, const Color3 &color, uint32_t block_size, uint32_t id)
+{
+    // Mark this pixel as being set so it doesn't get calculated again
+    pixel_set_[get_pixel_index(x_LL, y_LL)] = 1;
+
+    cColor3 c_color = {color.r_byte(), color.g_byte(), color.b_byte()};
+
+    // Set pixels within the "block"
+    for(uint32_t y = y_LL; y < y_LL + block_size; ++y)
+    {
+        // Get pointer to pixel at the left of the block for this row
+        int32_t   idx = get_pixel_index(x_LL, y);
+        cColor3  *p = pixels_.data() + idx;
+        Color3   *f = radiance_.data() + idx;
+        uint32_t *i = ids_.data() + idx;
+        for(uint32_t x = x_LL; x < x_LL + block_size; ++x, ++p, ++f, ++i)
+        {
+            *p = c_color;
+            *f = color;
+            *i = id;
+        }
+    }
+
+    // Release so the display sees the pixels once it sees the flag
+    uint32_t tile_index = (y_LL / FB_TILE_SIZE) * tiles_x_ + x_LL / FB_TILE_SIZE;
+    tile_states_[tile_index].dirty.store(1, std::memory_order_release);
+}
+
+bool PixelBuffer::set(int32_t x, int32_t y) { return pixel_set_[get_pixel_index(x, y)] != 0; }
+
+bool PixelBuffer::fill_if_uniform(int32_t x_LL, int32_t y_LL, uint32_t block_size, float contrast)
+{
+    int32_t s = static_cast<int32_t>(block_size);
+    int32_t corners[4] = {get_pixel_index(x_LL, y_LL),
+                          get_pixel_index(x_LL + s, y_LL),
+                          get_pixel_index(x_LL, y_LL + s),
+                          get_pixel_index(x_LL + s, y_LL + s)};
+    for(int32_t idx : corners)
+    {
+        if(pixel_set_[idx] == 0 || ids_[idx] != ids_[corners[0]] ||
+           color_difference(radiance_[idx], radiance_[corners[0]]) > contrast)
+        {
+            return false;
+        }
+    }
+
+    // Bilinear interpolation. The lower left pixel holds its own sample
+    // already and the other corners belong to other blocks.
+    const Color3 c00 = radiance_[corners[0]];
+    const Color3 c10 = radiance_[corners[1]];
+    const Color3 c01 = radiance_[corners[2]];
+    const Color3 c11 = radiance_[corners[3]];
+    uint32_t     id = ids_[corners[0]];
+    float        inv_size = 1.0f / static_cast<float>(s);
+    for(int32_t j = 0; j < s; ++j)
+    {
+        float v = j * inv_size;
+        for(int32_t i = (j == 0) ? 1 : 0; i < s; ++i)
+        {
+            float  u = i * inv_size;
+            Color3 color(
+                (1.0f - v) * ((1.0f - u) * c00.r + u * c10.r) + v * ((1.0f - u) * c01.r + u * c11.r),
+                (1.0f - v) * ((1.0f - u) * c00.g + u * c10.g) + v * ((1.0f - u) * c01.g + u * c11.g),
+                (1.0f - v) * ((1.0f - u) * c00.b + u * c10.b) + v * ((1.0f - u) * c01.b + u * c11.b));
+            int32_t idx = get_pixel_index(x_LL + i, y_LL + j);
+            pixel_set_[idx] = 1;
+            pixels_[idx] = {color.r_byte(), color.g_byte(), color.b_byte()};
+            radiance_[idx] = color;
+            ids_[idx] = id;
+        }
+    }
+
+    uint32_t tile_index = (y_LL / FB_TILE_SIZE) * tiles_x_ + x_LL / FB_TILE_SIZE;
+    tile_states_[tile_index].dirty.store(1, std::memory_order_release);
+    return true;
+}
+
+void PixelBuffer::complete(const Tile &region, uint32_t block_size)
+{
+    // Round inwards, except at the image edge where tiles hold padding
+    uint32_t tx0 = (region.x0 + FB_TILE_SIZE - 1) / FB_TILE_SIZE;
+    uint32_t ty0 = (region.y0 + FB_TILE_SIZE - 1) / FB_TILE_SIZE;
+    uint32_t tx1 = region.x1 >= static_cast<int32_t>(image_width_) ? tiles_x_ : region.x1 / FB_TILE_SIZE;
+    uint32_t ty1 = region.y1 >= static_cast<int32_t>(image_height_) ? tiles_y_ : region.y1 / FB_TILE_SIZE;
+    for(uint32_t ty = ty0; ty < ty1; ++ty)
+    {
+        for(uint32_t tx = tx0; tx < tx1; ++tx)
+        {
+            tile_states_[ty * tiles_x_ + tx].block_size.store(static_cast<uint8_t>(block_size),
+                                                              std::memory_order_release);
+        }
+    }
+}
+
+bool PixelBuffer::is_complete(const Tile &region, uint32_t block_size) const
+{
+    // Round outwards
+    uint32_t tx0 = region.x0 / FB_TILE_SIZE;
+    uint32_t ty0 = region.y0 / FB_TILE_SIZE;
+    uint32_t tx1 = std::min((region.x1 + FB_TILE_SIZE - 1) / FB_TILE_SIZE, tiles_x_);
+    uint32_t ty1 = std::min((region.y1 + FB_TILE_SIZE - 1) / FB_TILE_SIZE, tiles_y_);
+    for(uint32_t ty = ty0; ty < ty1; ++ty)
+    {
+        for(uint32_t tx = tx0; tx < tx1; ++tx)
+        {
+            uint8_t done = tile_states_[ty * tiles_x_ + tx].block_size.load(std::memory_order_acquire);
+            if(done == 0 || done > block_size) { return false; }
+        }
+    }
+    return true;
+}
+
+bool PixelBuffer::write_image(const std::string &filename) const
+{
+    std::string ext = get_extension(filename);
+
+    // Rows are stored bottom up. Image files are written top down.
+    int32_t w = static_cast<int32_t>(image_width_);
+    int32_t h = static_cast<int32_t>(image_height_);
+    bool    written = false;
+    if(ext == ".hdr")
+    {
+        std::vector<float> data(image_width_ * image_height_ * 3);
+        float             *d = data.data();
+        for(int32_t y = h - 1; y >= 0; --y)
+        {
+            const Color3 *f = radiance_.data() + get_pixel_index(0, y);
+            for(int32_t x = 0; x < w; ++x, ++f)
+            {
+                *d++ = f->r;
+                *d++ = f->g;
+                *d++ = f->b;
+            }
+        }
+        written = stbi_write_hdr(filename.c_str(), w, h, 3, data.data()) != 0;
+    }
+    else if(ext == ".png" || ext == ".ppm")
+    {
+        std::vector<cColor3> data(image_width_ * image_height_);
+        for(int32_t y = 0; y < h; ++y)
+        {
+            std::copy_n(pixels_.data() + get_pixel_index(0, h - 1 - y), w, data.data() + y * w);
+        }
+        if(ext == ".png") { written = stbi_write_png(filename.c_str(), w, h, 3, data.data(), w * 3) != 0; }
+        else
+        {
+            FILE *fp = fopen(filename.c_str(), "wb");
+            if(fp != nullptr)
+            {
+                fprintf(fp, "P6\n%d %d\n255\n", w, h);
+                written = fwrite(data.data(), sizeof(cColor3), data.size(), fp) == data.size();
+                written = (fclose(fp) == 0) && written;
+            }
+        }
+    }
+    else
+    {
+        std::cout << "Unsupported image format: " << filename << " (use .png, .ppm or .hdr)\n";
+        return false;
+    }
+
+    if(!written) { std::cout << "Error writing image " << filename << '\n'; }
+    return written;
+}
+
+bool PixelBuffer::is_supported_format(const std::string &filename)
+{
+    std::string ext = get_extension(filename);
+    return ext == ".png" || ext == ".ppm" || ext == ".hdr";
+}
+
+std::string PixelBuffer::get_extension(const std::string &filename)
+{
+    std::string ext = filename.substr(std::min(filename.find_last_of('.'), filename.size()));
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext;
+}
+
+int32_t PixelBuffer::get_pixel_index(int32_t x, int32_t y) const { return y * buffer_width_ + x; }
+
+bool PixelBuffer::take_dirty(uint32_t tx, uint32_t ty)
+{
+    return tile_states_[ty * tiles_x_ + tx].dirty.exchange(0, std::memory_order_acquire) != 0;
+}
+
+} // namespace cg
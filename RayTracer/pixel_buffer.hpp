@@ -0,0 +1,209 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    pixel_buffer.hpp
+//	Purpose: CPU side storage for ray traced pixels. Needs no window or
+//           OpenGL context so images can be rendered and written to file
+//           headless. Framebuffer adds display through OpenGL. Pixels are
+//           grouped in tiles that track completion and display updates.
+//============================================================================
+
+#ifndef __RAY_TRACER_PIXEL_BUFFER_HPP__
+#define __RAY_TRACER_PIXEL_BUFFER_HPP__
+
+#include "RayTracer/tile_scheduler.hpp"
+#include "scene/color3.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cg
+{
+
+extern "C"
+{
+    struct cColor3
+    {
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+    };
+} // extern "C"
+
+// pixel block size (for iterative ray tracing so partial solutions
+// are displayed quickly)
+const uint32_t FB_BLOCK_SIZE = 16;
+
+// Framebuffer tile width and height. Render tiles are multiples of this size
+// so every framebuffer tile is written by a single render thread.
+const uint32_t FB_TILE_SIZE = FB_BLOCK_SIZE;
+
+/**
+ * Largest per channel difference of two colors, each clamped to [0, 1].
+ */
+float color_difference(Color3 a, Color3 b);
+
+/**
+ * Pixel storage for the ray tracer. Holds 8 bit color for display and PNG/PPM
+ * output, floating point color for HDR output and the id of the object seen
+ * through each pixel (used to find edges for adaptive anti-aliasing).
+ */
+class PixelBuffer
+{
+  public:
+    /**
+     * Constructs pixel storage given an image width and height.
+     */
+    PixelBuffer(uint32_t w, uint32_t h);
+
+    /**
+     * Destructor
+     */
+    virtual ~PixelBuffer();
+
+    /**
+     * Clears the "set" flags and the completion state of every tile.
+     */
+    void clear();
+
+    /**
+     * Sets a block of pixels to the specified color. Marks the lower
+     * left pixel as being set so it does not need to be recalculated
+     * on following iterations, and marks the tile holding the block as
+     * changed. Blocks never straddle two tiles.
+     * @param  x_LL        x component: lower left pixel of the block
+     * @param  y_LL        y component: lower left pixel of the block
+     * @param  color       Color to assign to the block
+     * @param  block_size  Block size in pixels (x and y)
+     * @param  id          Id of the object seen at the lower left pixel
+     *                     (NO_INSTANCE_INDEX if none)
+     */
+    void set(int32_t x_LL, int32_t y_LL, const Color3 &color, uint32_t block_size, uint32_t id);
+
+    /**
+     * Tests whether the pixel position has been set. Only the lower left position
+     * in each "block" of pixels has this flag set.
+     * @param  x   x pixel value
+     * @param  y   y pixel value
+     */
+    bool set(int32_t x, int32_t y);
+
+    /**
+     * Fill a block by interpolating the samples at its four corners, if the
+     * corners have all been set, see the same object and differ in color by
+     * no more than the contrast given. Every pixel in the block is marked
+     * as set so no rays are traced within it. The upper and right corners
+     * are the lower left pixels of the neighbouring blocks and must lie
+     * within the image.
+     * @param  x_LL        x component: lower left pixel of the block
+     * @param  y_LL        y component: lower left pixel of the block
+     * @param  block_size  Block size in pixels (x and y)
+     * @param  contrast    Largest color difference of a uniform block
+     * @return Returns true if the block was uniform and has been filled.
+     */
+    bool fill_if_uniform(int32_t x_LL, int32_t y_LL, uint32_t block_size, float contrast);
+
+    /**
+     * Get the floating point color of a pixel.
+     * @param  x   x pixel value
+     * @param  y   y pixel value
+     */
+    const Color3 &get_color(int32_t x, int32_t y) const { return radiance_[get_pixel_index(x, y)]; }
+
+    /**
+     * Get the id of the object seen through a pixel.
+     * @param  x   x pixel value
+     * @param  y   y pixel value
+     */
+    uint32_t get_id(int32_t x, int32_t y) const { return ids_[get_pixel_index(x, y)]; }
+
+    /**
+     * Record that a region has been rendered at a block size. Only the tiles
+     * lying wholly within the region (or cut off by the image edge) are
+     * marked complete.
+     * @param  region      Rendered region.
+     * @param  block_size  Block size it was rendered at.
+     */
+    void complete(const Tile &region, uint32_t block_size);
+
+    /**
+     * Has every tile touching a region been rendered at a block size no
+     * larger than the one given.
+     * @param  region      Region to test.
+     * @param  block_size  Block size.
+     * @return Returns true if the region needs no rendering at this block size.
+     */
+    bool is_complete(const Tile &region, uint32_t block_size) const;
+
+    /**
+     * Write the image to a file. The format is chosen by the file extension:
+     * .png, .ppm or .hdr (floating point color).
+     * @param  filename  Output file name.
+     * @return Returns true if the image was written.
+     */
+    bool write_image(const std::string &filename) const;
+
+    /**
+     * Can write_image write a file of this name.
+     * @param  filename  Output file name.
+     * @return Returns true if the file extension is a supported format.
+     */
+    static bool is_supported_format(const std::string &filename);
+
+    /**
+     * Get the image width in pixels.
+     */
+    uint32_t get_width() const { return image_width_; }
+
+    /**
+     * Get the image height in pixels.
+     */
+    uint32_t get_height() const { return image_height_; }
+
+  protected:
+    uint32_t              buffer_width_;
+    uint32_t              buffer_height_;
+    uint32_t              image_width_;
+    uint32_t              image_height_;
+    // One byte per pixel (not std::vector<bool>) so render threads working
+    // on neighbouring tiles never write to the same word
+    std::vector<uint8_t>  pixel_set_;
+    std::vector<cColor3>  pixels_;
+    std::vector<Color3>   radiance_;
+    std::vector<uint32_t> ids_;
+
+    // Per tile state, written by render threads while the display reads it
+    struct TileState
+    {
+        std::atomic<uint8_t> dirty;      // Changed since last displayed
+        std::atomic<uint8_t> block_size; // Smallest block size rendered (0 if none)
+    };
+    uint32_t                     tiles_x_;
+    uint32_t                     tiles_y_;
+    std::unique_ptr<TileState[]> tile_states_;
+
+    int32_t get_pixel_index(int32_t x, int32_t y) const;
+
+    /**
+     * Clear the changed flag of a tile.
+     * @param  tx  Tile column.
+     * @param  ty  Tile row.
+     * @return Returns true if the tile changed since the flag was last cleared.
+     */
+    bool take_dirty(uint32_t tx, uint32_t ty);
+
+  private:
+    // Make default constructor private to force use of w,h constructor
+    PixelBuffer();
+
+    // Lower case file extension including the '.'
+    static std::string get_extension(const std::string &filename);
+};
+
+} // namespace cg
+
+#endif
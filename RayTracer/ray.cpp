@@ -3,12 +3,14 @@
 namespace cg
 {
 
-Ray::Ray(Ray3 &initial_ray, int32_t depth, float t)
+Ray::Ray(Ray3 &initial_ray, int32_t depth, float t, const Color3 &throughput)
 {
     o = initial_ray.o;
     d = initial_ray.d;
     recursion_level_ = depth;
     threshold_ = t;
+    throughput_ = throughput;
+    cone_width_ = 0.0f;
 }
 
 Ray Ray::get_refracted_ray(const Point3       &int_pt,
@@ -41,14 +43,13 @@ Ray Ray::get_refracted_ray(const Point3       &int_pt,
     RayRefractionResult result = refract(int_pt, adjusted_normal, n1, n2);
     total_internal_reflection = result.total_internal_refraction;
 
-    Ray refracted_ray(result.refracted_ray, recursion_level_ - 1, threshold_);
+    Ray refracted_ray(result.refracted_ray, recursion_level_ - 1, threshold_, throughput_);
     return refracted_ray;
 }
 
-bool Ray::below_threshold()
+bool Ray::below_threshold() const
 {
-    // Complete in 605.767 - ray tracing project.
-    return recursion_level_ <= 0;
+    return throughput_.r < threshold_ && throughput_.g < threshold_ && throughput_.b < threshold_;
 }
 
 } // namespace cg
@@ -17,6 +17,7 @@
 #include "geometry/point3.hpp"
 #include "geometry/ray3.hpp"
 #include "geometry/vector3.hpp"
+#include "scene/color3.hpp"
 
 namespace cg
 {
@@ -30,6 +31,8 @@ class Ray : public Ray3
   public:
     int32_t recursion_level_;
     float   threshold_;
+    Color3  throughput_; // Product of the reflectivities and transmissions along the path
+    float   cone_width_; // Width of the ray cone at the origin (see RayTracer::set_pixel_spread)
 
     /**
      * Construct a ray. Provide origin and direction (Ray3) as well
@@ -37,12 +40,14 @@ class Ray : public Ray3
      * @param initial_ray  Initial ray from camera through the image plane.
      * @param depth       Maximum depth (recursions) to trace the ray.
      * @param t           Threshold (attenuation where ray tracing stops)
+     * @param throughput  Weight of the ray's color in the pixel.
      */
-    Ray(Ray3 &initial_ray, int32_t depth, float t);
+    Ray(Ray3 &initial_ray, int32_t depth, float t, const Color3 &throughput = Color3(1.0f, 1.0f, 1.0f));
 
     /**
      * Get the refracted ray given the intersection point, normal, and material.
-     * Checks if total internal reflection occurs.
+     * Checks if total internal reflection occurs. The refracted ray has this
+     * ray's throughput; the caller multiplies in the transmission.
      * @param int_pt  Intersection point where refracted ray begins.
      * @param normal  Normal to the surface at the intersection point.
      * @param mat_node      Material that is intersected.
@@ -56,10 +61,12 @@ class Ray : public Ray3
                           bool               &total_internal_reflection);
 
     /**
-     * Check if below the adaptive depth testing threshold.
+     * Check if below the adaptive depth testing threshold: every component
+     * of the throughput is below the threshold, so the ray can add little
+     * to the pixel.
      * @return  Returns true if below the adaptive depth test threshold.
      */
-    bool below_threshold();
+    bool below_threshold() const;
 };
 
 } // namespace cg
@@ -0,0 +1,57 @@
+#include "RayTracer/ray_queue.hpp"
+
+namespace cg
+{
+
+void RayQueue::clear()
+{
+    rays.clear();
+    node.clear();
+    level.clear();
+    throughput_r.clear();
+    throughput_g.clear();
+    throughput_b.clear();
+    cone_width.clear();
+}
+
+void RayQueue::push(const Ray3 &ray, uint32_t path_node, int32_t ray_level, const Color3 &throughput, float width)
+{
+    rays.push_back(ray);
+    node.push_back(path_node);
+    level.push_back(ray_level);
+    throughput_r.push_back(throughput.r);
+    throughput_g.push_back(throughput.g);
+    throughput_b.push_back(throughput.b);
+    cone_width.push_back(width);
+}
+
+void ShadowQueue::clear()
+{
+    origin.clear();
+    light.clear();
+    geometry_node.clear();
+    instance_index.clear();
+    node.clear();
+    contribution_r.clear();
+    contribution_g.clear();
+    contribution_b.clear();
+}
+
+void ShadowQueue::push(const Point3 &int_pt,
+                       uint32_t      light_index,
+                       SceneNode    *object,
+                       uint32_t      instance,
+                       uint32_t      path_node,
+                       const Color3 &contribution)
+{
+    origin.push_back(int_pt);
+    light.push_back(light_index);
+    geometry_node.push_back(object);
+    instance_index.push_back(instance);
+    node.push_back(path_node);
+    contribution_r.push_back(contribution.r);
+    contribution_g.push_back(contribution.g);
+    contribution_b.push_back(contribution.b);
+}
+
+} // namespace cg
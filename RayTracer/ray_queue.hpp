@@ -0,0 +1,134 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    ray_queue.hpp
+//	Purpose: Queues passed between the stages of the wavefront ray tracer
+//           (intersect, shade, shadow test), and the tree of path nodes
+//           whose colors are combined once every stage has run.
+//============================================================================
+
+#ifndef __RAY_TRACER_RAY_QUEUE_HPP__
+#define __RAY_TRACER_RAY_QUEUE_HPP__
+
+#include "geometry/ray3.hpp"
+#include "scene/color3.hpp"
+#include "scene/ray_traversal_state.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace cg
+{
+
+// Path node with no child
+constexpr uint32_t NO_PATH_NODE = 0xFFFFFFFF;
+
+/**
+ * Rays waiting to be intersected. The per ray payload is held in separate
+ * arrays; ray geometry is held as Ray3 records, the layout ray packets load.
+ */
+struct RayQueue
+{
+    std::vector<Ray3>     rays;
+    std::vector<uint32_t> node;         // Path node receiving the ray's color
+    std::vector<int32_t>  level;        // Recursion levels left
+    std::vector<float>    throughput_r; // Product of the weights along the path
+    std::vector<float>    throughput_g;
+    std::vector<float>    throughput_b;
+    std::vector<float>    cone_width;   // Width of the ray cone at the origin
+
+    /**
+     * Remove all rays (keeps the storage).
+     */
+    void clear();
+
+    /**
+     * Get the number of rays.
+     */
+    uint32_t size() const { return static_cast<uint32_t>(rays.size()); }
+
+    /**
+     * Add a ray.
+     * @param  ray         Ray to add.
+     * @param  path_node   Path node receiving the ray's color.
+     * @param  ray_level   Recursion levels left.
+     * @param  throughput  Product of the weights along the path.
+     * @param  width       Width of the ray cone at the origin.
+     */
+    void push(const Ray3 &ray, uint32_t path_node, int32_t ray_level, const Color3 &throughput, float width);
+};
+
+/**
+ * Shadow rays waiting to be tested, one per lit surface point and light. The
+ * light's contribution is added to the path node if the ray is unoccluded.
+ */
+struct ShadowQueue
+{
+    std::vector<Point3>      origin;         // Surface point
+    std::vector<uint32_t>    light;          // Index of the light
+    std::vector<SceneNode *> geometry_node;  // Object the ray starts from
+    std::vector<uint32_t>    instance_index;
+    std::vector<uint32_t>    node;           // Path node lit by the light
+    std::vector<float>       contribution_r; // Diffuse plus specular from the light
+    std::vector<float>       contribution_g;
+    std::vector<float>       contribution_b;
+
+    /**
+     * Remove all rays (keeps the storage).
+     */
+    void clear();
+
+    /**
+     * Get the number of rays.
+     */
+    uint32_t size() const { return static_cast<uint32_t>(origin.size()); }
+
+    /**
+     * Add a shadow ray.
+     * @param  int_pt        Surface point.
+     * @param  light_index   Index of the light.
+     * @param  object        Object the ray starts from.
+     * @param  instance      Instance of the object.
+     * @param  path_node     Path node lit by the light.
+     * @param  contribution  Diffuse plus specular contribution of the light.
+     */
+    void push(const Point3 &int_pt,
+              uint32_t      light_index,
+              SceneNode    *object,
+              uint32_t      instance,
+              uint32_t      path_node,
+              const Color3 &contribution);
+};
+
+/**
+ * Node of the tree of rays traced for one primary ray. Holds the local color
+ * of the surface hit, the texture color modulating it, and the reflected
+ * (child 0) and transmitted (child 1) rays spawned from it, with their
+ * weights.
+ */
+struct PathNode
+{
+    Color3   color;
+    Color3   texture = Color3(1.0f, 1.0f, 1.0f);
+    Color3   weight[2];
+    uint32_t child[2] = {NO_PATH_NODE, NO_PATH_NODE};
+};
+
+/**
+ * Working storage of the wavefront tracer. Kept between calls so tracing
+ * does not allocate once the queues have grown.
+ */
+struct WavefrontState
+{
+    RayQueue               queue;     // Rays of the current stage
+    RayQueue               next;      // Rays spawned by the current stage
+    std::vector<PacketHit> hits;      // Closest hits, one packet per SIMD_WIDTH rays
+    std::vector<uint32_t>  order;     // Rays of the current stage sorted by material
+    ShadowQueue            shadows;
+    std::vector<PathNode>  nodes;
+};
+
+} // namespace cg
+
+#endif
@@ -1,16 +1,162 @@
 #include "RayTracer/ray_tracer.hpp"
 
+#include "RayTracer/texture_node.hpp"
 #include "geometry/geometry.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <numeric>
 
 namespace cg
 {
 
+#ifdef RAY_COUNTS
+
+// Rays traced by this thread since the counts were last taken
+static thread_local RayCounts t_ray_counts;
+
+#define COUNT_RAYS(field, n) (t_ray_counts.field += (n))
+
+#else
+
+#define COUNT_RAYS(field, n) ((void)(n))
+
+#endif
+
+// Queues of the wavefront tracer on this thread
+static thread_local WavefrontState t_wavefront;
+
+// Lights shading the current surface point. Used up before reflected and
+// refracted rays are traced, so one list serves every recursion level.
+static thread_local std::vector<LightSample> t_light_samples;
+
+// Last primitive found blocking a shadow ray toward each light on this
+// thread. Only a hint: it is tested like any other primitive.
+static thread_local std::vector<uint32_t> t_occluders;
+
+// Copy the closest hit of one lane of a packet into a traversal state
+static void load_lane(const PacketHit &hits, uint32_t lane, RayTraversalState &closest)
+{
+    closest.t_min = hits.t_min[lane];
+    closest.geometry_node = hits.geometry_node[lane];
+    closest.material_node = hits.material_node[lane];
+    closest.texture_node = hits.texture_node[lane];
+    closest.instance_index = hits.instance_index[lane];
+    closest.hit.face_index = hits.face_index[lane];
+    closest.hit.barycentric_u = hits.barycentric_u[lane];
+    closest.hit.barycentric_v = hits.barycentric_v[lane];
+    closest.transform_required = hits.inverse_matrix[lane] != nullptr;
+    if(closest.transform_required)
+    {
+        closest.inverse_matrix = *hits.inverse_matrix[lane];
+        closest.normal_matrix = *hits.normal_matrix[lane];
+    }
+}
+
+// Complete the surface interaction record of a hit: normal and texture
+// coordinate. Objects under a transform are evaluated in object space and the
+// normal is brought back to world space. Returns the intersection point.
+static Point3 complete_hit(const Ray3 &ray, RayTraversalState &closest)
+{
+    GeometryNode *object = (GeometryNode *)closest.geometry_node;
+    Point3        int_pt = ray.intersect(closest.t_min);
+    if(closest.transform_required)
+    {
+        Point3 obj_pt = closest.inverse_matrix * int_pt;
+        closest.hit.normal = closest.normal_matrix * object->get_normal(obj_pt, closest.hit);
+        closest.hit.normal.normalize();
+        if(closest.texture_node != nullptr)
+        {
+            closest.hit.texture_coord = object->get_texture_coord(obj_pt, closest.hit);
+        }
+    }
+    else
+    {
+        closest.hit.normal = object->get_normal(int_pt, closest.hit);
+        if(closest.texture_node != nullptr)
+        {
+            closest.hit.texture_coord = object->get_texture_coord(int_pt, closest.hit);
+        }
+    }
+    return int_pt;
+}
+
+// Smallest cosine between a ray and the surface used to widen texture
+// footprints at grazing angles
+constexpr float MIN_FOOTPRINT_COS = 0.01f;
+
+// Texture color of a completed hit, filtered over the footprint of a ray cone
+// of the given width. A cone meeting the surface at an angle covers an
+// ellipse stretched by 1 / cos; the filter is square, so its width is taken
+// from the ellipse's area rather than its long axis, which would blur. The
+// footprint of a transformed object is measured in object space.
+static Color3 texture_color(const Ray3 &ray, const RayTraversalState &closest, const Point3 &int_pt, float width)
+{
+    GeometryNode *object = (GeometryNode *)closest.geometry_node;
+    float         scale;
+    if(closest.transform_required)
+    {
+        Vector3 obj_d = closest.inverse_matrix * ray.d;
+        scale = object->get_texture_scale(closest.inverse_matrix * int_pt, closest.hit) * obj_d.norm();
+    }
+    else { scale = object->get_texture_scale(int_pt, closest.hit); }
+
+    float cos_angle = std::max(std::fabs(ray.d.dot(closest.hit.normal)), MIN_FOOTPRINT_COS);
+    float footprint = width * scale / std::sqrt(cos_angle);
+    TextureCoord2 tex_coord(closest.hit.texture_coord.x, closest.hit.texture_coord.y);
+    return static_cast<TextureNode *>(closest.texture_node)->get_color(tex_coord, footprint);
+}
+
+// Uniform random number in [0, 1) hashed from a list of values and a seed.
+// Random choices are made this way so a render is the same with any number of
+// threads and either tracer.
+static float hash_sample(const float *values, uint32_t count, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+
+// Random number for a Russian roulette decision on a ray
+static float roulette_sample(const Ray3 &ray)
+{
+    float v[6] = {ray.o.x, ray.o.y, ray.o.z, ray.d.x, ray.d.y, ray.d.z};
+    return hash_sample(v, 6, 0);
+}
+
+// Queue a reflected or transmitted ray as a child of a path node
+static void spawn(WavefrontState &state, uint32_t parent, uint32_t slot, const Ray &ray, const Color3 &weight)
+{
+    uint32_t child = static_cast<uint32_t>(state.nodes.size());
+    state.nodes[parent].child[slot] = child;
+    state.nodes[parent].weight[slot] = weight;
+    state.nodes.emplace_back();
+    state.next.push(ray, child, ray.recursion_level_, ray.throughput_, ray.cone_width_);
+    if(slot == 0) { COUNT_RAYS(reflection, 1); }
+    else { COUNT_RAYS(refraction, 1); }
+}
+
 RayTracer::RayTracer(std::shared_ptr<SceneNode> scene_root)
 {
     scene_root_ = scene_root;
 
+    // Compile the scene and build the top level acceleration structure used
+    // for all ray queries
+    update_scene();
+
     // Initialize lighting support. Set the global ambient here.
 
     lighting_.set_ambient(Color3(0.25f, 0.25f, 0.25f));
@@ -18,36 +164,315 @@ RayTracer::RayTracer(std::shared_ptr<SceneNode> scene_root)
 
 RayTracer::~RayTracer() {}
 
+bool RayTracer::update_scene()
+{
+    if(compiled_scene_.is_current()) { return false; }
+
+    // Moving instances leaves the primitives and their mesh BVHs unchanged
+    if(compiled_scene_.is_structure_current())
+    {
+        compiled_scene_.update_transforms();
+        scene_bvh_.refit();
+        return true;
+    }
+
+    compiled_scene_.compile(scene_root_);
+    scene_bvh_.build(compiled_scene_);
+    return true;
+}
+
 Color3 RayTracer::trace_ray(Ray3 &initial_ray, int depth, float adaptive_threshold)
 {
+    COUNT_RAYS(primary, 1);
     Ray ray(initial_ray, depth, adaptive_threshold);
-    return trace_ray(ray);
+    return trace_closest(ray);
+}
+
+Color3 RayTracer::trace_closest(Ray &ray)
+{
+    // Traverse the scene BVH to find closest intersecting object. Traversal
+    // states start with no hit, material, texture or transform.
+    RayTraversalState current_state;
+    RayTraversalState closest;
+
+    scene_bvh_.find_closest_intersect(ray, current_state, closest);
+    return shade(ray, closest);
+}
+
+void RayTracer::trace_packet(const RayPacket &packet,
+                             int              depth,
+                             float            adaptive_threshold,
+                             Color3          *colors,
+                             uint32_t        *ids,
+                             GBufferSample   *samples)
+{
+    // Primary visibility for the whole packet
+    RayTraversalState current_state;
+    PacketHit         hits(1e30f);
+    scene_bvh_.find_closest_intersect(packet, current_state, hits);
+    COUNT_RAYS(primary, packet.count);
+
+    // Shade each ray (secondary rays are traced one at a time)
+    for(uint32_t i = 0; i < packet.count; ++i)
+    {
+        RayTraversalState closest;
+        load_lane(hits, i, closest);
+
+        Ray3 ray3 = packet.get_ray(i);
+        Ray  ray(ray3, depth, adaptive_threshold);
+        colors[i] = shade(ray, closest, samples != nullptr ? samples + i : nullptr);
+        if(ids != nullptr) { ids[i] = closest.instance_index; }
+    }
+}
+
+void RayTracer::trace_wavefront(const Ray3 *rays,
+                                uint32_t    count,
+                                int         depth,
+                                float       adaptive_threshold,
+                                Color3     *colors,
+                                uint32_t   *ids)
+{
+    // Path node i holds the color of primary ray i
+    WavefrontState &state = t_wavefront;
+    state.queue.clear();
+    state.nodes.assign(count, PathNode());
+    for(uint32_t i = 0; i < count; ++i) { state.queue.push(rays[i], i, depth, Color3(1.0f, 1.0f, 1.0f), 0.0f); }
+    COUNT_RAYS(primary, count);
+
+    for(bool primary = true; state.queue.size() > 0; primary = false)
+    {
+        RayQueue &queue = state.queue;
+        uint32_t  size = queue.size();
+
+        // Intersect stage: closest hits of consecutive rays found as packets
+        uint32_t packets = (size + SIMD_WIDTH - 1) / SIMD_WIDTH;
+        state.hits.assign(packets, PacketHit(1e30f));
+        for(uint32_t p = 0; p < packets; ++p)
+        {
+            uint32_t          first = p * SIMD_WIDTH;
+            RayPacket         packet(&queue.rays[first], std::min(SIMD_WIDTH, size - first));
+            RayTraversalState current_state;
+            scene_bvh_.find_closest_intersect(packet, current_state, state.hits[p]);
+        }
+        if(primary && ids != nullptr)
+        {
+            for(uint32_t i = 0; i < size; ++i)
+            {
+                ids[i] = state.hits[i / SIMD_WIDTH].instance_index[i % SIMD_WIDTH];
+            }
+        }
+
+        // Sort stage: rays hitting the same material are shaded together
+        state.order.resize(size);
+        std::iota(state.order.begin(), state.order.end(), 0u);
+        std::stable_sort(state.order.begin(),
+                         state.order.end(),
+                         [&state](uint32_t a, uint32_t b)
+                         {
+                             return std::less<SceneNode *>()(
+                                 state.hits[a / SIMD_WIDTH].material_node[a % SIMD_WIDTH],
+                                 state.hits[b / SIMD_WIDTH].material_node[b % SIMD_WIDTH]);
+                         });
+
+        // Shade stage
+        state.shadows.clear();
+        state.next.clear();
+        for(uint32_t index : state.order) { shade_queued(state, index, adaptive_threshold); }
+
+        // Shadow stage. Each node's shadow rays are queued in light order, so
+        // lights are added in the same order as the recursive tracer adds them.
+        ShadowQueue &shadows = state.shadows;
+        for(uint32_t i = 0; i < shadows.size(); ++i)
+        {
+            if(!in_shadow(shadows.origin[i], shadows.light[i], shadows.geometry_node[i], shadows.instance_index[i]))
+            {
+                Color3 &color = state.nodes[shadows.node[i]].color;
+                color.r += shadows.contribution_r[i];
+                color.g += shadows.contribution_g[i];
+                color.b += shadows.contribution_b[i];
+            }
+        }
+
+        std::swap(state.queue, state.next);
+    }
+
+    // Modulate each node's local color by its texture and add its weighted
+    // children. Children always follow their parent, so a reverse walk
+    // finishes them first.
+    for(uint32_t i = static_cast<uint32_t>(state.nodes.size()); i-- > 0;)
+    {
+        PathNode &node = state.nodes[i];
+        node.color.r *= node.texture.r;
+        node.color.g *= node.texture.g;
+        node.color.b *= node.texture.b;
+        for(uint32_t slot = 0; slot < 2; ++slot)
+        {
+            if(node.child[slot] == NO_PATH_NODE) { continue; }
+            const Color3 &child = state.nodes[node.child[slot]].color;
+            node.color.r += child.r * node.weight[slot].r;
+            node.color.g += child.g * node.weight[slot].g;
+            node.color.b += child.b * node.weight[slot].b;
+        }
+        node.color.clamp();
+    }
+    for(uint32_t i = 0; i < count; ++i) { colors[i] = state.nodes[i].color; }
 }
 
-Color3 RayTracer::trace_ray(Ray &ray)
+void RayTracer::shade_queued(WavefrontState &state, uint32_t index, float adaptive_threshold)
 {
-    // Traverse the scene graph to find closest intersecting object
-    SceneState current_state;
-    SceneState closest;
-    closest.t_min = 1e30f;  // Initialize to very large value
-    closest.geometry_node = nullptr;
-    closest.material_node = nullptr;
+    RayQueue         &queue = state.queue;
+    uint32_t          node = queue.node[index];
+    RayTraversalState closest;
+    load_lane(state.hits[index / SIMD_WIDTH], index % SIMD_WIDTH, closest);
 
-    scene_root_->find_closest_intersect(ray, current_state, closest);
+    // Background, and a default gray for objects with no material
+    if(!closest.geometry_node)
+    {
+        state.nodes[node].color = Color3(0.0f, 0.0f, 0.0f);
+        return;
+    }
+    MaterialNode *material = (MaterialNode *)closest.material_node;
+    if(!material)
+    {
+        state.nodes[node].color = Color3(0.5f, 0.5f, 0.5f);
+        return;
+    }
 
+    Point3 int_pt = complete_hit(queue.rays[index], closest);
+    const Vector3 &normal = closest.hit.normal;
+    float          cone_width = queue.cone_width[index] + pixel_spread_ * closest.t_min;
+    if(closest.texture_node != nullptr)
+    {
+        state.nodes[node].texture = texture_color(queue.rays[index], closest, int_pt, cone_width);
+    }
+
+    // Ambient and emission
+    Color3        color = lighting_.get_ambient(material);
+    const Color4 &emission = material->get_emission();
+    color.r += emission.r;
+    color.g += emission.g;
+    color.b += emission.b;
+    state.nodes[node].color = color;
+
+    // Lights are added by the shadow stage if the surface point is not in
+    // shadow. Lights that contribute nothing need no shadow ray.
+    gather_lights(int_pt, normal, material, t_light_samples);
+    for(const LightSample &light : t_light_samples)
+    {
+        state.shadows.push(int_pt,
+                           light.index,
+                           closest.geometry_node,
+                           closest.instance_index,
+                           node,
+                           light.contribution);
+    }
+
+    // Queue reflected and refracted rays unless recursion stops here
+    Color3 throughput(queue.throughput_r[index], queue.throughput_g[index], queue.throughput_b[index]);
+    Ray    ray(queue.rays[index], queue.level[index], adaptive_threshold, throughput);
+    if(ray.recursion_level_ <= 0) { return; }
+    ray.cone_width_ = cone_width;
+
+    if(material->is_reflective())
+    {
+        Vector3 reflect_dir = ray.d - normal * (2.0f * ray.d.dot(normal));
+        reflect_dir.normalize();
+        Color3 reflectivity = material->get_global_reflectivity();
+        Ray3   reflected_ray3(int_pt + reflect_dir * EPSILON, reflect_dir);
+        Ray    reflected_ray(
+            reflected_ray3, ray.recursion_level_ - 1, adaptive_threshold, throughput * reflectivity);
+        reflected_ray.cone_width_ = cone_width;
+        if(keep_ray(reflected_ray, reflectivity)) { spawn(state, node, 0, reflected_ray, reflectivity); }
+    }
+    if(material->is_transparent())
+    {
+        // Total internal reflection is weighted by the transmission
+        bool total_internal_reflection = false;
+        Ray  refracted_ray = ray.get_refracted_ray(int_pt, normal, material, total_internal_reflection);
+        if(total_internal_reflection)
+        {
+            Vector3 reflect_dir = ray.d - normal * (2.0f * ray.d.dot(normal));
+            reflect_dir.normalize();
+            refracted_ray.o = int_pt + reflect_dir * EPSILON;
+            refracted_ray.d = reflect_dir;
+        }
+        Color3 transmission = material->get_global_transmission();
+        refracted_ray.throughput_ = throughput * transmission;
+        refracted_ray.cone_width_ = cone_width;
+        if(keep_ray(refracted_ray, transmission)) { spawn(state, node, 1, refracted_ray, transmission); }
+    }
+}
+
+Color3 RayTracer::reshade(GBufferSample &sample, int depth, float adaptive_threshold)
+{
+    if(!sample.geometry_node) { return Color3(0.0f, 0.0f, 0.0f); }
+
+    // Only the direction of the primary ray is used in shading
+    Ray3 ray3(sample.position, sample.direction);
+    Ray  ray(ray3, depth, adaptive_threshold);
+    ray.cone_width_ = sample.cone_width;
+    return shade_surface(ray,
+                         sample.position,
+                         sample.normal,
+                         static_cast<MaterialNode *>(sample.material_node),
+                         static_cast<GeometryNode *>(sample.geometry_node),
+                         sample.instance_index,
+                         sample.texture_color,
+                         &sample);
+}
+
+Color3 RayTracer::shade(Ray &ray, RayTraversalState &closest, GBufferSample *sample)
+{
     // If no object hit, return background value
-    if(!closest.geometry_node) { return Color3(0.0f, 0.0f, 0.0f); }
+    if(!closest.geometry_node)
+    {
+        if(sample != nullptr)
+        {
+            sample->geometry_node = nullptr;
+            sample->instance_index = NO_INSTANCE_INDEX;
+        }
+        return Color3(0.0f, 0.0f, 0.0f);
+    }
 
     // Get the nearest object and state
     MaterialNode *material = (MaterialNode *)closest.material_node;
     GeometryNode *nearest_object = (GeometryNode *)closest.geometry_node;
 
-    // Find the intersection point
-    Point3 int_pt = ray.intersect(closest.t_min);
+    // Find the intersection point, normal and texture coordinate. The ray's
+    // cone is carried on from the hit.
+    Point3 int_pt = complete_hit(ray, closest);
+    ray.cone_width_ += pixel_spread_ * closest.t_min;
+    Color3 texture(1.0f, 1.0f, 1.0f);
+    if(closest.texture_node != nullptr) { texture = texture_color(ray, closest, int_pt, ray.cone_width_); }
 
-    // Get the normal (transform if needed)
-    Vector3 normal = nearest_object->get_normal(int_pt);
+    if(sample != nullptr)
+    {
+        sample->geometry_node = nearest_object;
+        sample->material_node = material;
+        sample->texture_node = closest.texture_node;
+        sample->instance_index = closest.instance_index;
+        sample->position = int_pt;
+        sample->normal = closest.hit.normal;
+        sample->texture_coord = closest.hit.texture_coord;
+        sample->direction = ray.d;
+        sample->cone_width = ray.cone_width_;
+        sample->texture_color = texture;
+        sample->shadow_known = 0;
+        sample->shadow_mask = 0;
+    }
+    return shade_surface(
+        ray, int_pt, closest.hit.normal, material, nearest_object, closest.instance_index, texture, sample);
+}
 
+Color3 RayTracer::shade_surface(Ray           &ray,
+                                const Point3  &int_pt,
+                                const Vector3 &normal,
+                                MaterialNode  *material,
+                                GeometryNode  *object,
+                                uint32_t       instance,
+                                const Color3  &texture,
+                                GBufferSample *sample)
+{
     // Check if material exists
     if(!material)
     {
@@ -64,32 +489,47 @@ Color3 RayTracer::trace_ray(Ray &ray)
     color.g += emission.g;
     color.b += emission.b;
 
-    // Iterate through all lights
-    for(LightNode *light : lights_)
+    // Iterate through the lights that can reach the point
+    gather_lights(int_pt, normal, material, t_light_samples);
+    for(const LightSample &light : t_light_samples)
     {
-        // Get light position
-        Point3 light_pos = light->get_position();
+        uint32_t i = light.index;
 
-        // Check if point is in shadow with respect to this light
-        if(!in_shadow(int_pt, light_pos, nearest_object))
+        // Check if point is in shadow with respect to this light. Use the
+        // cached test if there is one.
+        uint32_t light_bit = i < GBUFFER_SHADOW_LIGHTS ? 1u << i : 0;
+        bool     shadowed;
+        if(sample != nullptr && (sample->shadow_known & light_bit) != 0)
         {
-            // Not in shadow - compute diffuse and specular contribution
-            Color3 diffuse, specular;
-            lighting_.local_contribution(light, material, int_pt, normal, diffuse, specular);
-
-            // Add light contribution
-            color.r += diffuse.r + specular.r;
-            color.g += diffuse.g + specular.g;
-            color.b += diffuse.b + specular.b;
+            shadowed = (sample->shadow_mask & light_bit) != 0;
+        }
+        else
+        {
+            shadowed = in_shadow(int_pt, i, object, instance);
+            if(sample != nullptr)
+            {
+                sample->shadow_known |= light_bit;
+                if(shadowed) { sample->shadow_mask |= light_bit; }
+                else { sample->shadow_mask &= ~light_bit; }
+            }
+        }
+        if(!shadowed)
+        {
+            // Not in shadow - add diffuse and specular contribution
+            color.r += light.contribution.r;
+            color.g += light.contribution.g;
+            color.b += light.contribution.b;
         }
     }
 
-    // TODO: Get the texture color if the intersected object has a texture
-    // and modulate the color
+    // Modulate the local color by the texture color
+    color.r *= texture.r;
+    color.g *= texture.g;
+    color.b *= texture.b;
 
-    // TODO: Return if max depth is reached or attenuation is below threshold
-    // (do not spawn additional rays)
-    if(ray.recursion_level_ <= 0 || ray.below_threshold())
+    // Return if max depth is reached (do not spawn additional rays). Rays
+    // whose attenuation is below the threshold are dropped before tracing.
+    if(ray.recursion_level_ <= 0)
     {
        color.clamp();
        return color;
@@ -107,17 +547,23 @@ Color3 RayTracer::trace_ray(Ray &ray)
         Point3 reflect_origin = int_pt + reflect_dir * EPSILON;
 
         // Create reflected ray with decremented recursion level
+        Color3 reflectivity = material->get_global_reflectivity();
         Ray3 reflected_ray3(reflect_origin, reflect_dir);
-        Ray reflected_ray(reflected_ray3, ray.recursion_level_ - 1, ray.threshold_);
-
-        // Recursively trace reflected ray
-        Color3 reflected_color = trace_ray(reflected_ray);
+        Ray reflected_ray(
+            reflected_ray3, ray.recursion_level_ - 1, ray.threshold_, ray.throughput_ * reflectivity);
+        reflected_ray.cone_width_ = ray.cone_width_;
 
-        // Add reflected contribution weighted by reflectivity
-        const Color3& reflectivity = material->get_global_reflectivity();
-        color.r += reflected_color.r * reflectivity.r;
-        color.g += reflected_color.g * reflectivity.g;
-        color.b += reflected_color.b * reflectivity.b;
+        if(keep_ray(reflected_ray, reflectivity))
+        {
+            // Recursively trace reflected ray
+            COUNT_RAYS(reflection, 1);
+            Color3 reflected_color = trace_closest(reflected_ray);
+
+            // Add reflected contribution weighted by reflectivity
+            color.r += reflected_color.r * reflectivity.r;
+            color.g += reflected_color.g * reflectivity.g;
+            color.b += reflected_color.b * reflectivity.b;
+        }
     }
 
     // Spawn a transmitted ray if material is transparent - add to color
@@ -126,34 +572,30 @@ Color3 RayTracer::trace_ray(Ray &ray)
         bool total_internal_reflection = false;
         Ray refracted_ray = ray.get_refracted_ray(int_pt, normal, material, total_internal_reflection);
 
-        if (!total_internal_reflection)
+        if (total_internal_reflection)
+        {
+            // Total internal reflection - treat as reflection
+            Vector3 reflect_dir = ray.d - normal * (2.0f * ray.d.dot(normal));
+            reflect_dir.normalize();
+            refracted_ray.o = int_pt + reflect_dir * EPSILON;
+            refracted_ray.d = reflect_dir;
+        }
+
+        // Both are weighted by the transmission coefficients
+        Color3 transmission = material->get_global_transmission();
+        refracted_ray.throughput_ = ray.throughput_ * transmission;
+        refracted_ray.cone_width_ = ray.cone_width_;
+        if(keep_ray(refracted_ray, transmission))
         {
             // Recursively trace refracted ray
-            Color3 refracted_color = trace_ray(refracted_ray);
+            COUNT_RAYS(refraction, 1);
+            Color3 refracted_color = trace_closest(refracted_ray);
 
             // Add refracted contribution weighted by transmission coefficients
-            const Color3& transmission = material->get_global_transmission();
             color.r += refracted_color.r * transmission.r;
             color.g += refracted_color.g * transmission.g;
             color.b += refracted_color.b * transmission.b;
         }
-        else
-        {
-            // Total internal reflection - treat as reflection
-            Vector3 reflect_dir = ray.d - normal * (2.0f * ray.d.dot(normal));
-            reflect_dir.normalize();
-            Point3 reflect_origin = int_pt + reflect_dir * EPSILON;
-
-            Ray3 reflected_ray3(reflect_origin, reflect_dir);
-            Ray reflected_ray(reflected_ray3, ray.recursion_level_ - 1, ray.threshold_);
-
-            Color3 reflected_color = trace_ray(reflected_ray);
-
-            const Color3& transmission = material->get_global_transmission();
-            color.r += reflected_color.r * transmission.r;
-            color.g += reflected_color.g * transmission.g;
-            color.b += reflected_color.b * transmission.b;
-        }
     }
 
     // Clamp color
@@ -164,12 +606,116 @@ Color3 RayTracer::trace_ray(Ray &ray)
 
 void RayTracer::set_view_position(const Point3 &pos) { lighting_.set_view_position(pos); }
 
-void RayTracer::add_light(LightNode *light) { lights_.push_back(light); }
+void RayTracer::add_light(LightNode *light)
+{
+    lights_.push_back(light);
+    update_lights();
+}
+
+void RayTracer::update_lights() { light_bvh_.build(lights_); }
+
+void RayTracer::set_light_samples(uint32_t count) { light_samples_ = count; }
+
+void RayTracer::set_occluder_cache(bool enable) { occluder_cache_ = enable; }
+
+void RayTracer::gather_lights(const Point3             &int_pt,
+                              const Vector3            &normal,
+                              const MaterialNode       *material,
+                              std::vector<LightSample> &lights) const
+{
+    static thread_local std::vector<uint32_t> t_candidates;
+    static thread_local std::vector<float>    t_cumulative;
+
+    lights.clear();
+    light_bvh_.find_lights(int_pt, t_candidates);
+    for(uint32_t index : t_candidates)
+    {
+        Color3 diffuse, specular;
+        lighting_.local_contribution(lights_[index], material, int_pt, normal, diffuse, specular);
+        Color3 contribution(diffuse.r + specular.r, diffuse.g + specular.g, diffuse.b + specular.b);
+        if(contribution.r == 0.0f && contribution.g == 0.0f && contribution.b == 0.0f) { continue; }
+        lights.push_back({index, contribution});
+    }
+    if(light_samples_ == 0 || lights.size() <= light_samples_) { return; }
+
+    // Pick light_samples_ lights with replacement, with probability
+    // proportional to their contribution. A light picked k times of n with
+    // probability p is scaled by k / (n p) and shaded once.
+    t_cumulative.resize(lights.size());
+    float total = 0.0f;
+    for(uint32_t i = 0; i < lights.size(); ++i)
+    {
+        const Color3 &c = lights[i].contribution;
+        total += c.r + c.g + c.b;
+        t_cumulative[i] = total;
+    }
+    std::vector<uint32_t> &picks = t_candidates;
+    picks.assign(lights.size(), 0);
+    float point[3] = {int_pt.x, int_pt.y, int_pt.z};
+    for(uint32_t s = 0; s < light_samples_; ++s)
+    {
+        float    u = hash_sample(point, 3, s + 1) * total;
+        uint32_t i = static_cast<uint32_t>(
+            std::upper_bound(t_cumulative.begin(), t_cumulative.end(), u) - t_cumulative.begin());
+        ++picks[std::min(i, static_cast<uint32_t>(lights.size()) - 1)];
+    }
+
+    uint32_t kept = 0;
+    float    previous = 0.0f;
+    for(uint32_t i = 0; i < lights.size(); ++i)
+    {
+        float weight = t_cumulative[i] - previous;
+        previous = t_cumulative[i];
+        if(picks[i] == 0) { continue; }
+        float scale = static_cast<float>(picks[i]) * total / (weight * static_cast<float>(light_samples_));
+        lights[kept].index = lights[i].index;
+        lights[kept].contribution = lights[i].contribution * scale;
+        ++kept;
+    }
+    lights.resize(kept);
+}
 
-bool RayTracer::in_shadow(const Point3 &int_pt, Point3 &light_pos, SceneNode *current_obj)
+void RayTracer::set_russian_roulette(bool enable) { russian_roulette_ = enable; }
+
+void RayTracer::set_pixel_spread(float angle) { pixel_spread_ = angle; }
+
+bool RayTracer::keep_ray(const Ray &ray, Color3 &weight) const
 {
+    if(!ray.below_threshold()) { return true; }
+
+    if(russian_roulette_)
+    {
+        // Survive with probability equal to the throughput's largest component
+        // relative to the threshold
+        const Color3 &throughput = ray.throughput_;
+        float         p = std::max(std::max(throughput.r, throughput.g), throughput.b) / ray.threshold_;
+        if(roulette_sample(ray) < p)
+        {
+            weight = weight * (1.0f / p);
+            return true;
+        }
+    }
+    COUNT_RAYS(terminated, 1);
+    return false;
+}
+
+RenderMetrics RayTracer::take_thread_metrics()
+{
+    RenderMetrics metrics;
+#ifdef RAY_COUNTS
+    metrics.rays = t_ray_counts;
+    t_ray_counts = RayCounts();
+#endif
+    metrics.tests = take_thread_trace_counters();
+    return metrics;
+}
+
+bool RayTracer::in_shadow(const Point3 &int_pt, uint32_t light, SceneNode *current_obj, uint32_t current_instance)
+{
+    COUNT_RAYS(shadow, 1);
+
     // Construct a shadow ray from the intersection point toward the light
-    Vector3 to_light(int_pt, light_pos);
+    Vector3 to_light(int_pt, lights_[light]->get_position());
     float   distance_to_light = to_light.norm();
     to_light.normalize();
 
@@ -180,11 +726,30 @@ bool RayTracer::in_shadow(const Point3 &int_pt, Point3 &light_pos, SceneNode *cu
     Ray3 shadow_ray(shadow_origin, to_light);
 
     // Set up scene state - store current object so convex objects can skip self-test
-    SceneState current_state;
+    RayTraversalState current_state;
     current_state.geometry_node = current_obj;
+    current_state.instance_index = current_instance;
+
+    if(!occluder_cache_) { return scene_bvh_.does_intersect_exist(shadow_ray, distance_to_light, current_state); }
+
+    // Try the last object that blocked a ray toward this light first
+    if(light >= t_occluders.size()) { t_occluders.resize(light + 1, NO_INSTANCE_INDEX); }
+    uint32_t &occluder = t_occluders[light];
+    if(occluder != NO_INSTANCE_INDEX)
+    {
+        COUNT_RAYS(occluder_tests, 1);
+        if(scene_bvh_.does_primitive_intersect(occluder, shadow_ray, distance_to_light, current_state))
+        {
+            COUNT_RAYS(occluder_hits, 1);
+            return true;
+        }
+    }
 
-    // Check if any object blocks the path to the light
-    return scene_root_->does_intersect_exist(shadow_ray, distance_to_light, current_state);
+    // Check if any object blocks the path to the light. Remember it for the
+    // next ray toward the light, or forget the cached one if nothing does
+    // since the next ray is then likely unblocked too.
+    occluder = NO_INSTANCE_INDEX;
+    return scene_bvh_.does_intersect_exist(shadow_ray, distance_to_light, current_state, &occluder);
 }
 
 } // namespace cg
@@ -12,9 +12,16 @@
 #ifndef __RAY_TRACER_RAY_TRACER_HPP__
 #define __RAY_TRACER_RAY_TRACER_HPP__
 
+#include "RayTracer/compiled_scene.hpp"
+#include "RayTracer/g_buffer.hpp"
+#include "RayTracer/light_bvh.hpp"
 #include "RayTracer/lighting.hpp"
 #include "RayTracer/procedural_texture.hpp"
 #include "RayTracer/ray.hpp"
+#include "RayTracer/ray_queue.hpp"
+#include "RayTracer/render_metrics.hpp"
+#include "RayTracer/scene_bvh.hpp"
+#include "geometry/ray_packet.hpp"
 #include "scene/geometry_node.hpp"
 #include "scene/light_node.hpp"
 
@@ -23,6 +30,15 @@
 namespace cg
 {
 
+/**
+ * Light chosen to shade a surface point, with its unshadowed contribution.
+ */
+struct LightSample
+{
+    uint32_t index;        // Index of the light
+    Color3   contribution; // Diffuse and specular contribution (scaled if sampled)
+};
+
 /**
  * Ray tracer class. Performs recursive ray tracing.
  */
@@ -30,49 +46,242 @@ class RayTracer
 {
   public:
     /**
-     * Constructor.
+     * Constructor. Compiles the scene and builds its acceleration structure.
      */
     RayTracer(std::shared_ptr<SceneNode> scene_root);
 
     ~RayTracer();
 
+    /**
+     * Recompile the scene and rebuild its acceleration structure if the
+     * scene graph has changed. If only transforms have changed the compiled
+     * transforms are updated and the top level BVH is refit instead. Must
+     * not be called while rays are traced.
+     * @return  Returns true if the scene was rebuilt or refit.
+     */
+    bool update_scene();
+
     /**
      * Initial call to trace a ray.
      */
     Color3 trace_ray(Ray3 &initial_ray, int depth, float adaptive_threshold);
 
     /**
-     * Recursive method to trace a ray
+     * Trace a packet of primary rays. The closest hits of all rays are found
+     * with one packet traversal; each ray is then shaded (and its reflected
+     * and refracted rays traced) on its own.
+     * @param  packet              Rays to trace.
+     * @param  depth               Maximum recursion depth.
+     * @param  adaptive_threshold  Attenuation below which recursion stops.
+     * @param  colors              (OUT) Color of each ray in the packet.
+     * @param  ids                 (OUT) Optional. Instance index of the object
+     *                             each ray hits (NO_INSTANCE_INDEX if none).
+     * @param  samples             (OUT) Optional. G-buffer sample of each ray.
+     */
+    void trace_packet(const RayPacket &packet,
+                      int              depth,
+                      float            adaptive_threshold,
+                      Color3          *colors,
+                      uint32_t        *ids = nullptr,
+                      GBufferSample   *samples = nullptr);
+
+    /**
+     * Trace a batch of primary rays breadth first. Each stage runs over the
+     * whole batch before the next: the rays of a level are intersected as
+     * packets, their hits are sorted by material and shaded, and the shadow
+     * rays of the level are tested. The shade stage queues the reflected and
+     * refracted rays of the next level. Colors match trace_packet.
+     * @param  rays                Primary rays to trace.
+     * @param  count               Number of rays.
+     * @param  depth               Maximum recursion depth.
+     * @param  adaptive_threshold  Attenuation below which recursion stops.
+     * @param  colors              (OUT) Color of each ray.
+     * @param  ids                 (OUT) Optional. Instance index of the object
+     *                             each ray hits (NO_INSTANCE_INDEX if none).
+     */
+    void trace_wavefront(const Ray3 *rays,
+                         uint32_t    count,
+                         int         depth,
+                         float       adaptive_threshold,
+                         Color3     *colors,
+                         uint32_t   *ids = nullptr);
+
+    /**
+     * Shade a primary hit recorded in a G-buffer with the current lights and
+     * materials, without tracing the primary ray. Cached shadow tests are
+     * reused; the rest are traced and cached. Reflected and refracted rays
+     * are traced as usual.
+     * @param  sample              G-buffer sample of the pixel.
+     * @param  depth               Maximum recursion depth.
+     * @param  adaptive_threshold  Attenuation below which recursion stops.
+     * @return Returns the color seen along the primary ray.
      */
-    Color3 trace_ray(Ray &ray);
+    Color3 reshade(GBufferSample &sample, int depth, float adaptive_threshold);
 
     /**
      * Set the view position (for lighting).
      */
     void set_view_position(const Point3 &pos);
 
+    /**
+     * Set how reflected and refracted rays whose throughput is below the
+     * adaptive threshold are handled. By default they are not traced. With
+     * Russian roulette each is traced with probability proportional to its
+     * throughput and its weight is scaled up to match, which keeps the
+     * expected color unchanged at the cost of noise.
+     * @param  enable  Enable Russian roulette.
+     */
+    void set_russian_roulette(bool enable);
+
+    /**
+     * Set the angle spanned by a pixel. Each ray carries a cone that starts
+     * at the camera with this spread angle and keeps it through reflection
+     * and refraction; the cone's width where a ray hits a textured surface
+     * selects the texture's mip level. With 0 (the default) textures are
+     * sampled at full resolution.
+     * @param  angle  Spread angle of a pixel in radians.
+     */
+    void set_pixel_spread(float angle);
+
     /**
      * Add a light to the ray tracer.
      * @param light  Pointer to the light node
      */
     void add_light(LightNode *light);
 
+    /**
+     * Rebuild the light hierarchy. Call after lights move or their color or
+     * attenuation changes. Must not be called while rays are traced.
+     */
+    void update_lights();
+
+    /**
+     * Set the number of lights sampled at each surface point. Lights that
+     * cannot reach a point are always culled. With 0 (the default) every
+     * remaining light is shaded with its own shadow ray. Otherwise, where
+     * more lights than this remain, this many are picked at random with
+     * probability proportional to their unshadowed contribution and their
+     * contribution is scaled to keep the expected color unchanged.
+     * @param  count  Number of lights sampled (0 for all).
+     */
+    void set_light_samples(uint32_t count);
+
+    /**
+     * Set whether shadow rays test the last occluder found toward their
+     * light before traversing the scene. Each thread remembers the last
+     * primitive that blocked a shadow ray toward each light; neighbouring
+     * points are usually blocked by the same one. On by default.
+     * @param  enable  Enable the occluder cache.
+     */
+    void set_occluder_cache(bool enable);
+
+    /**
+     * Get the rays traced by the calling thread (with any ray tracer) and
+     * the traversal and intersection tests they took since the last call,
+     * and reset the counts. Counting per thread keeps render threads from
+     * sharing a counter.
+     * @return  Returns the counts of this thread.
+     */
+    static RenderMetrics take_thread_metrics();
+
   private:
     Lighting                   lighting_;
     std::shared_ptr<SceneNode> scene_root_;
+    CompiledScene              compiled_scene_;
+    SceneBVH                   scene_bvh_;
     std::vector<LightNode *>   lights_;
+    LightBVH                   light_bvh_;
+    uint32_t                   light_samples_ = 0;
+    bool                       occluder_cache_ = true;
+    bool                       russian_roulette_ = false;
+    float                      pixel_spread_ = 0.0f;
 
     /**
      * Tests if the intersect point is in shadow with respect to the
-     * specified light position.
+     * specified light.
      * @param   int_pt       Intersection point
-     * @param   light_pos    Light position
+     * @param   light        Index of the light
      * @param   current_obj  Current object. If this object is convex we
      *                      can avoid a shadow computation.
+     * @param   current_instance  Instance of the current object that was hit.
+     *                      Other instances of the object are still tested.
      * @return  Returns true if there is an occluding object between
      *          the light and the intersect point, false if not.
      **/
-    bool in_shadow(const Point3 &int_pt, Point3 &light_pos, SceneNode *current_obj);
+    bool in_shadow(const Point3 &int_pt, uint32_t light, SceneNode *current_obj, uint32_t current_instance);
+
+    /**
+     * Shades the closest intersection of a ray, tracing reflected and
+     * refracted rays as needed.
+     * @param   ray      Ray that was traced.
+     * @param   closest  Closest intersection of the ray (geometry_node is null
+     *                   if nothing was hit).
+     * @param   sample   (OUT) Optional. G-buffer sample of the hit.
+     * @return  Returns the color seen along the ray.
+     */
+    Color3 shade(Ray &ray, RayTraversalState &closest, GBufferSample *sample = nullptr);
+
+    /**
+     * Shades a surface point once its normal is known.
+     * @param   ray       Ray that hit the surface, with its cone width at the
+     *                    surface.
+     * @param   int_pt    Intersection point.
+     * @param   normal    Unit normal at the intersection point.
+     * @param   material  Material of the surface (may be null).
+     * @param   object    Geometry hit.
+     * @param   instance  Instance of the geometry hit.
+     * @param   texture   Texture color modulating the local color (white if
+     *                    the surface is not textured).
+     * @param   sample    Optional. Shadow tests are reused from and cached in
+     *                    the sample.
+     * @return  Returns the color seen along the ray.
+     */
+    Color3 shade_surface(Ray           &ray,
+                         const Point3  &int_pt,
+                         const Vector3 &normal,
+                         MaterialNode  *material,
+                         GeometryNode  *object,
+                         uint32_t       instance,
+                         const Color3  &texture,
+                         GBufferSample *sample);
+
+    /**
+     * Shade stage of the wavefront tracer for one queued ray. Sets the local
+     * color of the ray's path node, queues a shadow ray for each light that
+     * can reach the surface, and queues the reflected and refracted rays.
+     * @param   state               Wavefront queues and path nodes.
+     * @param   index               Ray within the current queue.
+     * @param   adaptive_threshold  Attenuation below which recursion stops.
+     */
+    void shade_queued(WavefrontState &state, uint32_t index, float adaptive_threshold);
+
+    /**
+     * Decide whether a reflected or refracted ray is traced. Rays below the
+     * adaptive threshold are dropped, or with Russian roulette kept at
+     * random. Dropped rays are counted as terminated.
+     * @param   ray     Reflected or refracted ray (throughput includes weight).
+     * @param   weight  (IN/OUT) Weight of the ray's color. Scaled by the
+     *                  inverse of the survival probability if kept at random.
+     * @return  Returns true if the ray is to be traced.
+     */
+    bool keep_ray(const Ray &ray, Color3 &weight) const;
+
+    /**
+     * Find the lights to shade a surface point with. Lights that cannot
+     * reach the point or contribute nothing to it are left out; the rest
+     * are sampled if there are more than light_samples_.
+     * @param   int_pt    Intersection point.
+     * @param   normal    Unit normal at the intersection point.
+     * @param   material  Material of the surface.
+     * @param   lights    (OUT) Lights to shade with, in increasing index order.
+     */
+    void gather_lights(const Point3             &int_pt,
+                       const Vector3            &normal,
+                       const MaterialNode       *material,
+                       std::vector<LightSample> &lights) const;
+
+    // Finds the closest intersection of a ray and shades it
+    Color3 trace_closest(Ray &ray);
 };
 
 } // namespace cg
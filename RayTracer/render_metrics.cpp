@@ -0,0 +1,55 @@
+#include "RayTracer/render_metrics.hpp"
+
+#include "common/logging.hpp"
+
+namespace cg
+{
+
+void RenderMetrics::write_json(std::ostream &out) const
+{
+    out << "{\"rays\": {\"enabled\": " << (RAY_COUNTS_ENABLED ? "true" : "false")
+        << ", \"primary\": " << rays.primary << ", \"reflection\": " << rays.reflection
+        << ", \"refraction\": " << rays.refraction << ", \"shadow\": " << rays.shadow
+        << ", \"terminated\": " << rays.terminated << "}, \"occluder_cache\": {\"tests\": "
+        << rays.occluder_tests << ", \"hits\": " << rays.occluder_hits << "}, \"tests\": {\"enabled\": "
+        << (TRACE_COUNTERS_ENABLED ? "true" : "false") << ", \"node_visits\": " << tests.node_visits
+        << ", \"aabb\": " << tests.aabb_tests << ", \"sphere\": " << tests.sphere_tests
+        << ", \"quad\": " << tests.quad_tests << ", \"triangle\": " << tests.triangle_tests
+        << ", \"hits\": " << tests.hits << ", \"early_outs\": " << tests.early_outs << "}}";
+}
+
+void RenderMetrics::log(const char *label, double wall_ms) const
+{
+    if(!RAY_COUNTS_ENABLED) { log_msg("%s: %.1f ms", label, wall_ms); }
+    else
+    {
+        log_msg("%s: %.1f ms, rays %llu primary, %llu reflection, %llu refraction, %llu shadow, "
+                "%llu terminated",
+                label,
+                wall_ms,
+                static_cast<unsigned long long>(rays.primary),
+                static_cast<unsigned long long>(rays.reflection),
+                static_cast<unsigned long long>(rays.refraction),
+                static_cast<unsigned long long>(rays.shadow),
+                static_cast<unsigned long long>(rays.terminated));
+        log_msg("%s: occluder cache %llu tests, %llu hits (%.1f%%)",
+                label,
+                static_cast<unsigned long long>(rays.occluder_tests),
+                static_cast<unsigned long long>(rays.occluder_hits),
+                100.0 * rays.occluder_hit_rate());
+    }
+    if(!TRACE_COUNTERS_ENABLED) { return; }
+
+    log_msg("%s: %llu node visits, tests %llu AABB, %llu sphere, %llu quad, %llu triangle, %llu hits, "
+            "%llu early outs",
+            label,
+            static_cast<unsigned long long>(tests.node_visits),
+            static_cast<unsigned long long>(tests.aabb_tests),
+            static_cast<unsigned long long>(tests.sphere_tests),
+            static_cast<unsigned long long>(tests.quad_tests),
+            static_cast<unsigned long long>(tests.triangle_tests),
+            static_cast<unsigned long long>(tests.hits),
+            static_cast<unsigned long long>(tests.early_outs));
+}
+
+} // namespace cg
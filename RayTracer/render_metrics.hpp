@@ -0,0 +1,100 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    render_metrics.hpp
+//	Purpose: Counts of the rays traced and of the traversal and intersection
+//           work they caused, merged from the render threads and reported
+//           once per frame.
+//============================================================================
+
+#ifndef __RAY_TRACER_RENDER_METRICS_HPP__
+#define __RAY_TRACER_RENDER_METRICS_HPP__
+
+#include "geometry/trace_counters.hpp"
+
+#include <cstdint>
+#include <ostream>
+
+namespace cg
+{
+
+/**
+ * Number of rays traced, by kind.
+ */
+struct RayCounts
+{
+    uint64_t primary = 0;        // Camera rays
+    uint64_t reflection = 0;     // Reflected rays
+    uint64_t refraction = 0;     // Refracted rays (and their total internal reflections)
+    uint64_t shadow = 0;         // Shadow rays
+    uint64_t terminated = 0;     // Reflected and refracted rays dropped below the threshold
+    uint64_t occluder_tests = 0; // Shadow rays first tested against a cached occluder
+    uint64_t occluder_hits = 0;  // Shadow rays blocked by the cached occluder
+
+    /**
+     * Get the number of reflected and refracted rays.
+     */
+    uint64_t secondary() const { return reflection + refraction; }
+
+    /**
+     * Get the fraction of cached occluder tests that found the ray blocked.
+     */
+    double occluder_hit_rate() const
+    {
+        return occluder_tests > 0 ? static_cast<double>(occluder_hits) / occluder_tests : 0.0;
+    }
+
+    RayCounts &operator+=(const RayCounts &counts)
+    {
+        primary += counts.primary;
+        reflection += counts.reflection;
+        refraction += counts.refraction;
+        shadow += counts.shadow;
+        terminated += counts.terminated;
+        occluder_tests += counts.occluder_tests;
+        occluder_hits += counts.occluder_hits;
+        return *this;
+    }
+};
+
+#ifdef RAY_COUNTS
+constexpr bool RAY_COUNTS_ENABLED = true;
+#else
+constexpr bool RAY_COUNTS_ENABLED = false;
+#endif
+
+/**
+ * Rays traced and the work done to trace them. Ray counts are zero unless
+ * RAY_COUNTS is defined (CMake option ENABLE_RAY_COUNTS), and the traversal
+ * and test counts are zero unless RENDER_METRICS is defined.
+ */
+struct RenderMetrics
+{
+    RayCounts     rays;
+    TraceCounters tests;
+
+    RenderMetrics &operator+=(const RenderMetrics &metrics)
+    {
+        rays += metrics.rays;
+        tests += metrics.tests;
+        return *this;
+    }
+
+    /**
+     * Write the counts as a single line JSON object.
+     * @param  out  Stream to write to.
+     */
+    void write_json(std::ostream &out) const;
+
+    /**
+     * Write the counts to the log.
+     * @param  label    Label of the log line (e.g. the frame).
+     * @param  wall_ms  Time taken to render in milliseconds.
+     */
+    void log(const char *label, double wall_ms) const;
+};
+
+} // namespace cg
+
+#endif
@@ -1,5 +1,7 @@
 #include "RayTracer/rt_mesh_node.hpp"
+#include "common/logging.hpp"
 #include "geometry/geometry.hpp"
+#include "geometry/trace_counters.hpp"
 
 #include <cmath>
 
@@ -8,15 +10,15 @@ namespace cg
 
 RTMeshNode::RTMeshNode(const std::vector<VertexAndNormal> &vertices,
                        const std::vector<uint16_t> &faces)
-    : vertices_(vertices), faces_(faces), last_face_index_(0),
-      last_bary_u_(0), last_bary_v_(0)
+    : vertices_(vertices), faces_(faces)
 {
     build_aabb();
+    build_bvh();
 }
 
 RTMeshNode::RTMeshNode(const std::vector<Point3> &vertices,
                        const std::vector<uint16_t> &faces)
-    : faces_(faces), last_face_index_(0), last_bary_u_(0), last_bary_v_(0)
+    : faces_(faces)
 {
     // Convert Point3 to VertexAndNormal
     vertices_.resize(vertices.size());
@@ -27,6 +29,7 @@ RTMeshNode::RTMeshNode(const std::vector<Point3> &vertices,
     }
     compute_normals();
     build_aabb();
+    build_bvh();
 }
 
 void RTMeshNode::compute_normals()
@@ -86,16 +89,75 @@ void RTMeshNode::build_aabb()
     aabb_ = AABB(min_pt, max_pt);
 }
 
-Vector3 RTMeshNode::get_normal(const Point3 &int_pt)
+void RTMeshNode::build_bvh()
+{
+    const size_t num_faces = faces_.size() / 3;
+    std::vector<AABB> tri_bounds(num_faces);
+    for (size_t f = 0; f < num_faces; ++f)
+    {
+        tri_bounds[f] = AABB({vertices_[faces_[f * 3]].vertex,
+                              vertices_[faces_[f * 3 + 1]].vertex,
+                              vertices_[faces_[f * 3 + 2]].vertex});
+    }
+    // Leaves up to a block in size are made so one SIMD test covers a leaf
+    bvh_.build(tri_bounds, TRIANGLE_BLOCK_SIZE);
+
+    // Store the faces in leaf order so each leaf covers a contiguous range
+    std::vector<uint16_t> ordered_faces;
+    ordered_faces.reserve(faces_.size());
+    for (uint32_t f : bvh_.get_primitive_indices())
+    {
+        ordered_faces.push_back(faces_[f * 3]);
+        ordered_faces.push_back(faces_[f * 3 + 1]);
+        ordered_faces.push_back(faces_[f * 3 + 2]);
+    }
+    faces_.swap(ordered_faces);
+
+    // Pack the triangles of each leaf into blocks. The face index of a slot is
+    // the leaf slot, which indexes faces_ directly.
+    blocks_.clear();
+    leaf_first_block_.assign(num_faces, 0);
+    for (const BVHNode &node : bvh_.get_nodes())
+    {
+        if (!node.is_leaf())
+        {
+            continue;
+        }
+
+        leaf_first_block_[node.offset] = static_cast<uint32_t>(blocks_.size());
+        for (uint32_t f = node.offset; f < node.offset + node.primitive_count; ++f)
+        {
+            if (f == node.offset || blocks_.back().full())
+            {
+                blocks_.emplace_back();
+            }
+            blocks_.back().add(vertices_[faces_[f * 3]].vertex,
+                               vertices_[faces_[f * 3 + 1]].vertex,
+                               vertices_[faces_[f * 3 + 2]].vertex,
+                               f);
+        }
+    }
+
+    const BVHBuildStats &stats = bvh_.get_build_stats();
+    log_msg("RTMeshNode BVH: %u triangles, %u nodes, %u leaves, %u blocks, depth %u, built in %.3f ms",
+            stats.primitive_count,
+            stats.node_count,
+            stats.leaf_count,
+            static_cast<uint32_t>(blocks_.size()),
+            stats.max_depth,
+            stats.build_time_ms);
+}
+
+Vector3 RTMeshNode::get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Interpolate vertex normals using barycentric coordinates
-    uint16_t i0 = faces_[last_face_index_ * 3];
-    uint16_t i1 = faces_[last_face_index_ * 3 + 1];
-    uint16_t i2 = faces_[last_face_index_ * 3 + 2];
+    uint16_t i0 = faces_[hit.face_index * 3];
+    uint16_t i1 = faces_[hit.face_index * 3 + 1];
+    uint16_t i2 = faces_[hit.face_index * 3 + 2];
 
-    float w0 = 1.0f - last_bary_u_ - last_bary_v_;
-    float w1 = last_bary_u_;
-    float w2 = last_bary_v_;
+    float w0 = 1.0f - hit.barycentric_u - hit.barycentric_v;
+    float w1 = hit.barycentric_u;
+    float w2 = hit.barycentric_v;
 
     Vector3 n = vertices_[i0].normal * w0 +
                 vertices_[i1].normal * w1 +
@@ -104,58 +166,117 @@ Vector3 RTMeshNode::get_normal(const Point3 &int_pt)
     return n;
 }
 
-Point2 RTMeshNode::get_texture_coord(const Point3 &int_pt)
+Point2 RTMeshNode::get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Simple planar mapping using barycentric coordinates
     // Maps u,v barycentric to s,t texture coords
-    return Point2(last_bary_u_, last_bary_v_);
+    return Point2(hit.barycentric_u, hit.barycentric_v);
 }
 
-void RTMeshNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+float RTMeshNode::get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
-    // First check AABB
-    RayObjectIntersectResult aabb_result = ray.intersect(aabb_);
-    if (!aabb_result.intersects)
-    {
-        return;  // Ray misses bounding box, skip all triangles
-    }
+    const Point3 &p0 = vertices_[faces_[hit.face_index * 3]].vertex;
+    const Point3 &p1 = vertices_[faces_[hit.face_index * 3 + 1]].vertex;
+    const Point3 &p2 = vertices_[faces_[hit.face_index * 3 + 2]].vertex;
+    float area = 0.5f * Vector3(p0, p1).cross(Vector3(p0, p2)).norm();
+    return area > 0.0f ? std::sqrt(0.5f / area) : 0.0f;
+}
 
-    // Test all triangles
-    for (size_t i = 0; i < faces_.size(); i += 3)
-    {
-        uint16_t i0 = faces_[i];
-        uint16_t i1 = faces_[i + 1];
-        uint16_t i2 = faces_[i + 2];
+AABB RTMeshNode::get_bounding_box() const { return aabb_; }
 
-        const Point3 &v0 = vertices_[i0].vertex;
-        const Point3 &v1 = vertices_[i1].vertex;
-        const Point3 &v2 = vertices_[i2].vertex;
+void RTMeshNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
+{
+    // Block face indices are leaf slots, which index faces_ directly since
+    // faces are stored in BVH order
+    float t_max = closest.t_min;
+    bvh_.find_closest(ray, t_max, [&](uint32_t first, uint32_t count, float &t) {
+        uint32_t end = leaf_first_block_[first] + (count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE;
+        for (uint32_t b = leaf_first_block_[first]; b < end; ++b)
+        {
+            COUNT_TRACE(triangle_tests, blocks_[b].count);
+            RayMeshIntersectResult result = ray.intersect(blocks_[b], closest.t_min);
 
-        RayTriangleIntersectResult result = ray.intersect(v0, v1, v2);
+            if (result.intersects)
+            {
+                COUNT_TRACE(hits, 1);
+                closest.t_min = result.distance;
+                closest.geometry_node = this;
+                closest.material_node = current_state.material_node;
+                closest.texture_node = current_state.texture_node;
+
+                // Record the face and barycentric coords in the hit so the normal
+                // and texture coordinate can be interpolated later
+                closest.hit.face_index = result.face_index;
+                closest.hit.barycentric_u = result.barycentric_u;
+                closest.hit.barycentric_v = result.barycentric_v;
+
+                closest.transform_required = current_state.transform_required;
+                if (current_state.transform_required)
+                {
+                    closest.inverse_matrix = current_state.inverse_matrix;
+                    closest.normal_matrix = current_state.normal_matrix;
+                }
+            }
+        }
+        t = closest.t_min;
+    });
+}
 
-        if (result.intersects && result.distance > EPSILON && result.distance < closest.t_min)
+void RTMeshNode::find_closest_intersect_packet(const RayPacket   &packet,
+                                               const SimdMask    &mask,
+                                               RayTraversalState &current_state,
+                                               PacketHit         &closest)
+{
+    // Lanes outside the mask get a negative distance so they never enter a node
+    SimdFloat t_max = select(mask, closest.get_t_min(), SimdFloat(-1.0f));
+    bvh_.find_closest(packet, t_max, [&](uint32_t first, uint32_t count, const SimdMask &lanes, SimdFloat &t) {
+        const TriangleBlock *block = &blocks_[leaf_first_block_[first]];
+        COUNT_TRACE(triangle_tests, count);
+        for (uint32_t i = 0; i < count; ++i)
         {
-            closest.t_min = result.distance;
-            closest.geometry_node = this;
-            closest.material_node = current_state.material_node;
-            closest.texture_node = current_state.texture_node;
+            // Rays are spread across the lanes here, so the block is read one
+            // triangle at a time using its precomputed edges
+            uint32_t slot = i % TRIANGLE_BLOCK_SIZE;
+            if (i > 0 && slot == 0)
+            {
+                ++block;
+            }
 
-            // Store barycentric coords for normal/texcoord interpolation
-            last_face_index_ = i / 3;
-            last_bary_u_ = result.barycentric_u;
-            last_bary_v_ = result.barycentric_v;
+            SimdFloat t_hit, u, v;
+            SimdMask  hit = packet.intersect(block->get_v0(slot),
+                                             block->get_edge1(slot),
+                                             block->get_edge2(slot),
+                                             t_hit, u, v) & lanes;
+            hit = hit & (t_hit > SimdFloat(EPSILON)) & (t_hit < t);
 
-            if (current_state.transform_required)
+            uint32_t hit_lanes = hit.bits();
+            if (hit_lanes == 0)
             {
-                closest.transform_required = true;
-                closest.inverse_matrix = current_state.inverse_matrix;
-                closest.normal_matrix = current_state.normal_matrix;
+                continue;
+            }
+
+            COUNT_TRACE(hits, 1);
+            t = select(hit, t_hit, t);
+            closest.record(hit_lanes, t_hit, this, current_state);
+
+            // Record the face and barycentric coords of each lane that hit
+            float u_lanes[SIMD_WIDTH], v_lanes[SIMD_WIDTH];
+            u.store(u_lanes);
+            v.store(v_lanes);
+            for (uint32_t lane = 0; lane < SIMD_WIDTH; ++lane)
+            {
+                if (hit_lanes & (1u << lane))
+                {
+                    closest.face_index[lane] = block->face_index[slot];
+                    closest.barycentric_u[lane] = u_lanes[lane];
+                    closest.barycentric_v[lane] = v_lanes[lane];
+                }
             }
         }
-    }
+    });
 }
 
-bool RTMeshNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state)
+bool RTMeshNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
 {
     // Skip self-intersection
     if (this == current_state.geometry_node)
@@ -163,33 +284,18 @@ bool RTMeshNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_sta
         return false;
     }
 
-    // First check AABB
-    RayObjectIntersectResult aabb_result = ray.intersect(aabb_);
-    if (!aabb_result.intersects || aabb_result.distance > d)
-    {
-        return false;  // Ray misses bounding box or box is beyond distance
-    }
-
-    // Test all triangles
-    for (size_t i = 0; i < faces_.size(); i += 3)
-    {
-        uint16_t i0 = faces_[i];
-        uint16_t i1 = faces_[i + 1];
-        uint16_t i2 = faces_[i + 2];
-
-        const Point3 &v0 = vertices_[i0].vertex;
-        const Point3 &v1 = vertices_[i1].vertex;
-        const Point3 &v2 = vertices_[i2].vertex;
-
-        RayTriangleIntersectResult result = ray.intersect(v0, v1, v2);
-
-        if (result.intersects && result.distance > EPSILON && result.distance < d)
+    return bvh_.any_hit(ray, d, [&](uint32_t first, uint32_t count) {
+        uint32_t end = leaf_first_block_[first] + (count + TRIANGLE_BLOCK_SIZE - 1) / TRIANGLE_BLOCK_SIZE;
+        for (uint32_t b = leaf_first_block_[first]; b < end; ++b)
         {
-            return true;  // Found an intersection, early exit
+            COUNT_TRACE(triangle_tests, blocks_[b].count);
+            if (ray.does_intersect_exist(blocks_[b], d))
+            {
+                return true;  // Found an intersection, early exit
+            }
         }
-    }
-
-    return false;
+        return false;
+    });
 }
 
 bool RTMeshNode::is_convex(void) const
@@ -3,7 +3,7 @@
 //	605.767 Applied Computer Graphics
 //
 //	File:    rt_mesh_node.hpp
-//	Purpose: Triangle mesh for use in ray tracing with AABB bounding volume.
+//	Purpose: Triangle mesh for use in ray tracing with a triangle BVH.
 //============================================================================
 
 #ifndef __RAY_TRACER_RT_MESH_NODE_HPP__
@@ -13,6 +13,8 @@
 #include "geometry/vector3.hpp"
 #include "geometry/ray3.hpp"
 #include "geometry/aabb.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/triangle_block.hpp"
 #include "geometry/types.hpp"
 #include "scene/geometry_node.hpp"
 
@@ -22,7 +24,9 @@ namespace cg
 {
 
 /**
- * Triangle mesh for ray tracing with AABB bounding volume.
+ * Triangle mesh for ray tracing. A BVH over the triangles is built when the
+ * node is constructed and is used for closest hit and shadow queries. The
+ * triangles of each leaf are also stored in SIMD friendly triangle blocks.
  */
 class RTMeshNode : public GeometryNode
 {
@@ -45,29 +49,54 @@ class RTMeshNode : public GeometryNode
 
     /**
      * Gets the normal at the intersection point.
-     * Uses the stored intersection face to interpolate vertex normals.
+     * Uses the face recorded in the hit to interpolate vertex normals.
      * @param   int_pt  Intersection point
+     * @param   hit     Surface interaction holding the face and barycentric coordinates
      * @return  Returns a unit length normal at the intersection point.
      */
-    Vector3 get_normal(const Point3 &int_pt) override;
+    Vector3 get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
 
     /**
      * Get the texture coordinate at an intersection point.
      * Uses barycentric interpolation.
      * @param  int_pt  Intersection point on the mesh surface
+     * @param  hit     Surface interaction holding the face and barycentric coordinates
      * @return Returns the texture coordinate (s, t) at the intersection point
      */
-    Point2 get_texture_coord(const Point3 &int_pt) override;
+    Point2 get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the change in texture coordinate per unit length. The barycentric
+     * coordinates cover an area of 1/2 over the face that was hit.
+     * @param  int_pt  Intersection point on the mesh surface
+     * @param  hit     Surface interaction holding the face
+     * @return Returns the change in texture coordinate per unit length.
+     */
+    float get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the bounding box of the mesh.
+     * @return Returns the box enclosing all vertices.
+     */
+    AABB get_bounding_box() const override;
 
     /**
      * Ray tracing intersect method - finds closest intersection
      */
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
+
+    /**
+     * Packet intersect method - finds the closest intersection of each lane
+     */
+    void find_closest_intersect_packet(const RayPacket   &packet,
+                                       const SimdMask    &mask,
+                                       RayTraversalState &current_state,
+                                       PacketHit         &closest) override;
 
     /**
      * Ray tracing intersect method - checks if intersection exists within distance d
      */
-    bool does_intersect_exist(Ray3 ray, float d, SceneState &current_state) override;
+    bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) override;
 
     /**
      * Meshes are generally not convex.
@@ -79,14 +108,21 @@ class RTMeshNode : public GeometryNode
      */
     const AABB& get_aabb() const { return aabb_; }
 
+    /**
+     * Get statistics (node count, build time) of the triangle BVH.
+     */
+    const BVHBuildStats &get_bvh_stats() const { return bvh_.get_build_stats(); }
+
   private:
     std::vector<VertexAndNormal> vertices_;
     std::vector<uint16_t> faces_;
     AABB aabb_;
+    BVH  bvh_;
 
-    // Store last intersection info for normal/texcoord computation
-    mutable uint32_t last_face_index_;
-    mutable float last_bary_u_, last_bary_v_;
+    // Triangle blocks in leaf order. Blocks never span two leaves; the first
+    // block of a leaf is found from the leaf's first slot.
+    std::vector<TriangleBlock> blocks_;
+    std::vector<uint32_t>      leaf_first_block_;
 
     /**
      * Compute vertex normals from face normals (for simple constructor)
@@ -97,6 +133,12 @@ class RTMeshNode : public GeometryNode
      * Build the AABB from vertices
      */
     void build_aabb();
+
+    /**
+     * Build the triangle BVH. Reorders faces_ so BVH leaves reference
+     * contiguous triangles, then packs each leaf into triangle blocks.
+     */
+    void build_bvh();
 };
 
 } // namespace cg
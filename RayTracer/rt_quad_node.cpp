@@ -1,5 +1,6 @@
 #include "RayTracer/rt_quad_node.hpp"
 #include "geometry/geometry.hpp"
+#include "geometry/trace_counters.hpp"
 
 namespace cg
 {
@@ -41,12 +42,12 @@ bool RTQuadNode::intersect(const Ray3 &ray, float &t) const
     return false;
 }
 
-Vector3 RTQuadNode::get_normal(const Point3 &int_pt)
+Vector3 RTQuadNode::get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     return normal_;
 }
 
-Point2 RTQuadNode::get_texture_coord(const Point3 &int_pt)
+Point2 RTQuadNode::get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Project intersection point onto the quad's local coordinate system
     // Use bilinear interpolation
@@ -73,21 +74,32 @@ Point2 RTQuadNode::get_texture_coord(const Point3 &int_pt)
     return Point2(s, t);
 }
 
-void RTQuadNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+float RTQuadNode::get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const
+{
+    float u_len = Vector3(v0_, v1_).norm();
+    float v_len = Vector3(v0_, v3_).norm();
+    return 1.0f / std::sqrt(u_len * v_len);
+}
+
+AABB RTQuadNode::get_bounding_box() const { return AABB({v0_, v1_, v2_, v3_}); }
+
+void RTQuadNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     float t;
+    COUNT_TRACE(quad_tests, 1);
     if (intersect(ray, t))
     {
         if (t < closest.t_min)
         {
+            COUNT_TRACE(hits, 1);
             closest.t_min = t;
             closest.geometry_node = this;
             closest.material_node = current_state.material_node;
             closest.texture_node = current_state.texture_node;
 
+            closest.transform_required = current_state.transform_required;
             if (current_state.transform_required)
             {
-                closest.transform_required = true;
                 closest.inverse_matrix = current_state.inverse_matrix;
                 closest.normal_matrix = current_state.normal_matrix;
             }
@@ -95,15 +107,40 @@ void RTQuadNode::find_closest_intersect(Ray3 ray, SceneState &current_state, Sce
     }
 }
 
-bool RTQuadNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state)
+void RTQuadNode::find_closest_intersect_packet(const RayPacket   &packet,
+                                               const SimdMask    &mask,
+                                               RayTraversalState &current_state,
+                                               PacketHit         &closest)
+{
+    // Same two triangles as intersect(): the second is only used by lanes
+    // that miss the first
+    COUNT_TRACE(quad_tests, 1);
+    SimdFloat t1, t2, u, v;
+    SimdMask  hit1 = packet.intersect(v0_, v1_, v2_, t1, u, v) & mask;
+    SimdMask  hit2 = packet.intersect(v0_, v2_, v3_, t2, u, v) & mask;
+    hit1 = hit1 & (t1 > SimdFloat(EPSILON));
+    hit2 = andnot(hit2 & (t2 > SimdFloat(EPSILON)), hit1);
+
+    SimdFloat t = select(hit1, t1, t2);
+    SimdMask  hit = (hit1 | hit2) & (t < closest.get_t_min());
+    if (any(hit))
+    {
+        COUNT_TRACE(hits, 1);
+        closest.record(hit.bits(), t, this, current_state);
+    }
+}
+
+bool RTQuadNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
 {
     // Skip self-intersection for convex objects
     if (this == current_state.geometry_node)
     {
+        COUNT_TRACE(early_outs, 1);
         return false;
     }
 
     float t;
+    COUNT_TRACE(quad_tests, 1);
     if (intersect(ray, t))
     {
         return (t > EPSILON && t < d);
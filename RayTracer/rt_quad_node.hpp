@@ -36,27 +36,52 @@ class RTQuadNode : public GeometryNode
     /**
      * Gets the normal to the quad (same everywhere since it's planar)
      * @param   int_pt  Intersection point (not used, normal is constant)
+     * @param   hit     Surface interaction (not used)
      * @return  Returns a unit length normal.
      */
-    Vector3 get_normal(const Point3 &int_pt) override;
+    Vector3 get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
 
     /**
      * Get the texture coordinate at an intersection point.
      * Uses bilinear interpolation based on position within quad.
      * @param  int_pt  Intersection point on the quad surface
+     * @param  hit     Surface interaction (not used)
      * @return Returns the texture coordinate (s, t) at the intersection point
      */
-    Point2 get_texture_coord(const Point3 &int_pt) override;
+    Point2 get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the change in texture coordinate per unit length: the geometric
+     * mean of the rates along the two edges.
+     * @param  int_pt  Intersection point (not used, the rate is constant)
+     * @param  hit     Surface interaction (not used)
+     * @return Returns the change in texture coordinate per unit length.
+     */
+    float get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the bounding box of the quad.
+     * @return Returns the box enclosing the 4 corners.
+     */
+    AABB get_bounding_box() const override;
 
     /**
      * Ray tracing intersect method - finds closest intersection
      */
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
+
+    /**
+     * Packet intersect method - finds the closest intersection of each lane
+     */
+    void find_closest_intersect_packet(const RayPacket   &packet,
+                                       const SimdMask    &mask,
+                                       RayTraversalState &current_state,
+                                       PacketHit         &closest) override;
 
     /**
      * Ray tracing intersect method - checks if intersection exists within distance d
      */
-    bool does_intersect_exist(Ray3 ray, float d, SceneState &current_state) override;
+    bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) override;
 
     /**
      * Quads are convex.
@@ -2,6 +2,7 @@
 
 #include "geometry/geometry.hpp"
 #include "geometry/point2.hpp"
+#include "geometry/trace_counters.hpp"
 
 #include <cmath>
 
@@ -19,7 +20,7 @@ RayObjectIntersectResult RTSphereNode::intersect(const Ray3 &ray) const
     return ray.intersect(sphere_);
 }
 
-Vector3 RTSphereNode::get_normal(const Point3 &int_pt)
+Vector3 RTSphereNode::get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // For a sphere, the normal at any point is the vector from the center to that point
     Vector3 normal(sphere_.center, int_pt);
@@ -27,7 +28,7 @@ Vector3 RTSphereNode::get_normal(const Point3 &int_pt)
     return normal;
 }
 
-Point2 RTSphereNode::get_texture_coord(const Point3 &int_pt)
+Point2 RTSphereNode::get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Use spherical mapping to convert 3D point to texture coordinates
     // First get the normalized vector from center to intersection point
@@ -54,9 +55,22 @@ Point2 RTSphereNode::get_texture_coord(const Point3 &int_pt)
     return Point2(s, t);
 }
 
-void RTSphereNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+float RTSphereNode::get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const
+{
+    return 1.0f / (std::sqrt(2.0f) * PI * sphere_.radius);
+}
+
+AABB RTSphereNode::get_bounding_box() const
+{
+    const Point3 &c = sphere_.center;
+    const float   r = sphere_.radius;
+    return AABB(Point3(c.x - r, c.y - r, c.z - r), Point3(c.x + r, c.y + r, c.z + r));
+}
+
+void RTSphereNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     // This is a leaf node - test for intersection with the sphere
+    COUNT_TRACE(sphere_tests, 1);
     RayObjectIntersectResult result = intersect(ray);
 
     // Check if there's a valid intersection
@@ -66,15 +80,16 @@ void RTSphereNode::find_closest_intersect(Ray3 ray, SceneState &current_state, S
         if(result.distance < closest.t_min)
         {
             // Update closest intersection information
+            COUNT_TRACE(hits, 1);
             closest.t_min = result.distance;
             closest.geometry_node = this;
             closest.material_node = current_state.material_node;
             closest.texture_node = current_state.texture_node;
 
             // Copy transformation matrices if transforms are required
+            closest.transform_required = current_state.transform_required;
             if(current_state.transform_required)
             {
-                closest.transform_required = true;
                 closest.inverse_matrix = current_state.inverse_matrix;
                 closest.normal_matrix = current_state.normal_matrix;
             }
@@ -82,15 +97,36 @@ void RTSphereNode::find_closest_intersect(Ray3 ray, SceneState &current_state, S
     }
 }
 
-bool RTSphereNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state)
+void RTSphereNode::find_closest_intersect_packet(const RayPacket   &packet,
+                                                 const SimdMask    &mask,
+                                                 RayTraversalState &current_state,
+                                                 PacketHit         &closest)
+{
+    COUNT_TRACE(sphere_tests, 1);
+    SimdFloat t;
+    SimdMask  hit = packet.intersect(sphere_, t) & mask;
+    hit = hit & (t > SimdFloat(EPSILON)) & (t < closest.get_t_min());
+    if(any(hit))
+    {
+        COUNT_TRACE(hits, 1);
+        closest.record(hit.bits(), t, this, current_state);
+    }
+}
+
+bool RTSphereNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
 {
     // This should be a leaf node - test for intersection
 
     // Spheres are convex - we can skip checking the current
     // object since convex objects cannot shadow themselves.
-    if(this == current_state.geometry_node) { return false; }
+    if(this == current_state.geometry_node)
+    {
+        COUNT_TRACE(early_outs, 1);
+        return false;
+    }
 
     // Check if object is between ray start and light position
+    COUNT_TRACE(sphere_tests, 1);
     RayObjectIntersectResult result = intersect(ray);
 
     // Return true if there's an intersection between the ray origin and the light
@@ -45,28 +45,54 @@ class RTSphereNode : public GeometryNode
     /**
      * Gets the normal to the sphere at the intersect point
      * @param   int_pt  Intersection point with the sphere
+     * @param   hit     Surface interaction (not used)
      * @return  Returns a unit length normal at the intersection point.
      */
-    Vector3 get_normal(const Point3 &int_pt) override;
+    Vector3 get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
 
     /**
      * Get the texture coordinate at an intersection point using spherical mapping.
      * @param  int_pt  Intersection point on the sphere surface
+     * @param  hit     Surface interaction (not used)
      * @return Returns the texture coordinate (s, t) at the intersection point
      */
-    Point2 get_texture_coord(const Point3 &int_pt) override;
+    Point2 get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the change in texture coordinate per unit length: the geometric
+     * mean of the rates at the equator, where t changes by 1 from pole to
+     * pole and s by 1 around the sphere.
+     * @param  int_pt  Intersection point on the sphere surface
+     * @param  hit     Surface interaction (not used)
+     * @return Returns the change in texture coordinate per unit length.
+     */
+    float get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const override;
+
+    /**
+     * Get the bounding box of the sphere.
+     * @return Returns the box enclosing the sphere.
+     */
+    AABB get_bounding_box() const override;
 
     /**
      * Ray tracing intersect method
      */
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
+
+    /**
+     * Packet intersect method - finds the closest intersection of each lane
+     */
+    void find_closest_intersect_packet(const RayPacket   &packet,
+                                       const SimdMask    &mask,
+                                       RayTraversalState &current_state,
+                                       PacketHit         &closest) override;
 
     /**
      * Ray tracing intersect method - checks if an object in the scene graph
      * intersects the ray along the specified distance. Can return true if any
      * object intersects.
      */
-    bool does_intersect_exist(Ray3 ray, float d, SceneState &current_state) override;
+    bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) override;
 
     /**
      * Spheres are always convex.
@@ -0,0 +1,193 @@
+#include "RayTracer/scene_bvh.hpp"
+
+#include "common/logging.hpp"
+
+namespace cg
+{
+
+namespace
+{
+
+/**
+ * Transform a world space ray to object space. The direction is renormalized
+ * (geometry tests assume unit directions), so object space distances are
+ * t_scale times world space distances.
+ */
+Ray3 to_object_space(const Ray3 &ray, const CompiledTransform &transform, float &t_scale)
+{
+    Ray3 local = transform.inverse_matrix * ray;
+    t_scale = local.d.norm();
+    local.d.normalize();
+    return local;
+}
+
+} // namespace
+
+SceneBVH::SceneBVH() : scene_(nullptr) {}
+
+void SceneBVH::build(const CompiledScene &scene)
+{
+    scene_ = &scene;
+    bvh_.build(scene.get_bounds());
+
+    const BVHBuildStats &stats = bvh_.get_build_stats();
+    log_msg("Scene BVH: %u primitives, %u nodes, %u leaves, depth %u, built in %.3f ms",
+            stats.primitive_count,
+            stats.node_count,
+            stats.leaf_count,
+            stats.max_depth,
+            stats.build_time_ms);
+}
+
+void SceneBVH::refit() { bvh_.refit(scene_->get_bounds()); }
+
+void SceneBVH::intersect_primitive(uint32_t           index,
+                                   const Ray3        &ray,
+                                   RayTraversalState &current_state,
+                                   RayTraversalState &closest) const
+{
+    const CompiledPrimitive &prim = scene_->get_primitives()[index];
+    current_state.material_node = scene_->get_material(prim.material);
+    current_state.texture_node = scene_->get_texture(prim.texture);
+
+    const CompiledTransform *transform = scene_->get_transform(prim.transform);
+    if(transform == nullptr)
+    {
+        float t_prior = closest.t_min;
+        prim.geometry->find_closest_intersect(ray, current_state, closest);
+        if(closest.t_min < t_prior) { closest.instance_index = index; }
+        return;
+    }
+
+    // Intersect in object space, then convert the distance back to world space
+    float t_scale;
+    Ray3  local = to_object_space(ray, *transform, t_scale);
+    float t_world = closest.t_min;
+    float t_local = t_world * t_scale;
+    closest.t_min = t_local;
+    prim.geometry->find_closest_intersect(local, current_state, closest);
+    if(closest.t_min < t_local)
+    {
+        closest.t_min /= t_scale;
+        closest.instance_index = index;
+        closest.transform_required = true;
+        closest.inverse_matrix = transform->inverse_matrix;
+        closest.normal_matrix = transform->normal_matrix;
+    }
+    else closest.t_min = t_world;
+}
+
+void SceneBVH::find_closest_intersect(const Ray3        &ray,
+                                      RayTraversalState &current_state,
+                                      RayTraversalState &closest) const
+{
+    float t_max = closest.t_min;
+    bvh_.find_closest(ray, t_max, [&](uint32_t first, uint32_t count, float &t) {
+        for(uint32_t i = first; i < first + count; ++i)
+        {
+            intersect_primitive(bvh_.get_primitive_index(i), ray, current_state, closest);
+        }
+        t = closest.t_min;
+    });
+}
+
+void SceneBVH::find_closest_intersect(const RayPacket   &packet,
+                                      RayTraversalState &current_state,
+                                      PacketHit         &closest) const
+{
+    const std::vector<CompiledPrimitive> &primitives = scene_->get_primitives();
+    SimdFloat                             t_max = closest.get_t_min();
+    RayTraversalState                     lane_closest;
+    bvh_.find_closest(packet, t_max, [&](uint32_t first, uint32_t count, const SimdMask &mask, SimdFloat &t) {
+        for(uint32_t i = first; i < first + count; ++i)
+        {
+            uint32_t                 index = bvh_.get_primitive_index(i);
+            const CompiledPrimitive &prim = primitives[index];
+            if(prim.transform == COMPILED_NO_INDEX)
+            {
+                current_state.material_node = scene_->get_material(prim.material);
+                current_state.texture_node = scene_->get_texture(prim.texture);
+                current_state.instance_index = index;
+                prim.geometry->find_closest_intersect_packet(packet, mask, current_state, closest);
+                continue;
+            }
+
+            // Each ray sees a different object space direction scale, so
+            // transformed primitives are intersected one lane at a time
+            uint32_t lanes = mask.bits();
+            for(uint32_t lane = 0; lane < packet.count; ++lane)
+            {
+                if((lanes & (1u << lane)) == 0) continue;
+
+                lane_closest.t_min = closest.t_min[lane];
+                lane_closest.geometry_node = nullptr;
+                intersect_primitive(index, packet.get_ray(lane), current_state, lane_closest);
+                if(lane_closest.geometry_node != nullptr)
+                {
+                    const CompiledTransform *transform = scene_->get_transform(prim.transform);
+                    closest.record(lane, lane_closest);
+                    closest.inverse_matrix[lane] = &transform->inverse_matrix;
+                    closest.normal_matrix[lane] = &transform->normal_matrix;
+                }
+            }
+        }
+        t = closest.get_t_min();
+    });
+}
+
+bool SceneBVH::does_intersect_exist(const Ray3        &ray,
+                                    float              d,
+                                    RayTraversalState &current_state,
+                                    uint32_t          *occluder) const
+{
+    SceneNode *start_node = current_state.geometry_node;
+    bool       hit = bvh_.any_hit(ray, d, [&](uint32_t first, uint32_t count) {
+        for(uint32_t i = first; i < first + count; ++i)
+        {
+            uint32_t index = bvh_.get_primitive_index(i);
+            if(occludes(index, ray, d, start_node, current_state))
+            {
+                if(occluder != nullptr) { *occluder = index; }
+                return true;
+            }
+        }
+        return false;
+    });
+    current_state.geometry_node = start_node;
+    return hit;
+}
+
+bool SceneBVH::does_primitive_intersect(uint32_t           primitive,
+                                        const Ray3        &ray,
+                                        float              d,
+                                        RayTraversalState &current_state) const
+{
+    if(scene_ == nullptr || primitive >= scene_->get_primitives().size()) { return false; }
+
+    SceneNode *start_node = current_state.geometry_node;
+    bool       hit = occludes(primitive, ray, d, start_node, current_state);
+    current_state.geometry_node = start_node;
+    return hit;
+}
+
+bool SceneBVH::occludes(uint32_t           index,
+                        const Ray3        &ray,
+                        float              d,
+                        SceneNode         *start_node,
+                        RayTraversalState &current_state) const
+{
+    // Geometry nodes skip the object the ray starts from. When that object
+    // is instanced, only the instance that was hit may be skipped.
+    const CompiledPrimitive &prim = scene_->get_primitives()[index];
+    bool other_instance = current_state.instance_index != NO_INSTANCE_INDEX && index != current_state.instance_index;
+    current_state.geometry_node = other_instance ? nullptr : start_node;
+
+    const CompiledTransform *transform = scene_->get_transform(prim.transform);
+    if(transform == nullptr) { return prim.geometry->does_intersect_exist(ray, d, current_state); }
+
+    float t_scale;
+    Ray3  local = to_object_space(ray, *transform, t_scale);
+    return prim.geometry->does_intersect_exist(local, d * t_scale, current_state);
+}
+
+} // namespace cg
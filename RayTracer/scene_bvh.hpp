@@ -0,0 +1,125 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    scene_bvh.hpp
+//	Purpose: Top level acceleration structure for ray tracing. Builds a BVH
+//           over the primitives (instances) of the compiled scene. Meshes
+//           keep their own object space BVH as the bottom level, shared by
+//           all instances of the mesh.
+//============================================================================
+
+#ifndef __RAY_TRACER_SCENE_BVH_HPP__
+#define __RAY_TRACER_SCENE_BVH_HPP__
+
+#include "RayTracer/compiled_scene.hpp"
+#include "geometry/bvh.hpp"
+#include "scene/geometry_node.hpp"
+
+namespace cg
+{
+
+/**
+ * Scene-wide BVH. Replaces the recursive scene graph traversal for closest
+ * hit and any hit (shadow) queries.
+ */
+class SceneBVH
+{
+  public:
+    /**
+     * Constructor.
+     */
+    SceneBVH();
+
+    /**
+     * Builds the BVH over the primitives of a compiled scene. Primitives with
+     * a transform are intersected in object space.
+     * @param  scene  Compiled scene. Must outlive the BVH (or the next build).
+     */
+    void build(const CompiledScene &scene);
+
+    /**
+     * Refit the BVH to the current bounds of the compiled scene after its
+     * transforms are updated. Faster than a build when instances move, as
+     * neither the top level structure nor any mesh BVH is rebuilt.
+     */
+    void refit();
+
+    /**
+     * Find the closest intersection along the ray.
+     * @param  ray            Ray to trace.
+     * @param  current_state  Scratch state passed to the geometry nodes.
+     * @param  closest        (IN/OUT) Closest intersection information. t_min
+     *                        must be initialized to the maximum distance.
+     */
+    void find_closest_intersect(const Ray3 &ray, RayTraversalState &current_state, RayTraversalState &closest) const;
+
+    /**
+     * Find the closest intersection of each ray in a packet.
+     * @param  packet         Rays to trace.
+     * @param  current_state  Scratch state passed to the geometry nodes.
+     * @param  closest        (IN/OUT) Closest intersection of each lane.
+     *                        Lanes that hit a transformed primitive are
+     *                        intersected one ray at a time.
+     */
+    void find_closest_intersect(const RayPacket &packet, RayTraversalState &current_state, PacketHit &closest) const;
+
+    /**
+     * Test whether any object intersects the ray closer than distance d.
+     * @param  ray            Ray to test (shadow ray).
+     * @param  d              Maximum distance.
+     * @param  current_state  State passed to geometry nodes (geometry_node and
+     *                        instance_index hold the object the ray starts from).
+     * @param  occluder       (OUT) Optional. Primitive that blocks the ray, if
+     *                        one does.
+     * @return Returns true if an intersection closer than d exists.
+     */
+    bool does_intersect_exist(const Ray3        &ray,
+                              float              d,
+                              RayTraversalState &current_state,
+                              uint32_t          *occluder = nullptr) const;
+
+    /**
+     * Test whether one primitive intersects the ray closer than distance d,
+     * with the same rules as does_intersect_exist.
+     * @param  primitive      Index of the primitive in the compiled scene.
+     *                        Indices out of range never intersect.
+     * @param  ray            Ray to test (shadow ray).
+     * @param  d              Maximum distance.
+     * @param  current_state  State passed to geometry nodes (geometry_node and
+     *                        instance_index hold the object the ray starts from).
+     * @return Returns true if the primitive intersects the ray closer than d.
+     */
+    bool does_primitive_intersect(uint32_t           primitive,
+                                  const Ray3        &ray,
+                                  float              d,
+                                  RayTraversalState &current_state) const;
+
+    /**
+     * Get the underlying hierarchy.
+     */
+    const BVH &get_bvh() const { return bvh_; }
+
+  private:
+    const CompiledScene *scene_;
+    BVH                  bvh_;
+
+    // Closest hit with one primitive, transforming the ray to object space if
+    // needed. Records the primitive index as the instance hit.
+    void intersect_primitive(uint32_t           index,
+                             const Ray3        &ray,
+                             RayTraversalState &current_state,
+                             RayTraversalState &closest) const;
+
+    // Any hit with one primitive. start_node is the object the ray starts
+    // from; current_state.instance_index is the instance of it that was hit.
+    bool occludes(uint32_t           index,
+                  const Ray3        &ray,
+                  float              d,
+                  SceneNode         *start_node,
+                  RayTraversalState &current_state) const;
+};
+
+} // namespace cg
+
+#endif
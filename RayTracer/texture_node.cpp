@@ -1,6 +1,6 @@
 #include "RayTracer/texture_node.hpp"
 
-#include "scene/image_data.hpp"
+#include "scene/texture_cache.hpp"
 
 #include <iostream>
 
@@ -16,9 +16,8 @@ TextureNode::TextureNode(
     texture_id_ = 0;
     node_type_ = SceneNodeType::PRESENTATION;
 
-    ImageData im_data;
-    load_image_data(im_data, filename);
-    if(im_data.data == nullptr)
+    image_ = acquire_image(filename);
+    if(!image_)
     {
         std::cout << "Error loading texture " << filename << '\n';
         return;
@@ -31,7 +30,7 @@ void TextureNode::draw(SceneState &scene_state)
     SceneNode::draw(scene_state);
 }
 
-void TextureNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+void TextureNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     // Push texture onto stack within the current state
     current_state.push_texture();
@@ -48,4 +47,6 @@ void TextureNode::find_closest_intersect(Ray3 ray, SceneState &current_state, Sc
 
 Color3 TextureNode::get_color(const TextureCoord2 &tex_coord) { return Color3(0.0f, 0.0f, 0.0f); }
 
+Color3 TextureNode::get_color(const TextureCoord2 &tex_coord, float footprint) { return get_color(tex_coord); }
+
 } // namespace cg
@@ -15,6 +15,9 @@
 
 #include "scene/color3.hpp"
 #include "scene/scene_node.hpp"
+#include "scene/texture_cache.hpp"
+
+#include <memory>
 
 namespace cg
 {
@@ -43,12 +46,12 @@ class TextureNode : public SceneNode
 
     /**
      * Ray tracing intersect method. Finds the closest intersection (sets
-     * properties in SceneState.
+     * properties in RayTraversalState.
      * @param ray  Ray being traced.
-     * @param current_state Current scene state information.
-     * @param closest Scene state carrying information about closest intersection.
+     * @param current_state Current traversal state information.
+     * @param closest Traversal state carrying information about closest intersection.
      */
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
 
     // All procedural textures must contain the GetColor method
     virtual Color3 get_color(const Point3 &v) = 0;
@@ -56,10 +59,21 @@ class TextureNode : public SceneNode
     // Get a color given a texture coordinate
     virtual Color3 get_color(const TextureCoord2 &tex_coord);
 
+    /**
+     * Get the color filtered over a footprint around a texture coordinate.
+     * The default ignores the footprint.
+     * @param  tex_coord  Texture coordinate (s,t)
+     * @param  footprint  Width of the area seen, in texture coordinate units.
+     * @return Returns the filtered color.
+     */
+    virtual Color3 get_color(const TextureCoord2 &tex_coord, float footprint);
+
   protected:
     bool   updated_;    // Has this texture been updated?
     GLuint texture_id_; // Texture ID
 
+    std::shared_ptr<const CachedImage> image_; // Decoded image, shared with other users of the file
+
     // Force direct users of TextureNode to use public constructor
     TextureNode();
 };
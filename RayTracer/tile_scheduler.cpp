@@ -0,0 +1,221 @@
+#include "RayTracer/tile_scheduler.hpp"
+
+#include "common/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace cg
+{
+
+TileScheduler::TileScheduler(uint32_t num_workers, uint32_t tile_size)
+    : tile_size_(std::max(tile_size, 1u)), pass_ms_(0.0), generation_(0),
+      active_workers_(0), stop_(false)
+{
+    if(num_workers == 0)
+    {
+        uint32_t hw = std::thread::hardware_concurrency();
+        num_workers = hw > 1 ? hw - 1 : 1;
+    }
+
+    stats_.resize(num_workers);
+    for(uint32_t i = 0; i < num_workers; ++i) { queues_.push_back(std::make_unique<WorkerQueue>()); }
+    for(uint32_t i = 0; i < num_workers; ++i) { workers_.emplace_back(&TileScheduler::worker_main, this, i); }
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for(auto &worker : workers_) { worker.join(); }
+}
+
+void TileScheduler::set_tile_size(uint32_t tile_size) { tile_size_ = std::max(tile_size, 1u); }
+
+void TileScheduler::run(int32_t width, int32_t height, const std::function<void(const Tile &)> &func)
+{
+    start(width, height, func);
+    wait();
+}
+
+void TileScheduler::start(int32_t width, int32_t height, const std::function<void(const Tile &)> &func)
+{
+    wait();
+    pass_start_ = std::chrono::steady_clock::now();
+
+    // Split the image into tiles in scanline order
+    std::vector<Tile> tiles;
+    int32_t           ts = static_cast<int32_t>(tile_size_);
+    for(int32_t y = 0; y < height; y += ts)
+    {
+        for(int32_t x = 0; x < width; x += ts)
+        {
+            tiles.push_back({x, y, std::min(x + ts, width), std::min(y + ts, height)});
+        }
+    }
+    if(tiles.empty()) return;
+
+    // Give each worker a contiguous run of tiles so neighbouring tiles (which
+    // tend to touch the same geometry) stay on one thread unless stolen
+    size_t num_workers = workers_.size();
+    for(size_t w = 0; w < num_workers; ++w)
+    {
+        size_t first = w * tiles.size() / num_workers;
+        size_t last = (w + 1) * tiles.size() / num_workers;
+        std::lock_guard<std::mutex> lock(queues_[w]->mutex);
+        queues_[w]->tiles.assign(tiles.begin() + first, tiles.begin() + last);
+    }
+
+    // Wake the workers. The function is not replaced until all of them run
+    // out of tiles.
+    std::lock_guard<std::mutex> lock(mutex_);
+    func_ = func;
+    active_workers_ = static_cast<uint32_t>(num_workers);
+    ++generation_;
+    start_cv_.notify_all();
+}
+
+bool TileScheduler::wait(double timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(active_workers_ == 0 && !func_) { return true; }
+
+    auto done = [this] { return active_workers_ == 0; };
+    if(timeout_ms < 0.0) { done_cv_.wait(lock, done); }
+    else if(!done_cv_.wait_for(lock, std::chrono::duration<double, std::milli>(timeout_ms), done))
+    {
+        return false;
+    }
+
+    // First wait to see the pass finish records its time. The end was taken
+    // by the last worker so a late wait does not lengthen the pass.
+    func_ = nullptr;
+    pass_ms_ += std::chrono::duration<double, std::milli>(pass_end_ - pass_start_).count();
+    return true;
+}
+
+void TileScheduler::cancel()
+{
+    for(auto &queue : queues_)
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tiles.clear();
+    }
+}
+
+std::vector<WorkerStats> TileScheduler::get_stats() const { return stats_; }
+
+void TileScheduler::reset_stats()
+{
+    std::fill(stats_.begin(), stats_.end(), WorkerStats());
+    pass_ms_ = 0.0;
+}
+
+void TileScheduler::log_stats(const char *label) const
+{
+    uint32_t total_tiles = 0;
+    uint32_t total_steals = 0;
+    double   total_busy = 0.0;
+    for(const WorkerStats &s : stats_)
+    {
+        total_tiles += s.tiles;
+        total_steals += s.steals;
+        total_busy += s.busy_ms;
+    }
+
+    double capacity = pass_ms_ * static_cast<double>(stats_.size());
+    log_msg("%s: %.3f ms, %u workers, tile size %u, %u tiles (%u stolen), %.1f%% utilisation",
+            label,
+            pass_ms_,
+            static_cast<uint32_t>(stats_.size()),
+            tile_size_,
+            total_tiles,
+            total_steals,
+            capacity > 0.0 ? 100.0 * total_busy / capacity : 0.0);
+    for(size_t i = 0; i < stats_.size(); ++i)
+    {
+        const WorkerStats &s = stats_[i];
+        log_msg("  Worker %u: %u tiles (%u stolen), %.3f ms busy, %.1f%% utilisation",
+                static_cast<uint32_t>(i),
+                s.tiles,
+                s.steals,
+                s.busy_ms,
+                pass_ms_ > 0.0 ? 100.0 * s.busy_ms / pass_ms_ : 0.0);
+    }
+}
+
+void TileScheduler::worker_main(uint32_t index)
+{
+    uint64_t seen_generation = 0;
+    while(true)
+    {
+        const std::function<void(const Tile &)> *func;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+            if(stop_) return;
+            seen_generation = generation_;
+            func = &func_;
+        }
+
+        // Render tiles until neither this worker nor any other has one left
+        WorkerStats &stats = stats_[index];
+        Tile         tile;
+        bool         stolen;
+        while(take_tile(index, tile, stolen))
+        {
+            auto start = std::chrono::steady_clock::now();
+            (*func)(tile);
+            stats.busy_ms +=
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ++stats.tiles;
+            if(stolen) ++stats.steals;
+        }
+
+        // No tiles are added during a pass, so once every worker has found
+        // all queues empty the pass is complete
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(--active_workers_ == 0)
+        {
+            pass_end_ = std::chrono::steady_clock::now();
+            done_cv_.notify_one();
+        }
+    }
+}
+
+bool TileScheduler::take_tile(uint32_t index, Tile &tile, bool &stolen)
+{
+    // Own deque first
+    {
+        WorkerQueue                &queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tiles.empty())
+        {
+            tile = queue.tiles.front();
+            queue.tiles.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    // Steal from the back of the other deques, starting with the next worker
+    size_t num_workers = queues_.size();
+    for(size_t i = 1; i < num_workers; ++i)
+    {
+        WorkerQueue                &victim = *queues_[(index + i) % num_workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tiles.empty())
+        {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace cg
@@ -0,0 +1,174 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    tile_scheduler.hpp
+//	Purpose: Persistent pool of render worker threads. Each pass the image is
+//           split into tiles which workers take from their own deque and
+//           steal from the deques of other workers once theirs is empty.
+//============================================================================
+
+#ifndef __RAY_TRACER_TILE_SCHEDULER_HPP__
+#define __RAY_TRACER_TILE_SCHEDULER_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cg
+{
+
+// Default tile width and height in pixels
+constexpr uint32_t DEFAULT_TILE_SIZE = 32;
+
+/**
+ * Rectangular region of the image: pixels [x0, x1) x [y0, y1).
+ */
+struct Tile
+{
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+};
+
+/**
+ * Work done by one render worker since the statistics were last reset.
+ */
+struct WorkerStats
+{
+    uint32_t tiles = 0;       // Tiles rendered
+    uint32_t steals = 0;      // Tiles taken from another worker's deque
+    double   busy_ms = 0.0;   // Time spent rendering tiles
+};
+
+/**
+ * Work-stealing tile scheduler. Worker threads are created once and reused
+ * for every pass and frame.
+ */
+class TileScheduler
+{
+  public:
+    /**
+     * Constructor. Starts the worker threads.
+     * @param  num_workers  Number of worker threads (0 uses all hardware threads but one).
+     * @param  tile_size    Tile width and height in pixels.
+     */
+    explicit TileScheduler(uint32_t num_workers = 0, uint32_t tile_size = DEFAULT_TILE_SIZE);
+
+    /**
+     * Destructor. Stops and joins the worker threads.
+     */
+    ~TileScheduler();
+
+    TileScheduler(const TileScheduler &) = delete;
+    TileScheduler &operator=(const TileScheduler &) = delete;
+
+    /**
+     * Set the tile size used by subsequent passes.
+     * @param  tile_size  Tile width and height in pixels (at least 1).
+     */
+    void set_tile_size(uint32_t tile_size);
+
+    /**
+     * Get the tile size.
+     */
+    uint32_t get_tile_size() const { return tile_size_; }
+
+    /**
+     * Get the number of worker threads.
+     */
+    uint32_t get_worker_count() const { return static_cast<uint32_t>(workers_.size()); }
+
+    /**
+     * Render one pass. Splits the image into tiles, hands contiguous runs of
+     * tiles to each worker and blocks until every tile has been rendered.
+     * @param  width   Image width in pixels.
+     * @param  height  Image height in pixels.
+     * @param  func    Function called (on a worker thread) for each tile.
+     */
+    void run(int32_t width, int32_t height, const std::function<void(const Tile &)> &func);
+
+    /**
+     * Start a pass without waiting for it (see run). Waits for any pass
+     * still in flight first.
+     * @param  width   Image width in pixels.
+     * @param  height  Image height in pixels.
+     * @param  func    Function called (on a worker thread) for each tile.
+     *                 Copied, so it need not outlive the call.
+     */
+    void start(int32_t width, int32_t height, const std::function<void(const Tile &)> &func);
+
+    /**
+     * Wait for the pass in flight to finish.
+     * @param  timeout_ms  Longest time to wait in milliseconds (negative
+     *                     waits until the pass finishes).
+     * @return Returns true if no pass is in flight.
+     */
+    bool wait(double timeout_ms = -1.0);
+
+    /**
+     * Cancel the pass in flight. Tiles not yet taken by a worker are dropped;
+     * tiles being rendered are finished. Call wait() before touching anything
+     * the workers use.
+     */
+    void cancel();
+
+    /**
+     * Get the per worker statistics accumulated since the last reset.
+     */
+    std::vector<WorkerStats> get_stats() const;
+
+    /**
+     * Reset the worker statistics and the accumulated pass time. Call at the
+     * start of each frame.
+     */
+    void reset_stats();
+
+    /**
+     * Log the tiles, steals and utilisation (busy time / pass time) of each
+     * worker since the last reset.
+     * @param  label  Label for the log entry (e.g. "Frame 3").
+     */
+    void log_stats(const char *label) const;
+
+  private:
+    // Tiles queued for one worker. The owner takes from the front, thieves
+    // take from the back.
+    struct WorkerQueue
+    {
+        std::mutex       mutex;
+        std::deque<Tile> tiles;
+    };
+
+    uint32_t                                   tile_size_;
+    std::vector<std::thread>                   workers_;
+    std::vector<std::unique_ptr<WorkerQueue>>  queues_;
+    std::vector<WorkerStats>                   stats_;
+    double                                     pass_ms_;
+    std::chrono::steady_clock::time_point      pass_start_;
+
+    // Pass dispatch. Guarded by mutex_.
+    std::mutex                                 mutex_;
+    std::condition_variable                    start_cv_;
+    std::condition_variable                    done_cv_;
+    std::function<void(const Tile &)>          func_;
+    uint64_t                                   generation_;
+    uint32_t                                   active_workers_;
+    bool                                       stop_;
+    std::chrono::steady_clock::time_point      pass_end_; // When the last worker finished
+
+    void worker_main(uint32_t index);
+
+    bool take_tile(uint32_t index, Tile &tile, bool &stolen);
+};
+
+} // namespace cg
+
+#endif
@@ -0,0 +1,303 @@
+#include "RayTracerBench/bench_scenes.hpp"
+
+#include "RayTracer/demo_scene.hpp"
+#include "RayTracer/image_texture.hpp"
+#include "RayTracer/material_node.hpp"
+#include "RayTracer/rt_mesh_node.hpp"
+#include "RayTracer/rt_quad_node.hpp"
+#include "RayTracer/rt_sphere_node.hpp"
+#include "geometry/geometry.hpp"
+
+#include <cmath>
+
+namespace cg
+{
+
+namespace
+{
+
+// Creates a material with the given diffuse color
+std::shared_ptr<MaterialNode> make_material(const Color4 &color, float shininess)
+{
+    auto material = std::make_shared<MaterialNode>();
+    material->set_ambient_and_diffuse(color);
+    material->set_specular(Color4(0.4f, 0.4f, 0.4f, 1.0f));
+    material->set_shininess(shininess);
+    return material;
+}
+
+// Adds a positional light to a scene
+void add_light(BenchScene &scene, const HPoint3 &position, const Color4 &color)
+{
+    auto light = std::make_shared<LightNode>(static_cast<uint32_t>(scene.lights.size()));
+    light->set_position(position);
+    light->set_diffuse(color);
+    light->set_specular(color);
+    light->enable();
+    scene.root->add_child(light);
+    scene.lights.push_back(light.get());
+}
+
+// Adds a floor (a very large sphere with its top at y = -1)
+void add_floor(BenchScene &scene)
+{
+    auto floor_material = make_material(Color4(0.4f, 0.4f, 0.5f, 1.0f), 16.0f);
+    floor_material->add_child(std::make_shared<RTSphereNode>(Point3(0.0f, -1001.0f, 0.0f), 1000.0f));
+    scene.root->add_child(floor_material);
+}
+
+BenchScene construct_demo()
+{
+    BenchScene scene;
+    scene.name = "demo";
+    scene.root = construct_demo_scene(scene.lights);
+
+    CameraNode camera;
+    set_demo_camera(camera);
+    scene.eye = camera.get_position();
+    scene.look_at = Point3(0.0f, 0.0f, 0.0f);
+    scene.max_depth = 15;
+    return scene;
+}
+
+// 24 x 24 grid of small spheres in four materials, one of them reflective
+BenchScene construct_sphere_field()
+{
+    BenchScene scene;
+    scene.name = "sphere_field";
+    scene.root = std::make_shared<SceneNode>();
+    add_floor(scene);
+
+    const Color4 colors[4] = {Color4(0.8f, 0.2f, 0.2f, 1.0f),
+                              Color4(0.2f, 0.8f, 0.2f, 1.0f),
+                              Color4(0.2f, 0.2f, 0.8f, 1.0f),
+                              Color4(0.1f, 0.1f, 0.1f, 1.0f)};
+    std::shared_ptr<MaterialNode> materials[4];
+    for(uint32_t m = 0; m < 4; ++m)
+    {
+        materials[m] = make_material(colors[m], 32.0f);
+        scene.root->add_child(materials[m]);
+    }
+    materials[3]->set_global_reflectivity(0.7f, 0.7f, 0.7f);
+
+    const int32_t grid_size = 24;
+    for(int32_t i = 0; i < grid_size; ++i)
+    {
+        for(int32_t j = 0; j < grid_size; ++j)
+        {
+            Point3 center(i - 0.5f * grid_size, -0.65f, j - 0.5f * grid_size);
+            materials[(i + 3 * j) % 4]->add_child(std::make_shared<RTSphereNode>(center, 0.35f));
+        }
+    }
+
+    add_light(scene, HPoint3(6.0f, 10.0f, -8.0f, 1.0f), Color4(0.8f, 0.8f, 0.8f, 1.0f));
+    add_light(scene, HPoint3(-8.0f, 6.0f, 4.0f, 1.0f), Color4(0.4f, 0.4f, 0.5f, 1.0f));
+    scene.eye = Point3(0.0f, 6.0f, -16.0f);
+    scene.look_at = Point3(0.0f, -1.0f, 0.0f);
+    scene.max_depth = 5;
+    return scene;
+}
+
+// Mirrored room holding glass and mirror spheres. Most rays reflect or
+// refract until the depth limit.
+BenchScene construct_reflect_refract()
+{
+    BenchScene scene;
+    scene.name = "reflect_refract";
+    scene.root = std::make_shared<SceneNode>();
+    add_floor(scene);
+
+    auto wall_material = make_material(Color4(0.3f, 0.3f, 0.35f, 1.0f), 64.0f);
+    wall_material->set_global_reflectivity(0.8f, 0.8f, 0.8f);
+    wall_material->add_child(std::make_shared<RTQuadNode>(Point3(6.0f, -1.0f, 6.0f),
+                                                          Point3(-6.0f, -1.0f, 6.0f),
+                                                          Point3(-6.0f, 5.0f, 6.0f),
+                                                          Point3(6.0f, 5.0f, 6.0f)));
+    wall_material->add_child(std::make_shared<RTQuadNode>(Point3(-6.0f, -1.0f, 6.0f),
+                                                          Point3(-6.0f, -1.0f, -6.0f),
+                                                          Point3(-6.0f, 5.0f, -6.0f),
+                                                          Point3(-6.0f, 5.0f, 6.0f)));
+    wall_material->add_child(std::make_shared<RTQuadNode>(Point3(6.0f, -1.0f, -6.0f),
+                                                          Point3(6.0f, -1.0f, 6.0f),
+                                                          Point3(6.0f, 5.0f, 6.0f),
+                                                          Point3(6.0f, 5.0f, -6.0f)));
+    scene.root->add_child(wall_material);
+
+    auto glass_material = make_material(Color4(0.1f, 0.1f, 0.15f, 1.0f), 128.0f);
+    glass_material->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    glass_material->set_global_transmission(0.9f, 0.9f, 0.9f);
+    glass_material->set_global_reflectivity(0.1f, 0.1f, 0.1f);
+    glass_material->set_index_of_refraction(1.5f);
+    scene.root->add_child(glass_material);
+
+    auto mirror_material = make_material(Color4(0.1f, 0.1f, 0.1f, 1.0f), 128.0f);
+    mirror_material->set_specular(Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    mirror_material->set_global_reflectivity(0.9f, 0.9f, 0.9f);
+    scene.root->add_child(mirror_material);
+
+    for(int32_t i = 0; i < 5; ++i)
+    {
+        for(int32_t j = 0; j < 3; ++j)
+        {
+            Point3 center(-4.0f + 2.0f * i, 0.0f, -1.0f + 2.0f * j);
+            auto  &material = ((i + j) % 2 == 0) ? glass_material : mirror_material;
+            material->add_child(std::make_shared<RTSphereNode>(center, 0.8f));
+        }
+    }
+
+    add_light(scene, HPoint3(0.0f, 4.5f, -3.0f, 1.0f), Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    scene.eye = Point3(0.0f, 3.0f, -9.0f);
+    scene.look_at = Point3(0.0f, 0.0f, 1.0f);
+    scene.max_depth = 10;
+    return scene;
+}
+
+// Finely tessellated torus (about 125,000 triangles)
+BenchScene construct_large_mesh()
+{
+    BenchScene scene;
+    scene.name = "large_mesh";
+    scene.root = std::make_shared<SceneNode>();
+    add_floor(scene);
+
+    // Vertex indices are 16 bit so at most 65536 vertices
+    const uint32_t      rings = 250;
+    const uint32_t      sides = 250;
+    const float         major_radius = 2.0f;
+    const float         minor_radius = 0.8f;
+    std::vector<Point3> vertices;
+    for(uint32_t i = 0; i < rings; ++i)
+    {
+        float theta = 2.0f * PI * i / rings;
+        for(uint32_t j = 0; j < sides; ++j)
+        {
+            // Ripples along the tube make the surface less regular
+            float phi = 2.0f * PI * j / sides;
+            float r = minor_radius * (1.0f + 0.05f * std::sin(12.0f * theta) * std::sin(8.0f * phi));
+            float d = major_radius + r * std::cos(phi);
+            vertices.emplace_back(d * std::cos(theta), 0.8f + r * std::sin(phi), d * std::sin(theta));
+        }
+    }
+    std::vector<uint16_t> faces;
+    for(uint32_t i = 0; i < rings; ++i)
+    {
+        for(uint32_t j = 0; j < sides; ++j)
+        {
+            uint16_t v00 = static_cast<uint16_t>(i * sides + j);
+            uint16_t v01 = static_cast<uint16_t>(i * sides + (j + 1) % sides);
+            uint16_t v10 = static_cast<uint16_t>(((i + 1) % rings) * sides + j);
+            uint16_t v11 = static_cast<uint16_t>(((i + 1) % rings) * sides + (j + 1) % sides);
+            faces.insert(faces.end(), {v00, v01, v11, v00, v11, v10});
+        }
+    }
+
+    auto mesh_material = make_material(Color4(0.7f, 0.5f, 0.2f, 1.0f), 32.0f);
+    mesh_material->add_child(std::make_shared<RTMeshNode>(vertices, faces));
+    scene.root->add_child(mesh_material);
+
+    add_light(scene, HPoint3(4.0f, 8.0f, -6.0f, 1.0f), Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    scene.eye = Point3(0.0f, 5.0f, -6.5f);
+    scene.look_at = Point3(0.0f, 0.5f, 0.0f);
+    scene.max_depth = 5;
+    return scene;
+}
+
+// Sphere field lit by a 16 x 16 grid of colored lights with distance
+// attenuation. Each point is reached by a fraction of the lights.
+BenchScene construct_many_lights()
+{
+    BenchScene scene;
+    scene.name = "many_lights";
+    scene.root = std::make_shared<SceneNode>();
+    add_floor(scene);
+
+    auto sphere_material = make_material(Color4(0.7f, 0.7f, 0.7f, 1.0f), 32.0f);
+    scene.root->add_child(sphere_material);
+    const int32_t grid_size = 24;
+    for(int32_t i = 0; i < grid_size; ++i)
+    {
+        for(int32_t j = 0; j < grid_size; ++j)
+        {
+            Point3 center(i - 0.5f * grid_size, -0.65f, j - 0.5f * grid_size);
+            sphere_material->add_child(std::make_shared<RTSphereNode>(center, 0.35f));
+        }
+    }
+
+    const Color4 colors[4] = {Color4(1.0f, 0.3f, 0.3f, 1.0f),
+                              Color4(0.3f, 1.0f, 0.3f, 1.0f),
+                              Color4(0.3f, 0.3f, 1.0f, 1.0f),
+                              Color4(1.0f, 0.9f, 0.6f, 1.0f)};
+    const int32_t light_grid_size = 16;
+    for(int32_t i = 0; i < light_grid_size; ++i)
+    {
+        for(int32_t j = 0; j < light_grid_size; ++j)
+        {
+            HPoint3 position(1.5f * (i - 0.5f * light_grid_size) + 0.25f,
+                             0.5f,
+                             1.5f * (j - 0.5f * light_grid_size) + 0.25f,
+                             1.0f);
+            add_light(scene, position, colors[(i + 2 * j) % 4]);
+            scene.lights.back()->set_attenuation(1.0f, 0.0f, 16.0f);
+        }
+    }
+    scene.eye = Point3(0.0f, 6.0f, -16.0f);
+    scene.look_at = Point3(0.0f, -1.0f, 0.0f);
+    scene.max_depth = 5;
+    return scene;
+}
+
+// Floor of 32 x 32 textured tiles seen at a grazing angle and a textured
+// globe. Distant tiles are minified, so lookups read coarse mip levels.
+BenchScene construct_textured()
+{
+    BenchScene scene;
+    scene.name = "textured";
+    scene.root = std::make_shared<SceneNode>();
+
+    auto          floor_material = make_material(Color4(1.0f, 1.0f, 1.0f, 1.0f), 16.0f);
+    auto          floor_texture = std::make_shared<ImageTexture>("floor_tiles.jpg");
+    const int32_t tiles = 32;
+    const float   tile_size = 2.5f;
+    for(int32_t i = 0; i < tiles; ++i)
+    {
+        for(int32_t j = 0; j < tiles; ++j)
+        {
+            float x = tile_size * (i - 0.5f * tiles);
+            float z = tile_size * (j - 4);
+            floor_texture->add_child(std::make_shared<RTQuadNode>(Point3(x, -1.0f, z),
+                                                                  Point3(x, -1.0f, z + tile_size),
+                                                                  Point3(x + tile_size, -1.0f, z + tile_size),
+                                                                  Point3(x + tile_size, -1.0f, z)));
+        }
+    }
+    floor_material->add_child(floor_texture);
+    scene.root->add_child(floor_material);
+
+    auto globe_material = make_material(Color4(1.0f, 1.0f, 1.0f, 1.0f), 32.0f);
+    auto globe_texture = std::make_shared<ImageTexture>("earthp2.jpg");
+    globe_texture->add_child(std::make_shared<RTSphereNode>(Point3(0.0f, 1.0f, 6.0f), 2.0f));
+    globe_material->add_child(globe_texture);
+    scene.root->add_child(globe_material);
+
+    add_light(scene, HPoint3(6.0f, 12.0f, -6.0f, 1.0f), Color4(1.0f, 1.0f, 1.0f, 1.0f));
+    scene.eye = Point3(0.0f, 1.5f, -8.0f);
+    scene.look_at = Point3(0.0f, 0.0f, 10.0f);
+    scene.max_depth = 5;
+    return scene;
+}
+
+} // namespace
+
+std::vector<BenchScene> construct_bench_scenes()
+{
+    std::vector<BenchScene> scenes;
+    scenes.push_back(construct_demo());
+    scenes.push_back(construct_sphere_field());
+    scenes.push_back(construct_reflect_refract());
+    scenes.push_back(construct_large_mesh());
+    scenes.push_back(construct_many_lights());
+    scenes.push_back(construct_textured());
+    return scenes;
+}
+
+} // namespace cg
@@ -0,0 +1,45 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    bench_scenes.hpp
+//	Purpose: Fixed scenes rendered by the ray tracing benchmark. Scenes are
+//           built procedurally so every run traces exactly the same rays.
+//============================================================================
+
+#ifndef __RAY_TRACER_BENCH_BENCH_SCENES_HPP__
+#define __RAY_TRACER_BENCH_BENCH_SCENES_HPP__
+
+#include "scene/scene.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cg
+{
+
+/**
+ * A benchmark scene and the view it is rendered from.
+ */
+struct BenchScene
+{
+    std::string                name;
+    std::shared_ptr<SceneNode> root;
+    std::vector<LightNode *>   lights;
+    Point3                     eye;       // Camera position
+    Point3                     look_at;   // Point the camera looks at
+    int32_t                    max_depth; // Maximum recursion depth
+};
+
+/**
+ * Construct all benchmark scenes: the RayTracer demo scene, a field of
+ * spheres, a reflective/refractive scene, a large mesh, a scene lit by many
+ * attenuated lights and an image textured scene.
+ * @return Returns the scenes in the order they are reported.
+ */
+std::vector<BenchScene> construct_bench_scenes();
+
+} // namespace cg
+
+#endif
@@ -0,0 +1,499 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    RayTracerBench/main.cpp
+//	Purpose: Headless ray tracing benchmark. Renders fixed scenes at a fixed
+//           resolution with a range of thread counts and reports wall time,
+//           rays per second and scaling efficiency as JSON. Also checks
+//           that refitting a moved instance matches recompiling the scene.
+//============================================================================
+
+#include "common/logging.hpp"
+#include "filesystem_support/file_locator.hpp"
+#include "geometry/geometry.hpp"
+#include "scene/scene.hpp"
+
+#include "RayTracer/ray_tracer.hpp"
+#include "RayTracer/tile_scheduler.hpp"
+#include "RayTracerBench/bench_scenes.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark settings (set from the command line)
+int32_t               g_image_width = 640;
+int32_t               g_image_height = 480;
+uint32_t              g_repeat = 3;
+std::vector<uint32_t> g_thread_counts;
+std::string           g_scene_filter;
+std::string           g_output_file;
+bool                  g_wavefront = false;
+bool                  g_russian_roulette = false;
+uint32_t              g_light_samples = 0;
+bool                  g_occluder_cache = true;
+
+// Constants. Set up the view plane a distance of 1.0 from the camera.
+// Set a field of view angle of 60 degrees.
+const float NEAR_PLANE_DISTANCE = 1.0f;
+const float FAR_PLANE_DISTANCE = 300.0f;
+const float FIELD_OF_VIEW = 60.0f;
+const float DEPTH_THRESHOLD = 0.025f;
+
+// Tile size used by the render workers (as in RayTracer)
+const uint32_t TILE_SIZE = 32;
+
+/**
+ * Result of rendering one scene with one thread count.
+ */
+struct RunResult
+{
+    uint32_t          threads = 0;
+    double            wall_ms = 0.0; // Fastest of the repeated renders
+    cg::RenderMetrics metrics;
+    uint64_t          checksum = 0;  // Hash of the 8 bit image
+};
+
+/**
+ * Render a scene once. Rays are traced as packets along each row of a tile
+ * exactly as in RayTracer, or as one wavefront per tile.
+ * @param  ray_tracer  Ray tracer for the scene.
+ * @param  camera      Camera the scene is viewed from.
+ * @param  max_depth   Maximum recursion depth.
+ * @param  scheduler   Render workers.
+ * @param  metrics     (OUT) Rays traced and intersection tests.
+ * @param  checksum    (OUT) Hash of the image.
+ * @return Returns the wall time in milliseconds.
+ */
+double render(cg::RayTracer        &ray_tracer,
+              const cg::CameraNode &camera,
+              int32_t               max_depth,
+              cg::TileScheduler    &scheduler,
+              cg::RenderMetrics    &metrics,
+              uint64_t             &checksum)
+{
+    std::vector<uint8_t> image(g_image_width * g_image_height * 3);
+    std::mutex           counts_mutex;
+    metrics = cg::RenderMetrics();
+
+    auto start = std::chrono::steady_clock::now();
+    scheduler.run(g_image_width, g_image_height, [&](const cg::Tile &tile) {
+        cg::Ray3   ray_list[cg::SIMD_WIDTH];
+        cg::Color3 colors[cg::SIMD_WIDTH];
+        if(g_wavefront)
+        {
+            uint32_t                tile_width = static_cast<uint32_t>(tile.x1 - tile.x0);
+            uint32_t                count = tile_width * (tile.y1 - tile.y0);
+            std::vector<cg::Ray3>   tile_rays;
+            std::vector<cg::Color3> tile_colors(count);
+            tile_rays.reserve(count);
+            for(int32_t y = tile.y0; y < tile.y1; ++y)
+            {
+                for(int32_t x = tile.x0; x < tile.x1; ++x)
+                {
+                    tile_rays.push_back(camera.construct_ray(static_cast<float>(x), static_cast<float>(y)));
+                }
+            }
+            ray_tracer.trace_wavefront(tile_rays.data(), count, max_depth, DEPTH_THRESHOLD, tile_colors.data());
+            for(uint32_t i = 0; i < count; ++i)
+            {
+                int32_t  x = tile.x0 + static_cast<int32_t>(i % tile_width);
+                int32_t  y = tile.y0 + static_cast<int32_t>(i / tile_width);
+                uint8_t *p = &image[((y * g_image_width) + x) * 3];
+                p[0] = tile_colors[i].r_byte();
+                p[1] = tile_colors[i].g_byte();
+                p[2] = tile_colors[i].b_byte();
+            }
+        }
+        for(int32_t y = tile.y0; !g_wavefront && y < tile.y1; ++y)
+        {
+            for(int32_t x0 = tile.x0; x0 < tile.x1; x0 += cg::SIMD_WIDTH)
+            {
+                uint32_t count = std::min<uint32_t>(cg::SIMD_WIDTH, tile.x1 - x0);
+                for(uint32_t i = 0; i < count; ++i)
+                {
+                    ray_list[i] = camera.construct_ray(static_cast<float>(x0 + i), static_cast<float>(y));
+                }
+                cg::RayPacket packet(ray_list, count);
+                ray_tracer.trace_packet(packet, max_depth, DEPTH_THRESHOLD, colors);
+                for(uint32_t i = 0; i < count; ++i)
+                {
+                    uint8_t *p = &image[((y * g_image_width) + x0 + i) * 3];
+                    p[0] = colors[i].r_byte();
+                    p[1] = colors[i].g_byte();
+                    p[2] = colors[i].b_byte();
+                }
+            }
+        }
+
+        // Counts are per thread; gather them once per tile
+        cg::RenderMetrics           tile_metrics = cg::RayTracer::take_thread_metrics();
+        std::lock_guard<std::mutex> lock(counts_mutex);
+        metrics += tile_metrics;
+    });
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    // FNV-1a hash of the image. Equal across thread counts and runs unless
+    // the rendered image changes.
+    checksum = 14695981039346656037ull;
+    for(uint8_t b : image)
+    {
+        checksum ^= b;
+        checksum *= 1099511628211ull;
+    }
+    return elapsed.count();
+}
+
+/**
+ * Set up the camera a scene is viewed from.
+ */
+void set_up_camera(const cg::BenchScene &scene, cg::CameraNode &camera)
+{
+    camera.set_position_and_look_at_pt(scene.eye, scene.look_at);
+    camera.set_view_up(cg::Vector3(0.0f, 1.0f, 0.0f));
+    camera.set_view_volume(
+        g_image_width, g_image_height, FIELD_OF_VIEW, NEAR_PLANE_DISTANCE, FAR_PLANE_DISTANCE);
+}
+
+/**
+ * Add the scene lights and the benchmark settings to a ray tracer.
+ */
+void set_up_ray_tracer(const cg::BenchScene &scene, const cg::CameraNode &camera, cg::RayTracer &ray_tracer)
+{
+    for(cg::LightNode *light : scene.lights) { ray_tracer.add_light(light); }
+    ray_tracer.set_russian_roulette(g_russian_roulette);
+    ray_tracer.set_light_samples(g_light_samples);
+    ray_tracer.set_occluder_cache(g_occluder_cache);
+    ray_tracer.set_pixel_spread(camera.get_pixel_spread());
+    ray_tracer.set_view_position(camera.get_position());
+}
+
+/**
+ * Find the first transform node in a scene graph (depth first).
+ * @return Returns nullptr if the scene has no transforms.
+ */
+cg::TransformNode *find_transform(cg::SceneNode *node)
+{
+    if(node->node_type() == cg::SceneNodeType::TRANSFORM) { return static_cast<cg::TransformNode *>(node); }
+    for(auto &child : node->get_children())
+    {
+        cg::TransformNode *transform = find_transform(child.get());
+        if(transform != nullptr) { return transform; }
+    }
+    return nullptr;
+}
+
+/**
+ * Check that moving an instance and refitting renders the same image as
+ * compiling the moved scene from scratch. The instance is moved back
+ * afterwards. Scenes without transforms are skipped.
+ * @return Returns false if the images differ.
+ */
+bool check_refit(cg::BenchScene &scene)
+{
+    cg::TransformNode *transform = find_transform(scene.root.get());
+    if(transform == nullptr) { return true; }
+
+    cg::CameraNode camera;
+    set_up_camera(scene, camera);
+    cg::TileScheduler scheduler(g_thread_counts.back(), TILE_SIZE);
+    cg::RenderMetrics metrics;
+
+    // Refit the scene after moving the instance
+    cg::RayTracer refit_tracer(scene.root);
+    set_up_ray_tracer(scene, camera, refit_tracer);
+    transform->translate(0.5f, 0.25f, -0.5f);
+    refit_tracer.update_scene();
+    uint64_t refit_checksum;
+    render(refit_tracer, camera, scene.max_depth, scheduler, metrics, refit_checksum);
+
+    // Compile the moved scene from scratch
+    cg::RayTracer compiled_tracer(scene.root);
+    set_up_ray_tracer(scene, camera, compiled_tracer);
+    uint64_t compiled_checksum;
+    render(compiled_tracer, camera, scene.max_depth, scheduler, metrics, compiled_checksum);
+    transform->translate(-0.5f, -0.25f, 0.5f);
+
+    bool match = refit_checksum == compiled_checksum;
+    std::cerr << scene.name << ": refit image " << (match ? "matches" : "DIFFERS from") << " recompiled image\n";
+    return match;
+}
+
+/**
+ * Benchmark one scene with each thread count.
+ */
+std::vector<RunResult> run_scene(cg::BenchScene &scene)
+{
+    cg::CameraNode camera;
+    set_up_camera(scene, camera);
+
+    cg::RayTracer ray_tracer(scene.root);
+    set_up_ray_tracer(scene, camera, ray_tracer);
+
+    std::vector<RunResult> results;
+    for(uint32_t threads : g_thread_counts)
+    {
+        cg::TileScheduler scheduler(threads, TILE_SIZE);
+        RunResult         result;
+        result.threads = threads;
+        for(uint32_t r = 0; r < g_repeat; ++r)
+        {
+            double wall_ms = render(ray_tracer, camera, scene.max_depth, scheduler, result.metrics, result.checksum);
+            if(r == 0 || wall_ms < result.wall_ms) { result.wall_ms = wall_ms; }
+        }
+        std::cerr << scene.name << ": " << threads << " threads " << std::fixed << std::setprecision(1)
+                  << result.wall_ms << " ms\n";
+        results.push_back(result);
+    }
+    return results;
+}
+
+/**
+ * Write the rays per second of one kind of ray.
+ */
+void write_rate(std::ostream &out, const char *name, uint64_t rays, double wall_ms)
+{
+    out << "          \"" << name << "_rays\": " << rays << ",\n";
+    out << "          \"" << name << "_rays_per_sec\": " << std::fixed << std::setprecision(0)
+        << (wall_ms > 0.0 ? rays * 1000.0 / wall_ms : 0.0) << ",\n";
+}
+
+/**
+ * Write the results as JSON. Scaling efficiency is the speedup over the
+ * first thread count divided by the increase in threads.
+ */
+void write_json(std::ostream                              &out,
+                const std::vector<cg::BenchScene>         &scenes,
+                const std::vector<std::vector<RunResult>> &results)
+{
+    out << "{\n";
+    out << "  \"width\": " << g_image_width << ",\n";
+    out << "  \"height\": " << g_image_height << ",\n";
+    out << "  \"repeat\": " << g_repeat << ",\n";
+    out << "  \"simd_width\": " << cg::SIMD_WIDTH << ",\n";
+    out << "  \"wavefront\": " << (g_wavefront ? "true" : "false") << ",\n";
+    out << "  \"russian_roulette\": " << (g_russian_roulette ? "true" : "false") << ",\n";
+    out << "  \"light_samples\": " << g_light_samples << ",\n";
+    out << "  \"occluder_cache\": " << (g_occluder_cache ? "true" : "false") << ",\n";
+    out << "  \"ray_counts\": " << (cg::RAY_COUNTS_ENABLED ? "true" : "false") << ",\n";
+    out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    out << "  \"scenes\": [\n";
+    for(size_t s = 0; s < scenes.size(); ++s)
+    {
+        const std::vector<RunResult> &runs = results[s];
+        out << "    {\n";
+        out << "      \"name\": \"" << scenes[s].name << "\",\n";
+        out << "      \"max_depth\": " << scenes[s].max_depth << ",\n";
+        out << "      \"runs\": [\n";
+        for(size_t r = 0; r < runs.size(); ++r)
+        {
+            const RunResult     &run = runs[r];
+            const RunResult     &base = runs.front();
+            double               speedup = base.wall_ms / run.wall_ms;
+            double               efficiency = speedup * base.threads / run.threads;
+            const cg::RayCounts &rays = run.metrics.rays;
+            uint64_t             total = rays.primary + rays.secondary() + rays.shadow;
+
+            std::ostringstream checksum;
+            checksum << std::hex << std::setw(16) << std::setfill('0') << run.checksum;
+
+            out << "        {\n";
+            out << "          \"threads\": " << run.threads << ",\n";
+            out << "          \"wall_ms\": " << std::fixed << std::setprecision(3) << run.wall_ms << ",\n";
+            write_rate(out, "primary", rays.primary, run.wall_ms);
+            write_rate(out, "secondary", rays.secondary(), run.wall_ms);
+            write_rate(out, "shadow", rays.shadow, run.wall_ms);
+            write_rate(out, "total", total, run.wall_ms);
+            out << "          \"terminated_rays\": " << rays.terminated << ",\n";
+            out << "          \"occluder_hit_rate\": " << std::setprecision(3) << rays.occluder_hit_rate() << ",\n";
+            out << "          \"metrics\": ";
+            run.metrics.write_json(out);
+            out << ",\n";
+            out << "          \"speedup\": " << std::setprecision(3) << speedup << ",\n";
+            out << "          \"scaling_efficiency\": " << efficiency << ",\n";
+            out << "          \"checksum\": \"" << checksum.str() << "\"\n";
+            out << "        }" << (r + 1 < runs.size() ? "," : "") << "\n";
+        }
+        out << "      ]\n";
+        out << "    }" << (s + 1 < scenes.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+/**
+ * Parse a command line value as a decimal integer.
+ * @param  value   Text of the value.
+ * @param  number  (OUT) Parsed integer.
+ * @return  Returns false if the text is not entirely an integer in range.
+ */
+bool parse_integer(const char *value, int32_t &number)
+{
+    char *end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(value, &end, 10);
+    if(end == value || *end != '\0' || errno == ERANGE || parsed < INT32_MIN || parsed > INT32_MAX)
+    {
+        return false;
+    }
+    number = static_cast<int32_t>(parsed);
+    return true;
+}
+
+/**
+ * Parse a comma separated list of thread counts.
+ * @return Returns false if the list is invalid.
+ */
+bool parse_thread_counts(const char *list)
+{
+    g_thread_counts.clear();
+    std::stringstream ss(list);
+    std::string       item;
+    while(std::getline(ss, item, ','))
+    {
+        int32_t threads = 0;
+        if(!parse_integer(item.c_str(), threads) || threads <= 0) { return false; }
+        g_thread_counts.push_back(static_cast<uint32_t>(threads));
+    }
+    return !g_thread_counts.empty();
+}
+
+/**
+ * Parse the command line.
+ * @return  Returns false if the command line is invalid or help was requested.
+ */
+bool parse_command_line(int argc, char **argv)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        if(std::strcmp(arg, "--help") == 0) { return false; }
+
+        // Remaining options all take a value
+        if(i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << '\n';
+            return false;
+        }
+        const char *value = argv[++i];
+
+        // Numeric options are rejected unless the whole value is an integer
+        int32_t number = 0;
+        bool    numeric = parse_integer(value, number);
+        bool    valid = true;
+        if(std::strcmp(arg, "-o") == 0 || std::strcmp(arg, "--output") == 0) { g_output_file = value; }
+        else if(std::strcmp(arg, "--scene") == 0) { g_scene_filter = value; }
+        else if(std::strcmp(arg, "--threads") == 0) { valid = parse_thread_counts(value); }
+        else if(std::strcmp(arg, "--width") == 0) { valid = numeric && (g_image_width = number) > 0; }
+        else if(std::strcmp(arg, "--height") == 0) { valid = numeric && (g_image_height = number) > 0; }
+        else if(std::strcmp(arg, "--wavefront") == 0)
+        {
+            g_wavefront = number != 0;
+            valid = numeric;
+        }
+        else if(std::strcmp(arg, "--roulette") == 0)
+        {
+            g_russian_roulette = number != 0;
+            valid = numeric;
+        }
+        else if(std::strcmp(arg, "--occluder-cache") == 0)
+        {
+            g_occluder_cache = number != 0;
+            valid = numeric;
+        }
+        else if(std::strcmp(arg, "--light-samples") == 0)
+        {
+            g_light_samples = static_cast<uint32_t>(std::max(number, 0));
+            valid = numeric && number >= 0;
+        }
+        else if(std::strcmp(arg, "--repeat") == 0)
+        {
+            g_repeat = static_cast<uint32_t>(std::max(number, 0));
+            valid = numeric && g_repeat > 0;
+        }
+        else { valid = false; }
+
+        if(!valid)
+        {
+            std::cerr << "Invalid option " << arg << " " << value << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Main
+ */
+int main(int argc, char **argv)
+{
+    cg::set_root_paths(argv[0]);
+    cg::init_logging("RayTracerBench.log");
+
+    if(!parse_command_line(argc, argv))
+    {
+        std::cerr << "Usage: RayTracerBench [--width w] [--height h] [--threads 1,2,4] [--repeat n]\n"
+                     "                      [--scene name] [--wavefront 0|1] [--roulette 0|1]\n"
+                     "                      [--light-samples n] [--occluder-cache 0|1]\n"
+                     "                      [-o|--output results.json]\n"
+                     "Thread counts default to powers of 2 up to the hardware thread count.\n";
+        exit(1);
+    }
+
+    // Default thread counts: 1, 2, 4, ... and the hardware thread count
+    if(g_thread_counts.empty())
+    {
+        uint32_t hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        for(uint32_t threads = 1; threads < hardware_threads; threads *= 2) { g_thread_counts.push_back(threads); }
+        g_thread_counts.push_back(hardware_threads);
+    }
+
+    std::vector<cg::BenchScene> scenes = cg::construct_bench_scenes();
+    cg::log_texture_cache_report();
+    if(!g_scene_filter.empty())
+    {
+        scenes.erase(std::remove_if(scenes.begin(),
+                                    scenes.end(),
+                                    [](const cg::BenchScene &scene) { return scene.name != g_scene_filter; }),
+                     scenes.end());
+        if(scenes.empty())
+        {
+            std::cerr << "Unknown scene " << g_scene_filter << '\n';
+            exit(1);
+        }
+    }
+
+    // Refit checks run after the timed renders so they cannot change them
+    std::vector<std::vector<RunResult>> results;
+    bool                                refit_matches = true;
+    for(cg::BenchScene &scene : scenes)
+    {
+        results.push_back(run_scene(scene));
+        refit_matches = check_refit(scene) && refit_matches;
+    }
+
+    if(g_output_file.empty()) { write_json(std::cout, scenes, results); }
+    else
+    {
+        std::ofstream out(g_output_file);
+        write_json(out, scenes, results);
+        if(!out)
+        {
+            std::cerr << "Error writing " << g_output_file << '\n';
+            return 1;
+        }
+    }
+    return refit_matches ? 0 : 1;
+}
@@ -45,6 +45,9 @@ std::shared_ptr<cg::LightNode> Spotlight;
 
 cg::SceneState g_scene_state;
 
+// Loads textures in the background while the scene is shown
+std::unique_ptr<cg::AssetLoader> g_asset_loader;
+
 // While mouse button is down, the view will be updated
 bool    g_animate = false;
 bool    g_forward = true;
@@ -390,8 +393,8 @@ std::shared_ptr<cg::SceneNode>
                                                                  cg::Color4(0.2f, 0.2f, 0.2f),
                                                                  cg::Color4(0.0f, 0.0f, 0.0f),
                                                                  5.0f);
-    floor_material->set_texture(
-        "textures/floor_tiles.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    g_asset_loader->load_texture(
+        floor_material, "textures/floor_tiles.jpg", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
 
     // Make the walls reddish, slightly shiny
     auto wall_material = std::make_shared<cg::PresentationNode>(cg::Color4(0.35f, 0.225f, 0.275f),
@@ -585,11 +588,12 @@ std::shared_ptr<cg::SceneNode>
                                                                  cg::Color4(1.0f, 1.0f, 1.0f),
                                                                  cg::Color4(0.0f, 0.0f, 0.0f),
                                                                  85.0f);
-    globe_material->set_texture("textures/earthp2.jpg",
-                                GL_CLAMP_TO_EDGE,
-                                GL_CLAMP_TO_EDGE,
-                                GL_LINEAR_MIPMAP_LINEAR,
-                                GL_LINEAR);
+    g_asset_loader->load_texture(globe_material,
+                                 "textures/earthp2.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
 
     // Sphere
     auto sphere_transform = std::make_shared<cg::TransformNode>();
@@ -617,11 +621,12 @@ std::shared_ptr<cg::SceneNode>
                                                                    cg::Color4(0.1f, 0.1f, 0.1f),
                                                                    cg::Color4(0.0f, 0.0f, 0.0f),
                                                                    5.0f);
-    picture_material->set_texture("textures/dogs_poker.jpg",
-                                  GL_CLAMP_TO_EDGE,
-                                  GL_CLAMP_TO_EDGE,
-                                  GL_LINEAR_MIPMAP_LINEAR,
-                                  GL_LINEAR);
+    g_asset_loader->load_texture(picture_material,
+                                 "textures/dogs_poker.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
 
     // Transform
     auto painting_transform = std::make_shared<cg::TransformNode>();
@@ -718,6 +723,10 @@ void construct_scene()
         exit(-1);
     }
 
+    // Textures are decoded on worker threads and finished in the main loop.
+    // Until then materials show their colors.
+    g_asset_loader = std::make_unique<cg::AssetLoader>();
+
     // Get the position, texture, and normal locations to use when constructing VAOs
     int32_t position_loc = shader->get_position_loc();
     int32_t normal_loc = shader->get_normal_loc();
@@ -778,11 +787,12 @@ void construct_scene()
                                                                cg::Color4(0.5f, 0.5f, 0.5f),
                                                                cg::Color4(0.0f, 0.0f, 0.0f),
                                                                50.0f);
-    coke_texture->set_texture("textures/cokecan.jpg",
-                              GL_CLAMP_TO_EDGE,
-                              GL_CLAMP_TO_EDGE,
-                              GL_LINEAR_MIPMAP_LINEAR,
-                              GL_LINEAR);
+    g_asset_loader->load_texture(coke_texture,
+                                 "textures/cokecan.jpg",
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_CLAMP_TO_EDGE,
+                                 GL_LINEAR_MIPMAP_LINEAR,
+                                 GL_LINEAR);
 
     // Transform
     auto coke_transform = std::make_shared<cg::TransformNode>();
@@ -992,6 +1002,18 @@ int main(int argc, char **argv)
 
         if(event_result & cg::EventType::EXIT) break;
 
+        // Finish any textures loaded since the last frame and redraw to show them
+        if(g_asset_loader && g_asset_loader->update() > 0)
+        {
+            if(g_asset_loader->get_pending_count() == 0)
+            {
+                // Log the textures loaded and the memory they use
+                cg::log_texture_cache_report();
+                g_asset_loader.reset();
+            }
+            display();
+        }
+
         if(g_animate)
         {
             update_view(g_mouse_x, g_mouse_y, g_forward);
@@ -1007,6 +1029,9 @@ int main(int argc, char **argv)
         sleep(DRAW_INTERVAL_MILLIS);
     }
 
+    // Stop loading before the GL context is destroyed
+    g_asset_loader.reset();
+
     // Destroy OpenGL Context, SDL Window and SDL
     SDL_GL_DestroyContext(g_gl_context);
     SDL_DestroyWindow(g_sdl_window);
@@ -89,6 +89,11 @@ Point3 AABB::max_pt() const
     return max_;
 }
 
+bool AABB::is_empty() const
+{
+    return min_.x > max_.x || min_.y > max_.y || min_.z > max_.z;
+}
+
 void compute_center()
 {
     // Complete in 605.767
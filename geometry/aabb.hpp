@@ -72,6 +72,13 @@ struct AABB
      */
     Point3 max_pt() const;
 
+    /**
+     * Is the box empty (minimum greater than maximum along some axis). The
+     * default constructed box is empty.
+     * @return  Returns true if the box is empty.
+     */
+    bool is_empty() const;
+
     /**
      * Compute center and half diagonal
      */
@@ -0,0 +1,444 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    bvh.cpp
+//	Purpose: Binned SAH construction and flattening of the bounding volume
+//           hierarchy.
+//============================================================================
+
+#include "geometry/bvh.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace cg
+{
+
+namespace
+{
+
+// Number of bins used to evaluate the SAH along each axis
+constexpr uint32_t SAH_BIN_COUNT = 16;
+
+// Relative cost of a node traversal step vs. a primitive intersection
+constexpr float SAH_TRAVERSAL_COST = 1.0f;
+constexpr float SAH_INTERSECT_COST = 1.0f;
+
+// Lightweight bounds used while building
+struct Bounds
+{
+    float min[3] = {std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max(),
+                    std::numeric_limits<float>::max()};
+    float max[3] = {std::numeric_limits<float>::lowest(),
+                    std::numeric_limits<float>::lowest(),
+                    std::numeric_limits<float>::lowest()};
+
+    void merge(const Bounds &b)
+    {
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            min[a] = std::min(min[a], b.min[a]);
+            max[a] = std::max(max[a], b.max[a]);
+        }
+    }
+
+    void merge(const float *p)
+    {
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            min[a] = std::min(min[a], p[a]);
+            max[a] = std::max(max[a], p[a]);
+        }
+    }
+
+    float surface_area() const
+    {
+        float dx = max[0] - min[0];
+        float dy = max[1] - min[1];
+        float dz = max[2] - min[2];
+        if(dx < 0.0f || dy < 0.0f || dz < 0.0f) return 0.0f;
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+struct Centroid
+{
+    float c[3];
+};
+
+struct BuildNode
+{
+    Bounds                     bounds;
+    uint32_t                   first = 0;
+    uint32_t                   count = 0;
+    uint8_t                    axis = 0;
+    std::unique_ptr<BuildNode> children[2];
+};
+
+struct BuildContext
+{
+    const std::vector<Bounds>   &bounds;
+    const std::vector<Centroid> &centroids;
+    std::vector<uint32_t>       &indices;
+    uint32_t                     max_leaf_size;
+    std::atomic<int32_t>         available_threads;
+    std::atomic<uint32_t>        node_count;
+    std::atomic<uint32_t>        leaf_count;
+    std::atomic<uint32_t>        max_depth;
+
+    BuildContext(const std::vector<Bounds>   &b,
+                 const std::vector<Centroid> &c,
+                 std::vector<uint32_t>       &i,
+                 uint32_t                     leaf_size,
+                 int32_t                      threads)
+        : bounds(b), centroids(c), indices(i), max_leaf_size(leaf_size),
+          available_threads(threads), node_count(0), leaf_count(0), max_depth(0)
+    {
+    }
+
+    bool acquire_thread()
+    {
+        if(available_threads.fetch_sub(1) > 0) return true;
+        available_threads.fetch_add(1);
+        return false;
+    }
+
+    void release_thread() { available_threads.fetch_add(1); }
+};
+
+std::unique_ptr<BuildNode> make_leaf(BuildContext &ctx, const Bounds &bounds, uint32_t first,
+                                     uint32_t count, uint32_t depth)
+{
+    auto node = std::make_unique<BuildNode>();
+    node->bounds = bounds;
+    node->first = first;
+    node->count = count;
+    ctx.node_count.fetch_add(1);
+    ctx.leaf_count.fetch_add(1);
+
+    uint32_t prev = ctx.max_depth.load();
+    while(depth > prev && !ctx.max_depth.compare_exchange_weak(prev, depth)) {}
+    return node;
+}
+
+// Number of median splits needed to bring a primitive count within a leaf
+uint32_t halvings_to_leaf(uint32_t count)
+{
+    uint32_t halvings = 0;
+    for(; count > MAX_LEAF_PRIMITIVES; ++halvings) { count = (count + 1) / 2; }
+    return halvings;
+}
+
+std::unique_ptr<BuildNode> build_recursive(BuildContext &ctx, uint32_t first, uint32_t last,
+                                           uint32_t depth);
+
+std::unique_ptr<BuildNode> make_interior(BuildContext &ctx, const Bounds &bounds, uint32_t axis,
+                                         uint32_t first, uint32_t mid, uint32_t last, uint32_t depth)
+{
+    auto node = std::make_unique<BuildNode>();
+    node->bounds = bounds;
+    node->axis = static_cast<uint8_t>(axis);
+    ctx.node_count.fetch_add(1);
+
+    if(last - first >= PARALLEL_BUILD_THRESHOLD && ctx.acquire_thread())
+    {
+        std::thread left_thread(
+            [&]() { node->children[0] = build_recursive(ctx, first, mid, depth + 1); });
+        node->children[1] = build_recursive(ctx, mid, last, depth + 1);
+        left_thread.join();
+        ctx.release_thread();
+    }
+    else
+    {
+        node->children[0] = build_recursive(ctx, first, mid, depth + 1);
+        node->children[1] = build_recursive(ctx, mid, last, depth + 1);
+    }
+    return node;
+}
+
+std::unique_ptr<BuildNode> build_recursive(BuildContext &ctx, uint32_t first, uint32_t last,
+                                           uint32_t depth)
+{
+    const uint32_t count = last - first;
+
+    // Bounds of the primitives and of their centroids
+    Bounds bounds, centroid_bounds;
+    for(uint32_t i = first; i < last; ++i)
+    {
+        uint32_t p = ctx.indices[i];
+        bounds.merge(ctx.bounds[p]);
+        centroid_bounds.merge(ctx.centroids[p].c);
+    }
+
+    // The median splits below guarantee a leaf at the depth limit holds at
+    // most MAX_LEAF_PRIMITIVES
+    if(count <= ctx.max_leaf_size || depth + 1 >= BVH_MAX_DEPTH)
+    {
+        return make_leaf(ctx, bounds, first, count, depth);
+    }
+
+    // Near the depth limit split at the centroid median of the widest axis.
+    // Each median split halves the count where an SAH split may not, so the
+    // remaining levels still reach leaves that fit.
+    if(depth + halvings_to_leaf(count) + 2 >= BVH_MAX_DEPTH)
+    {
+        uint32_t axis = 0;
+        for(uint32_t a = 1; a < 3; ++a)
+        {
+            if(centroid_bounds.max[a] - centroid_bounds.min[a] >
+               centroid_bounds.max[axis] - centroid_bounds.min[axis])
+            {
+                axis = a;
+            }
+        }
+        uint32_t mid = first + count / 2;
+        std::nth_element(ctx.indices.begin() + first,
+                         ctx.indices.begin() + mid,
+                         ctx.indices.begin() + last,
+                         [&](uint32_t a, uint32_t b) {
+                             return ctx.centroids[a].c[axis] < ctx.centroids[b].c[axis];
+                         });
+        return make_interior(ctx, bounds, axis, first, mid, last, depth);
+    }
+
+    // Evaluate the SAH at the bin boundaries along each axis
+    float    best_cost = std::numeric_limits<float>::max();
+    uint32_t best_axis = 0;
+    uint32_t best_bin = 0;
+    float    parent_area = bounds.surface_area();
+    for(uint32_t axis = 0; axis < 3; ++axis)
+    {
+        float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        if(extent <= 0.0f) continue;
+
+        Bounds   bin_bounds[SAH_BIN_COUNT];
+        uint32_t bin_counts[SAH_BIN_COUNT] = {0};
+        float    scale = static_cast<float>(SAH_BIN_COUNT) / extent;
+        for(uint32_t i = first; i < last; ++i)
+        {
+            uint32_t p = ctx.indices[i];
+            uint32_t b = std::min(
+                static_cast<uint32_t>((ctx.centroids[p].c[axis] - centroid_bounds.min[axis]) * scale),
+                SAH_BIN_COUNT - 1);
+            ++bin_counts[b];
+            bin_bounds[b].merge(ctx.bounds[p]);
+        }
+
+        // Sweep from the right to get the area and count above each boundary
+        float    right_area[SAH_BIN_COUNT];
+        uint32_t right_count[SAH_BIN_COUNT];
+        Bounds   acc;
+        uint32_t acc_count = 0;
+        for(uint32_t b = SAH_BIN_COUNT - 1; b > 0; --b)
+        {
+            acc.merge(bin_bounds[b]);
+            acc_count += bin_counts[b];
+            right_area[b] = acc.surface_area();
+            right_count[b] = acc_count;
+        }
+
+        // Sweep from the left and evaluate the cost of splitting below bin b
+        acc = Bounds();
+        acc_count = 0;
+        for(uint32_t b = 1; b < SAH_BIN_COUNT; ++b)
+        {
+            acc.merge(bin_bounds[b - 1]);
+            acc_count += bin_counts[b - 1];
+            if(acc_count == 0 || right_count[b] == 0) continue;
+
+            float cost = acc_count * acc.surface_area() + right_count[b] * right_area[b];
+            if(cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    // Compare the split against making a leaf
+    float leaf_cost = count * SAH_INTERSECT_COST;
+    float split_cost = best_cost < std::numeric_limits<float>::max() && parent_area > 0.0f ?
+                           SAH_TRAVERSAL_COST + SAH_INTERSECT_COST * best_cost / parent_area :
+                           std::numeric_limits<float>::max();
+    if(split_cost >= leaf_cost && count <= MAX_LEAF_PRIMITIVES)
+    {
+        return make_leaf(ctx, bounds, first, count, depth);
+    }
+
+    uint32_t mid;
+    if(split_cost < std::numeric_limits<float>::max())
+    {
+        float scale = static_cast<float>(SAH_BIN_COUNT) /
+                      (centroid_bounds.max[best_axis] - centroid_bounds.min[best_axis]);
+        float min_c = centroid_bounds.min[best_axis];
+        auto  split = std::partition(
+            ctx.indices.begin() + first, ctx.indices.begin() + last, [&](uint32_t p) {
+                uint32_t b = std::min(
+                    static_cast<uint32_t>((ctx.centroids[p].c[best_axis] - min_c) * scale),
+                    SAH_BIN_COUNT - 1);
+                return b < best_bin;
+            });
+        mid = static_cast<uint32_t>(split - ctx.indices.begin());
+    }
+    else
+    {
+        // All centroids coincide - split the list in half
+        mid = first + count / 2;
+    }
+    if(mid == first || mid == last) mid = first + count / 2;
+
+    return make_interior(ctx, bounds, best_axis, first, mid, last, depth);
+}
+
+void flatten(const BuildNode *build_node, std::vector<BVHNode> &nodes)
+{
+    uint32_t idx = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    for(uint32_t a = 0; a < 3; ++a)
+    {
+        nodes[idx].bounds_min[a] = build_node->bounds.min[a];
+        nodes[idx].bounds_max[a] = build_node->bounds.max[a];
+    }
+    nodes[idx].axis = build_node->axis;
+    nodes[idx].pad = 0;
+
+    if(build_node->children[0] == nullptr)
+    {
+        nodes[idx].offset = build_node->first;
+        nodes[idx].primitive_count = static_cast<uint16_t>(build_node->count);
+    }
+    else
+    {
+        nodes[idx].primitive_count = 0;
+        flatten(build_node->children[0].get(), nodes);
+        nodes[idx].offset = static_cast<uint32_t>(nodes.size());
+        flatten(build_node->children[1].get(), nodes);
+    }
+}
+
+} // namespace
+
+BVHRay::BVHRay(const Ray3 &ray)
+{
+    const float o[3] = {ray.o.x, ray.o.y, ray.o.z};
+    const float d[3] = {ray.d.x, ray.d.y, ray.d.z};
+    for(uint32_t a = 0; a < 3; ++a)
+    {
+        origin[a] = o[a];
+        inv_dir[a] = 1.0f / d[a];
+        dir_is_neg[a] = inv_dir[a] < 0.0f ? 1 : 0;
+    }
+}
+
+BVH::BVH() {}
+
+void BVH::build(const std::vector<AABB> &bounds, uint32_t max_leaf_size, uint32_t num_threads)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    clear();
+    stats_.primitive_count = static_cast<uint32_t>(bounds.size());
+    if(bounds.empty()) return;
+
+    // Convert to the build representation and compute centroids. Empty
+    // boxes are not added to the hierarchy.
+    std::vector<Bounds>   prim_bounds(bounds.size());
+    std::vector<Centroid> centroids(bounds.size());
+    primitive_indices_.reserve(bounds.size());
+    for(uint32_t i = 0; i < bounds.size(); ++i)
+    {
+        Point3 min_pt = bounds[i].min_pt();
+        Point3 max_pt = bounds[i].max_pt();
+        prim_bounds[i].min[0] = min_pt.x;
+        prim_bounds[i].min[1] = min_pt.y;
+        prim_bounds[i].min[2] = min_pt.z;
+        prim_bounds[i].max[0] = max_pt.x;
+        prim_bounds[i].max[1] = max_pt.y;
+        prim_bounds[i].max[2] = max_pt.z;
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            centroids[i].c[a] = 0.5f * (prim_bounds[i].min[a] + prim_bounds[i].max[a]);
+        }
+        if(!bounds[i].is_empty()) primitive_indices_.push_back(i);
+    }
+    if(primitive_indices_.empty()) return;
+
+    if(num_threads == 0) num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    BuildContext ctx(prim_bounds,
+                     centroids,
+                     primitive_indices_,
+                     std::max(std::min(max_leaf_size, MAX_LEAF_PRIMITIVES), 1u),
+                     static_cast<int32_t>(num_threads) - 1);
+
+    auto root =
+        build_recursive(ctx, 0, static_cast<uint32_t>(primitive_indices_.size()), 0);
+
+    nodes_.reserve(ctx.node_count.load());
+    flatten(root.get(), nodes_);
+
+    stats_.node_count = static_cast<uint32_t>(nodes_.size());
+    stats_.leaf_count = ctx.leaf_count.load();
+    stats_.max_depth = ctx.max_depth.load();
+    stats_.build_time_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::refit(const std::vector<AABB> &bounds)
+{
+    // Children are stored after their parent, so visiting nodes in reverse
+    // order updates both children before the parent
+    for(size_t idx = nodes_.size(); idx-- > 0;)
+    {
+        BVHNode &node = nodes_[idx];
+        Bounds   node_bounds;
+        if(node.is_leaf())
+        {
+            for(uint32_t slot = node.offset; slot < node.offset + node.primitive_count; ++slot)
+            {
+                const AABB &box = bounds[primitive_indices_[slot]];
+                Point3      p0 = box.min_pt();
+                Point3      p1 = box.max_pt();
+                float       box_min[3] = {p0.x, p0.y, p0.z};
+                float       box_max[3] = {p1.x, p1.y, p1.z};
+                node_bounds.merge(box_min);
+                node_bounds.merge(box_max);
+            }
+        }
+        else
+        {
+            for(uint32_t child : {static_cast<uint32_t>(idx + 1), node.offset})
+            {
+                node_bounds.merge(nodes_[child].bounds_min);
+                node_bounds.merge(nodes_[child].bounds_max);
+            }
+        }
+
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            node.bounds_min[a] = node_bounds.min[a];
+            node.bounds_max[a] = node_bounds.max[a];
+        }
+    }
+}
+
+void BVH::clear()
+{
+    nodes_.clear();
+    primitive_indices_.clear();
+    stats_ = BVHBuildStats();
+}
+
+AABB BVH::get_bounds() const
+{
+    if(nodes_.empty()) return AABB();
+    return AABB(Point3(nodes_[0].bounds_min[0], nodes_[0].bounds_min[1], nodes_[0].bounds_min[2]),
+                Point3(nodes_[0].bounds_max[0], nodes_[0].bounds_max[1], nodes_[0].bounds_max[2]));
+}
+
+} // namespace cg
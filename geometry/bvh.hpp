@@ -0,0 +1,394 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    bvh.hpp
+//	Purpose: Bounding volume hierarchy over axis aligned bounding boxes.
+//           Built with a binned surface area heuristic (SAH) and traversed
+//           front-to-back for closest hit and any hit ray queries.
+//============================================================================
+
+#ifndef __GEOMETRY_BVH_HPP__
+#define __GEOMETRY_BVH_HPP__
+
+#include "geometry/aabb.hpp"
+#include "geometry/ray3.hpp"
+#include "geometry/ray_packet.hpp"
+#include "geometry/trace_counters.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cg
+{
+
+// Maximum depth of the hierarchy. Traversal uses a fixed size stack of this size.
+constexpr uint32_t BVH_MAX_DEPTH = 64;
+
+// Largest primitive count of a leaf. The SAH can prefer one leaf over any
+// split of a cluster of overlapping primitives; past this count the cluster
+// is split anyway so no leaf becomes a long linear scan. Well within the
+// 16 bit primitive_count of a node.
+constexpr uint32_t MAX_LEAF_PRIMITIVES = 255;
+
+// Subtrees with at least this many primitives may be built on another thread
+constexpr uint32_t PARALLEL_BUILD_THRESHOLD = 4096;
+
+/**
+ * Node of a flattened BVH. Nodes are stored in depth-first order so the first
+ * child of an interior node immediately follows it. Only the index of the
+ * second child is stored. 32 bytes so 2 nodes share a cache line.
+ */
+struct BVHNode
+{
+    float    bounds_min[3];
+    float    bounds_max[3];
+    uint32_t offset;          // Leaf: first primitive slot. Interior: second child
+    uint16_t primitive_count; // Number of primitives (0 for interior nodes)
+    uint8_t  axis;            // Split axis (interior nodes)
+    uint8_t  pad;
+
+    bool is_leaf() const { return primitive_count > 0; }
+};
+
+/**
+ * Ray data precomputed once per ray for the slab tests performed at each node.
+ */
+struct BVHRay
+{
+    float    origin[3];
+    float    inv_dir[3];
+    uint32_t dir_is_neg[3];
+
+    /**
+     * Constructor.
+     * @param  ray  Ray being traced.
+     */
+    explicit BVHRay(const Ray3 &ray);
+
+    /**
+     * Slab test against the bounds of a node.
+     * @param  node    BVH node.
+     * @param  t_max   Maximum distance along the ray.
+     * @return Returns true if the ray enters the node bounds in [0, t_max].
+     */
+    bool intersect(const BVHNode &node, float t_max) const
+    {
+        float t0 = 0.0f;
+        float t1 = t_max;
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            float t_near = ((dir_is_neg[a] ? node.bounds_max[a] : node.bounds_min[a]) - origin[a]) *
+                           inv_dir[a];
+            float t_far = ((dir_is_neg[a] ? node.bounds_min[a] : node.bounds_max[a]) - origin[a]) *
+                          inv_dir[a];
+
+            // Pad the far distance so that rounding never culls a touching box.
+            // Comparisons are written so a NaN (ray in the slab plane) is ignored.
+            t_far *= 1.00000024f;
+            if(t_near > t0) t0 = t_near;
+            if(t_far < t1) t1 = t_far;
+            if(t0 > t1) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * Statistics gathered while building a BVH.
+ */
+struct BVHBuildStats
+{
+    uint32_t primitive_count = 0;
+    uint32_t node_count = 0;
+    uint32_t leaf_count = 0;
+    uint32_t max_depth = 0;
+    double   build_time_ms = 0.0;
+};
+
+/**
+ * Bounding volume hierarchy. Primitives are described only by their bounding
+ * boxes; callers intersect the primitives themselves through the leaf callback
+ * supplied to the traversal methods.
+ */
+class BVH
+{
+  public:
+    /**
+     * Constructor. Creates an empty hierarchy.
+     */
+    BVH();
+
+    /**
+     * Build the hierarchy using a binned SAH. Subtrees above a size threshold
+     * are built in parallel.
+     * @param  bounds         Bounding box of each primitive.
+     * @param  max_leaf_size  Primitive count at or below which a leaf is always made.
+     * @param  num_threads    Maximum threads used to build (0 uses all hardware threads).
+     */
+    void build(const std::vector<AABB> &bounds, uint32_t max_leaf_size = 4, uint32_t num_threads = 0);
+
+    /**
+     * Refit the hierarchy to new primitive bounds. The tree structure is kept
+     * and only node bounds are recomputed, which is much faster than a build
+     * but gives a less efficient tree as primitives move further from where
+     * they were when it was built.
+     * @param  bounds  Bounding box of each primitive, indexed as in the build.
+     */
+    void refit(const std::vector<AABB> &bounds);
+
+    /**
+     * Clear the hierarchy.
+     */
+    void clear();
+
+    /**
+     * Is the hierarchy empty.
+     * @return  Returns true if no nodes exist.
+     */
+    bool empty() const { return nodes_.empty(); }
+
+    /**
+     * Get the bounding box of the whole hierarchy.
+     * @return  Returns the bounds of the root node.
+     */
+    AABB get_bounds() const;
+
+    /**
+     * Get the flattened nodes.
+     */
+    const std::vector<BVHNode> &get_nodes() const { return nodes_; }
+
+    /**
+     * Get the primitive index stored at a leaf slot. Leaves reference the
+     * slots [offset, offset + primitive_count).
+     * @param  slot  Leaf slot.
+     * @return Returns the index of the primitive in the bounds list given to build.
+     */
+    uint32_t get_primitive_index(uint32_t slot) const { return primitive_indices_[slot]; }
+
+    /**
+     * Get the primitive indices in leaf order.
+     */
+    const std::vector<uint32_t> &get_primitive_indices() const { return primitive_indices_; }
+
+    /**
+     * Get statistics from the last build.
+     */
+    const BVHBuildStats &get_build_stats() const { return stats_; }
+
+    /**
+     * Closest hit traversal. Children are visited front-to-back and nodes
+     * beyond the closest hit found so far are culled.
+     * @param  ray    Ray to traverse.
+     * @param  t_max  (IN/OUT) Maximum distance. The leaf callback reduces this
+     *                as closer intersections are found.
+     * @param  leaf   Callback leaf(first_slot, count, t_max) that intersects
+     *                the primitives of a leaf.
+     */
+    template <typename LeafFunc>
+    void find_closest(const Ray3 &ray, float &t_max, LeafFunc &&leaf) const
+    {
+        if(nodes_.empty()) return;
+
+        BVHRay   bvh_ray(ray);
+        uint32_t stack[BVH_MAX_DEPTH];
+        uint32_t stack_size = 0;
+        uint32_t idx = 0;
+        uint32_t tests = 0;
+        uint32_t visits = 0;
+        while(true)
+        {
+            const BVHNode &node = nodes_[idx];
+            ++tests;
+            if(bvh_ray.intersect(node, t_max))
+            {
+                ++visits;
+                if(node.is_leaf()) { leaf(node.offset, node.primitive_count, t_max); }
+                else
+                {
+                    // Descend into the near child, defer the far child
+                    if(bvh_ray.dir_is_neg[node.axis])
+                    {
+                        stack[stack_size++] = idx + 1;
+                        idx = node.offset;
+                    }
+                    else
+                    {
+                        stack[stack_size++] = node.offset;
+                        idx = idx + 1;
+                    }
+                    continue;
+                }
+            }
+            if(stack_size == 0) break;
+            idx = stack[--stack_size];
+        }
+        COUNT_TRACE(aabb_tests, tests);
+        COUNT_TRACE(node_visits, visits);
+    }
+
+    /**
+     * Closest hit traversal of a ray packet. A node is visited if any lane
+     * enters it; the mask of those lanes is passed to the leaf callback so
+     * the primitive tests only consider them. Children are ordered using the
+     * direction of the first ray, which suits coherent (primary) packets.
+     * @param  packet  Rays to traverse.
+     * @param  t_max   (IN/OUT) Maximum distance per lane. The leaf callback
+     *                 reduces this as closer intersections are found.
+     * @param  leaf    Callback leaf(first_slot, count, lane_mask, t_max) that
+     *                 intersects the primitives of a leaf.
+     */
+    template <typename LeafFunc>
+    void find_closest(const RayPacket &packet, SimdFloat &t_max, LeafFunc &&leaf) const
+    {
+        if(nodes_.empty()) return;
+
+        uint32_t stack[BVH_MAX_DEPTH];
+        uint32_t stack_size = 0;
+        uint32_t idx = 0;
+        uint32_t tests = 0;
+        uint32_t visits = 0;
+        while(true)
+        {
+            const BVHNode &node = nodes_[idx];
+            SimdMask       mask = packet.intersect_box(node.bounds_min, node.bounds_max, t_max);
+            ++tests;
+            if(any(mask))
+            {
+                ++visits;
+                if(node.is_leaf()) { leaf(node.offset, node.primitive_count, mask, t_max); }
+                else
+                {
+                    if(packet.dir_is_neg[node.axis])
+                    {
+                        stack[stack_size++] = idx + 1;
+                        idx = node.offset;
+                    }
+                    else
+                    {
+                        stack[stack_size++] = node.offset;
+                        idx = idx + 1;
+                    }
+                    continue;
+                }
+            }
+            if(stack_size == 0) break;
+            idx = stack[--stack_size];
+        }
+        COUNT_TRACE(aabb_tests, tests);
+        COUNT_TRACE(node_visits, visits);
+    }
+
+    /**
+     * Any hit traversal. Stops as soon as the leaf callback reports a hit.
+     * @param  ray    Ray to traverse.
+     * @param  t_max  Maximum distance along the ray.
+     * @param  leaf   Callback leaf(first_slot, count) returning true if any
+     *                primitive of the leaf is hit closer than t_max.
+     * @return Returns true if a hit is found.
+     */
+    template <typename LeafFunc>
+    bool any_hit(const Ray3 &ray, float t_max, LeafFunc &&leaf) const
+    {
+        if(nodes_.empty()) return false;
+
+        BVHRay   bvh_ray(ray);
+        uint32_t stack[BVH_MAX_DEPTH];
+        uint32_t stack_size = 0;
+        uint32_t idx = 0;
+        uint32_t tests = 0;
+        uint32_t visits = 0;
+        bool     hit = false;
+        while(true)
+        {
+            const BVHNode &node = nodes_[idx];
+            ++tests;
+            if(bvh_ray.intersect(node, t_max))
+            {
+                ++visits;
+                if(node.is_leaf())
+                {
+                    if(leaf(node.offset, node.primitive_count))
+                    {
+                        hit = true;
+                        break;
+                    }
+                }
+                else
+                {
+                    if(bvh_ray.dir_is_neg[node.axis])
+                    {
+                        stack[stack_size++] = idx + 1;
+                        idx = node.offset;
+                    }
+                    else
+                    {
+                        stack[stack_size++] = node.offset;
+                        idx = idx + 1;
+                    }
+                    continue;
+                }
+            }
+            if(stack_size == 0) break;
+            idx = stack[--stack_size];
+        }
+        COUNT_TRACE(aabb_tests, tests);
+        COUNT_TRACE(node_visits, visits);
+        COUNT_TRACE(early_outs, hit ? 1 : 0);
+        return hit;
+    }
+
+    /**
+     * Point query. Visits every leaf whose bounds contain the point.
+     * @param  point  Point to locate.
+     * @param  leaf   Callback leaf(first_slot, count) for each leaf found.
+     */
+    template <typename LeafFunc>
+    void find_containing(const Point3 &point, LeafFunc &&leaf) const
+    {
+        if(nodes_.empty()) return;
+
+        const float p[3] = {point.x, point.y, point.z};
+        uint32_t    stack[BVH_MAX_DEPTH];
+        uint32_t    stack_size = 0;
+        uint32_t    idx = 0;
+        uint32_t    tests = 0;
+        uint32_t    visits = 0;
+        while(true)
+        {
+            const BVHNode &node = nodes_[idx];
+            ++tests;
+            bool inside = true;
+            for(uint32_t a = 0; a < 3; ++a)
+            {
+                inside = inside && p[a] >= node.bounds_min[a] && p[a] <= node.bounds_max[a];
+            }
+            if(inside)
+            {
+                ++visits;
+                if(node.is_leaf()) { leaf(node.offset, node.primitive_count); }
+                else
+                {
+                    stack[stack_size++] = node.offset;
+                    idx = idx + 1;
+                    continue;
+                }
+            }
+            if(stack_size == 0) break;
+            idx = stack[--stack_size];
+        }
+        COUNT_TRACE(aabb_tests, tests);
+        COUNT_TRACE(node_visits, visits);
+    }
+
+  private:
+    std::vector<BVHNode>  nodes_;
+    std::vector<uint32_t> primitive_indices_;
+    BVHBuildStats         stats_;
+};
+
+} // namespace cg
+
+#endif
@@ -1,6 +1,8 @@
 #include "geometry/ray3.hpp"
 
 #include "geometry/geometry.hpp"
+#include "geometry/simd.hpp"
+#include "geometry/triangle_block.hpp"
 
 #include <cmath>
 
@@ -285,23 +287,38 @@ RayTriangleIntersectResult
 
 bool Ray3::does_intersect_exist(const Point3 &v0, const Point3 &v1, const Point3 &v2) const
 {
-    // Required in 605.767
-    return false;
+    return intersect(v0, v1, v2).intersects;
 }
 
 RayMeshIntersectResult Ray3::intersect(const std::vector<Point3>   &vertex_list,
                                        const std::vector<uint16_t> &face_list,
                                        float                        t_min) const
 {
-    // Required in 605.767
-    return {false, 0.0f, 0.0f, 0.0f, 0};
+    RayMeshIntersectResult nearest = {false, t_min, 0.0f, 0.0f, 0};
+    for(uint32_t f = 0; f < face_list.size() / 3; ++f)
+    {
+        RayTriangleIntersectResult result = intersect(vertex_list[face_list[f * 3]],
+                                                      vertex_list[face_list[f * 3 + 1]],
+                                                      vertex_list[face_list[f * 3 + 2]]);
+        if(result.intersects && result.distance > EPSILON && result.distance < nearest.distance)
+        {
+            nearest = {true, result.distance, result.barycentric_u, result.barycentric_v, f};
+        }
+    }
+    if(!nearest.intersects) nearest.distance = 0.0f;
+    return nearest;
 }
 
 bool Ray3::does_intersect_exist(const std::vector<Point3>   &vertex_list,
                                 const std::vector<uint16_t> &face_list,
                                 float                        t_min) const
 {
-    // Required in 605.767
+    for(size_t i = 0; i + 2 < face_list.size(); i += 3)
+    {
+        RayTriangleIntersectResult result =
+            intersect(vertex_list[face_list[i]], vertex_list[face_list[i + 1]], vertex_list[face_list[i + 2]]);
+        if(result.intersects && result.distance > EPSILON && result.distance < t_min) return true;
+    }
     return false;
 }
 
@@ -309,7 +326,118 @@ bool Ray3::does_intersect_exist(const std::vector<VertexAndNormal> &vertex_list,
                                 const std::vector<uint16_t>        &face_list,
                                 float                               t_min) const
 {
-    // Required in 605.767
+    for(size_t i = 0; i + 2 < face_list.size(); i += 3)
+    {
+        RayTriangleIntersectResult result = intersect(vertex_list[face_list[i]].vertex,
+                                                      vertex_list[face_list[i + 1]].vertex,
+                                                      vertex_list[face_list[i + 2]].vertex);
+        if(result.intersects && result.distance > EPSILON && result.distance < t_min) return true;
+    }
+    return false;
+}
+
+namespace
+{
+
+// Ray components broadcast to every SIMD lane
+struct RayLanes
+{
+    SimdFloat ox, oy, oz;
+    SimdFloat dx, dy, dz;
+
+    explicit RayLanes(const Ray3 &ray)
+        : ox(ray.o.x), oy(ray.o.y), oz(ray.o.z), dx(ray.d.x), dy(ray.d.y), dz(ray.d.z)
+    {
+    }
+};
+
+// Moller-Trumbore test of one ray against SIMD_WIDTH triangles of a block
+// starting at slot first. Same arithmetic (and so the same results) as
+// Ray3::intersect(v0, v1, v2). Degenerate padding slots have det = 0 and
+// are rejected with the back faces.
+SimdMask intersect_block_lanes(const RayLanes      &r,
+                               const TriangleBlock &block,
+                               uint32_t             first,
+                               SimdFloat           &t,
+                               SimdFloat           &u,
+                               SimdFloat           &v)
+{
+    SimdFloat e1x = SimdFloat::load(block.e1x + first);
+    SimdFloat e1y = SimdFloat::load(block.e1y + first);
+    SimdFloat e1z = SimdFloat::load(block.e1z + first);
+    SimdFloat e2x = SimdFloat::load(block.e2x + first);
+    SimdFloat e2y = SimdFloat::load(block.e2y + first);
+    SimdFloat e2z = SimdFloat::load(block.e2z + first);
+
+    // pvec = d x edge2, det = edge1 . pvec
+    SimdFloat px = r.dy * e2z - r.dz * e2y;
+    SimdFloat py = r.dz * e2x - r.dx * e2z;
+    SimdFloat pz = r.dx * e2y - r.dy * e2x;
+    SimdFloat det = e1x * px + e1y * py + e1z * pz;
+    SimdMask  hit = det >= SimdFloat(EPSILON);
+    if(none(hit)) return hit;
+    SimdFloat inv_det = SimdFloat(1.0f) / det;
+
+    // u parameter: tvec = o - v0
+    SimdFloat tx = r.ox - SimdFloat::load(block.v0x + first);
+    SimdFloat ty = r.oy - SimdFloat::load(block.v0y + first);
+    SimdFloat tz = r.oz - SimdFloat::load(block.v0z + first);
+    u = (tx * px + ty * py + tz * pz) * inv_det;
+    hit = hit & (u >= SimdFloat(0.0f)) & (u <= SimdFloat(1.0f));
+    if(none(hit)) return hit;
+
+    // v parameter: qvec = tvec x edge1
+    SimdFloat qx = ty * e1z - tz * e1y;
+    SimdFloat qy = tz * e1x - tx * e1z;
+    SimdFloat qz = tx * e1y - ty * e1x;
+    v = (r.dx * qx + r.dy * qy + r.dz * qz) * inv_det;
+    hit = hit & (v >= SimdFloat(0.0f)) & (u + v <= SimdFloat(1.0f));
+    if(none(hit)) return hit;
+
+    t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+    return hit;
+}
+
+} // namespace
+
+RayMeshIntersectResult Ray3::intersect(const TriangleBlock &block, float t_min) const
+{
+    RayMeshIntersectResult nearest = {false, t_min, 0.0f, 0.0f, 0};
+    RayLanes               r(*this);
+    for(uint32_t first = 0; first < block.count; first += SIMD_WIDTH)
+    {
+        SimdFloat t, u, v;
+        SimdMask  hit = intersect_block_lanes(r, block, first, t, u, v);
+        hit = hit & (t > SimdFloat(EPSILON)) & (t < SimdFloat(nearest.distance));
+        uint32_t lanes = hit.bits();
+        if(lanes == 0) continue;
+
+        // Nearest lane. Ties go to the lowest slot, as in a sequential search.
+        float t_lanes[SIMD_WIDTH], u_lanes[SIMD_WIDTH], v_lanes[SIMD_WIDTH];
+        t.store(t_lanes);
+        u.store(u_lanes);
+        v.store(v_lanes);
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i)
+        {
+            if((lanes & (1u << i)) && t_lanes[i] < nearest.distance)
+            {
+                nearest = {true, t_lanes[i], u_lanes[i], v_lanes[i], block.face_index[first + i]};
+            }
+        }
+    }
+    if(!nearest.intersects) nearest.distance = 0.0f;
+    return nearest;
+}
+
+bool Ray3::does_intersect_exist(const TriangleBlock &block, float t_min) const
+{
+    RayLanes r(*this);
+    for(uint32_t first = 0; first < block.count; first += SIMD_WIDTH)
+    {
+        SimdFloat t, u, v;
+        SimdMask  hit = intersect_block_lanes(r, block, first, t, u, v);
+        if(any(hit & (t > SimdFloat(EPSILON)) & (t < SimdFloat(t_min)))) return true;
+    }
     return false;
 }
 
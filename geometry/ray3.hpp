@@ -29,6 +29,7 @@ struct RayRefractionResult;
 struct RayObjectIntersectResult;
 struct RayTriangleIntersectResult;
 struct RayMeshIntersectResult;
+struct TriangleBlock;
 
 /**
  * 3D ray
@@ -190,6 +191,27 @@ struct Ray3
     bool does_intersect_exist(const std::vector<VertexAndNormal> &vertex_list,
                               const std::vector<uint16_t>        &face_list,
                               float                               t_min) const;
+
+    /**
+     * Calculates the nearest intersect of the ray with the triangles of a block,
+     * testing SIMD_WIDTH triangles at a time. Back faces are culled as in
+     * intersect(v0, v1, v2). Only intersections with EPSILON < t < t_min count.
+     * @param block  Block of triangles.
+     * @param t_min  Current minimum intersection (t) value along the ray.
+     * @return Returns whether or not there is an intersection, the distance,
+     *         the barycentric coordinates of intersection, and the face index
+     *         stored in the block for the triangle hit.
+     */
+    RayMeshIntersectResult intersect(const TriangleBlock &block, float t_min) const;
+
+    /**
+     * Does an intersection exist between the ray and any triangle of a block
+     * with EPSILON < t < t_min.
+     * @param block  Block of triangles.
+     * @param t_min  t value for intersection.
+     * @return Returns true if an intersection exists, false if not.
+     */
+    bool does_intersect_exist(const TriangleBlock &block, float t_min) const;
 };
 
 struct RayRefractionResult
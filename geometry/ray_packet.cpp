@@ -0,0 +1,128 @@
+#include "geometry/ray_packet.hpp"
+
+#include "geometry/geometry.hpp"
+
+namespace cg
+{
+
+RayPacket::RayPacket(const Ray3 *packet_rays, uint32_t ray_count) : count(ray_count), rays(packet_rays)
+{
+    // Unused lanes repeat the first ray so they never produce NaNs
+    float o[3][SIMD_WIDTH];
+    float d[3][SIMD_WIDTH];
+    float inv[3][SIMD_WIDTH];
+    for(uint32_t i = 0; i < SIMD_WIDTH; ++i)
+    {
+        const Ray3 &r = packet_rays[i < count ? i : 0];
+        o[0][i] = r.o.x;
+        o[1][i] = r.o.y;
+        o[2][i] = r.o.z;
+        d[0][i] = r.d.x;
+        d[1][i] = r.d.y;
+        d[2][i] = r.d.z;
+        for(uint32_t a = 0; a < 3; ++a) { inv[a][i] = 1.0f / d[a][i]; }
+    }
+
+    ox = SimdFloat::load(o[0]);
+    oy = SimdFloat::load(o[1]);
+    oz = SimdFloat::load(o[2]);
+    dx = SimdFloat::load(d[0]);
+    dy = SimdFloat::load(d[1]);
+    dz = SimdFloat::load(d[2]);
+    inv_dx = SimdFloat::load(inv[0]);
+    inv_dy = SimdFloat::load(inv[1]);
+    inv_dz = SimdFloat::load(inv[2]);
+    neg_x = inv_dx < SimdFloat(0.0f);
+    neg_y = inv_dy < SimdFloat(0.0f);
+    neg_z = inv_dz < SimdFloat(0.0f);
+    active = SimdMask::from_bits((1u << count) - 1);
+    for(uint32_t a = 0; a < 3; ++a) { dir_is_neg[a] = inv[a][0] < 0.0f ? 1 : 0; }
+}
+
+SimdMask RayPacket::intersect(const AABB &box, const SimdFloat &t_max) const
+{
+    Point3 p0 = box.min_pt();
+    Point3 p1 = box.max_pt();
+    float  bounds_min[3] = {p0.x, p0.y, p0.z};
+    float  bounds_max[3] = {p1.x, p1.y, p1.z};
+    return intersect_box(bounds_min, bounds_max, t_max);
+}
+
+SimdMask RayPacket::intersect(const BoundingSphere &sphere, SimdFloat &t) const
+{
+    // Vector from ray origin to sphere center and its squared length
+    SimdFloat lx = SimdFloat(sphere.center.x) - ox;
+    SimdFloat ly = SimdFloat(sphere.center.y) - oy;
+    SimdFloat lz = SimdFloat(sphere.center.z) - oz;
+    SimdFloat l2 = lx * lx + ly * ly + lz * lz;
+
+    // Distance along the ray to the closest point to the sphere center
+    SimdFloat s = lx * dx + ly * dy + lz * dz;
+    SimdFloat r2(sphere.radius * sphere.radius);
+
+    // Miss if the sphere is behind an origin outside the sphere, or if the
+    // ray passes outside the sphere
+    SimdFloat m2 = l2 - s * s;
+    SimdMask  miss = ((s < SimdFloat(0.0f)) & (l2 > r2)) | (m2 > r2);
+    SimdMask  hit = andnot(active, miss);
+
+    // Near intersection if the origin is outside the sphere, far if inside
+    SimdFloat q = sqrt(max(r2 - m2, SimdFloat(0.0f)));
+    SimdMask  outside = (l2 - r2) > SimdFloat(EPSILON);
+    t = select(outside, s - q, s + q);
+    return hit;
+}
+
+SimdMask RayPacket::intersect(const Point3 &v0,
+                              const Point3 &v1,
+                              const Point3 &v2,
+                              SimdFloat    &t,
+                              SimdFloat    &u,
+                              SimdFloat    &v) const
+{
+    return intersect(v0, Vector3(v0, v1), Vector3(v0, v2), t, u, v);
+}
+
+SimdMask RayPacket::intersect(const Point3  &v0,
+                              const Vector3 &edge1,
+                              const Vector3 &edge2,
+                              SimdFloat     &t,
+                              SimdFloat     &u,
+                              SimdFloat     &v) const
+{
+    // Edge vectors are shared by all lanes
+    SimdFloat e1x(edge1.x), e1y(edge1.y), e1z(edge1.z);
+    SimdFloat e2x(edge2.x), e2y(edge2.y), e2z(edge2.z);
+
+    // pvec = d x edge2, det = edge1 . pvec. Back faces and rays parallel to
+    // the triangle are rejected.
+    SimdFloat px = dy * e2z - dz * e2y;
+    SimdFloat py = dz * e2x - dx * e2z;
+    SimdFloat pz = dx * e2y - dy * e2x;
+    SimdFloat det = e1x * px + e1y * py + e1z * pz;
+    SimdMask  hit = (det >= SimdFloat(EPSILON)) & active;
+    if(none(hit)) return hit;
+    SimdFloat inv_det = SimdFloat(1.0f) / det;
+
+    // u parameter
+    SimdFloat tx = ox - SimdFloat(v0.x);
+    SimdFloat ty = oy - SimdFloat(v0.y);
+    SimdFloat tz = oz - SimdFloat(v0.z);
+    u = (tx * px + ty * py + tz * pz) * inv_det;
+    hit = hit & (u >= SimdFloat(0.0f)) & (u <= SimdFloat(1.0f));
+    if(none(hit)) return hit;
+
+    // v parameter: qvec = tvec x edge1
+    SimdFloat qx = ty * e1z - tz * e1y;
+    SimdFloat qy = tz * e1x - tx * e1z;
+    SimdFloat qz = tx * e1y - ty * e1x;
+    v = (dx * qx + dy * qy + dz * qz) * inv_det;
+    hit = hit & (v >= SimdFloat(0.0f)) & (u + v <= SimdFloat(1.0f));
+    if(none(hit)) return hit;
+
+    // Distance along the ray
+    t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+    return hit & (t >= SimdFloat(0.0f));
+}
+
+} // namespace cg
@@ -0,0 +1,137 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    ray_packet.hpp
+//	Purpose: Packet of SIMD_WIDTH rays stored one component per SIMD lane,
+//           with packet versions of the slab, sphere and triangle tests.
+//           Used for coherent (primary) rays through neighbouring pixels.
+//============================================================================
+
+#ifndef __GEOMETRY_RAY_PACKET_HPP__
+#define __GEOMETRY_RAY_PACKET_HPP__
+
+#include "geometry/aabb.hpp"
+#include "geometry/bounding_sphere.hpp"
+#include "geometry/ray3.hpp"
+#include "geometry/simd.hpp"
+
+#include <cstdint>
+
+namespace cg
+{
+
+/**
+ * Packet of up to SIMD_WIDTH rays. Lanes beyond the ray count are inactive.
+ */
+struct RayPacket
+{
+    SimdFloat ox, oy, oz;             // Origins
+    SimdFloat dx, dy, dz;             // Directions (unit length)
+    SimdFloat inv_dx, inv_dy, inv_dz; // Reciprocal directions for slab tests
+    SimdMask  neg_x, neg_y, neg_z;    // Lanes whose reciprocal direction is negative
+    SimdMask  active;                 // Lanes holding a ray
+    uint32_t  count;                  // Number of rays
+    uint32_t  dir_is_neg[3];          // Direction signs of the first ray (traversal order)
+    const Ray3 *rays;                 // The rays themselves (not copied)
+
+    /**
+     * Constructor.
+     * @param  packet_rays  Rays to place in the packet. Must outlive the packet.
+     * @param  ray_count    Number of rays (1 to SIMD_WIDTH).
+     */
+    RayPacket(const Ray3 *packet_rays, uint32_t ray_count);
+
+    /**
+     * Get the ray in a lane.
+     * @param  lane  Lane index (less than count).
+     */
+    const Ray3 &get_ray(uint32_t lane) const { return rays[lane]; }
+
+    /**
+     * Slab test of every lane against a box. Written so a NaN (ray in the slab
+     * plane) is ignored, as in BVHRay::intersect.
+     * @param  bounds_min  Minimum corner of the box.
+     * @param  bounds_max  Maximum corner of the box.
+     * @param  t_max       Maximum distance along each ray.
+     * @return Returns the lanes whose ray enters the box in [0, t_max].
+     */
+    SimdMask intersect_box(const float *bounds_min, const float *bounds_max, const SimdFloat &t_max) const
+    {
+        const SimdFloat *o[3] = {&ox, &oy, &oz};
+        const SimdFloat *inv[3] = {&inv_dx, &inv_dy, &inv_dz};
+        const SimdMask  *neg[3] = {&neg_x, &neg_y, &neg_z};
+        SimdFloat        t0(0.0f);
+        SimdFloat        t1 = t_max;
+        for(uint32_t a = 0; a < 3; ++a)
+        {
+            SimdFloat t_a = (SimdFloat(bounds_min[a]) - *o[a]) * *inv[a];
+            SimdFloat t_b = (SimdFloat(bounds_max[a]) - *o[a]) * *inv[a];
+
+            // Near and far are chosen by direction sign rather than by min/max
+            // so a NaN stays in its own slab. min/max return their second
+            // operand when either is NaN, so a NaN distance is then ignored.
+            SimdFloat t_near = select(*neg[a], t_b, t_a);
+            SimdFloat t_far = select(*neg[a], t_a, t_b);
+            t0 = max(t_near, t0);
+            t1 = min(t_far * SimdFloat(1.00000024f), t1);
+        }
+        return (t0 <= t1) & active;
+    }
+
+    /**
+     * Slab test of every lane against an axis aligned bounding box.
+     * @param  box    AABB to test intersection with.
+     * @param  t_max  Maximum distance along each ray.
+     * @return Returns the lanes whose ray enters the box in [0, t_max].
+     */
+    SimdMask intersect(const AABB &box, const SimdFloat &t_max) const;
+
+    /**
+     * Intersection of every lane with a sphere. Matches Ray3::intersect(BoundingSphere).
+     * @param  sphere  Sphere to test intersection with.
+     * @param  t       (OUT) Distance to the intersection in lanes that hit.
+     * @return Returns the lanes that intersect the sphere.
+     */
+    SimdMask intersect(const BoundingSphere &sphere, SimdFloat &t) const;
+
+    /**
+     * Moller-Trumbore intersection of every lane with a triangle (back faces
+     * culled). Matches Ray3::intersect(v0, v1, v2).
+     * @param  v0  Vertex of the triangle.
+     * @param  v1  Vertex of the triangle.
+     * @param  v2  Vertex of the triangle.
+     * @param  t   (OUT) Distance to the intersection in lanes that hit.
+     * @param  u   (OUT) Barycentric coordinate u in lanes that hit.
+     * @param  v   (OUT) Barycentric coordinate v in lanes that hit.
+     * @return Returns the lanes that intersect the triangle.
+     */
+    SimdMask intersect(const Point3 &v0,
+                       const Point3 &v1,
+                       const Point3 &v2,
+                       SimdFloat    &t,
+                       SimdFloat    &u,
+                       SimdFloat    &v) const;
+
+    /**
+     * Moller-Trumbore intersection of every lane with a triangle given by its
+     * first vertex and precomputed edges (as stored in a TriangleBlock).
+     * @param  v0     Vertex of the triangle.
+     * @param  edge1  Edge v1 - v0.
+     * @param  edge2  Edge v2 - v0.
+     * @param  t      (OUT) Distance to the intersection in lanes that hit.
+     * @param  u      (OUT) Barycentric coordinate u in lanes that hit.
+     * @param  v      (OUT) Barycentric coordinate v in lanes that hit.
+     * @return Returns the lanes that intersect the triangle.
+     */
+    SimdMask intersect(const Point3  &v0,
+                       const Vector3 &edge1,
+                       const Vector3 &edge2,
+                       SimdFloat     &t,
+                       SimdFloat     &u,
+                       SimdFloat     &v) const;
+};
+
+} // namespace cg
+
+#endif
@@ -0,0 +1,282 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    simd.hpp
+//	Purpose: Thin wrapper over SIMD float lanes. Uses AVX (8 lanes) when the
+//           compiler targets it, SSE (4 lanes) otherwise, and plain scalar
+//           code (4 lanes) when neither is available.
+//============================================================================
+
+#ifndef __GEOMETRY_SIMD_HPP__
+#define __GEOMETRY_SIMD_HPP__
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX__)
+#define CG_SIMD_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CG_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace cg
+{
+
+#if defined(CG_SIMD_AVX)
+constexpr uint32_t SIMD_WIDTH = 8;
+#else
+constexpr uint32_t SIMD_WIDTH = 4;
+#endif
+
+// Bit mask with one bit set for each lane
+constexpr uint32_t SIMD_ALL_LANES = (1u << SIMD_WIDTH) - 1;
+
+#if defined(CG_SIMD_AVX)
+
+/**
+ * Per lane boolean mask.
+ */
+struct SimdMask
+{
+    __m256 v;
+
+    SimdMask() : v(_mm256_setzero_ps()) {}
+    explicit SimdMask(__m256 m) : v(m) {}
+
+    /**
+     * Create a mask from a bit mask (bit i set = lane i set).
+     */
+    static SimdMask from_bits(uint32_t bits)
+    {
+        // Integer compares need AVX2, so build the lanes in memory
+        int32_t m[8];
+        for(uint32_t i = 0; i < 8; ++i) m[i] = (bits & (1u << i)) ? -1 : 0;
+        return SimdMask(_mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(m))));
+    }
+
+    uint32_t bits() const { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+};
+
+/**
+ * SIMD_WIDTH floats.
+ */
+struct SimdFloat
+{
+    __m256 v;
+
+    SimdFloat() : v(_mm256_setzero_ps()) {}
+    SimdFloat(float f) : v(_mm256_set1_ps(f)) {}
+    explicit SimdFloat(__m256 f) : v(f) {}
+
+    static SimdFloat load(const float *p) { return SimdFloat(_mm256_loadu_ps(p)); }
+    void             store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline SimdFloat operator+(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_add_ps(a.v, b.v)); }
+inline SimdFloat operator-(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_sub_ps(a.v, b.v)); }
+inline SimdFloat operator*(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_mul_ps(a.v, b.v)); }
+inline SimdFloat operator/(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_div_ps(a.v, b.v)); }
+inline SimdFloat min(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_min_ps(a.v, b.v)); }
+inline SimdFloat max(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm256_max_ps(a.v, b.v)); }
+inline SimdFloat sqrt(const SimdFloat &a) { return SimdFloat(_mm256_sqrt_ps(a.v)); }
+
+inline SimdMask operator<(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline SimdMask operator<=(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline SimdMask operator>(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline SimdMask operator>=(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+
+inline SimdMask operator&(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm256_and_ps(a.v, b.v)); }
+inline SimdMask operator|(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm256_or_ps(a.v, b.v)); }
+inline SimdMask andnot(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm256_andnot_ps(b.v, a.v)); }
+
+inline SimdFloat select(const SimdMask &m, const SimdFloat &a, const SimdFloat &b)
+{
+    return SimdFloat(_mm256_blendv_ps(b.v, a.v, m.v));
+}
+
+#elif defined(CG_SIMD_SSE)
+
+/**
+ * Per lane boolean mask.
+ */
+struct SimdMask
+{
+    __m128 v;
+
+    SimdMask() : v(_mm_setzero_ps()) {}
+    explicit SimdMask(__m128 m) : v(m) {}
+
+    /**
+     * Create a mask from a bit mask (bit i set = lane i set).
+     */
+    static SimdMask from_bits(uint32_t bits)
+    {
+        const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+        __m128i       b = _mm_and_si128(_mm_set1_epi32(static_cast<int32_t>(bits)), lane_bits);
+        return SimdMask(_mm_castsi128_ps(_mm_cmpeq_epi32(b, lane_bits)));
+    }
+
+    uint32_t bits() const { return static_cast<uint32_t>(_mm_movemask_ps(v)); }
+};
+
+/**
+ * SIMD_WIDTH floats.
+ */
+struct SimdFloat
+{
+    __m128 v;
+
+    SimdFloat() : v(_mm_setzero_ps()) {}
+    SimdFloat(float f) : v(_mm_set1_ps(f)) {}
+    explicit SimdFloat(__m128 f) : v(f) {}
+
+    static SimdFloat load(const float *p) { return SimdFloat(_mm_loadu_ps(p)); }
+    void             store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline SimdFloat operator+(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_add_ps(a.v, b.v)); }
+inline SimdFloat operator-(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_sub_ps(a.v, b.v)); }
+inline SimdFloat operator*(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_mul_ps(a.v, b.v)); }
+inline SimdFloat operator/(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_div_ps(a.v, b.v)); }
+inline SimdFloat min(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_min_ps(a.v, b.v)); }
+inline SimdFloat max(const SimdFloat &a, const SimdFloat &b) { return SimdFloat(_mm_max_ps(a.v, b.v)); }
+inline SimdFloat sqrt(const SimdFloat &a) { return SimdFloat(_mm_sqrt_ps(a.v)); }
+
+inline SimdMask operator<(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm_cmplt_ps(a.v, b.v)); }
+inline SimdMask operator<=(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm_cmple_ps(a.v, b.v)); }
+inline SimdMask operator>(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm_cmpgt_ps(a.v, b.v)); }
+inline SimdMask operator>=(const SimdFloat &a, const SimdFloat &b) { return SimdMask(_mm_cmpge_ps(a.v, b.v)); }
+
+inline SimdMask operator&(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm_and_ps(a.v, b.v)); }
+inline SimdMask operator|(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm_or_ps(a.v, b.v)); }
+inline SimdMask andnot(const SimdMask &a, const SimdMask &b) { return SimdMask(_mm_andnot_ps(b.v, a.v)); }
+
+inline SimdFloat select(const SimdMask &m, const SimdFloat &a, const SimdFloat &b)
+{
+    return SimdFloat(_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)));
+}
+
+#else
+
+/**
+ * Per lane boolean mask.
+ */
+struct SimdMask
+{
+    uint32_t m;
+
+    SimdMask() : m(0) {}
+
+    /**
+     * Create a mask from a bit mask (bit i set = lane i set).
+     */
+    static SimdMask from_bits(uint32_t bits)
+    {
+        SimdMask r;
+        r.m = bits & SIMD_ALL_LANES;
+        return r;
+    }
+
+    uint32_t bits() const { return m; }
+};
+
+/**
+ * SIMD_WIDTH floats.
+ */
+struct SimdFloat
+{
+    float v[SIMD_WIDTH];
+
+    SimdFloat()
+    {
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i) v[i] = 0.0f;
+    }
+    SimdFloat(float f)
+    {
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i) v[i] = f;
+    }
+
+    static SimdFloat load(const float *p)
+    {
+        SimdFloat r;
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i) r.v[i] = p[i];
+        return r;
+    }
+    void store(float *p) const
+    {
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i) p[i] = v[i];
+    }
+};
+
+#define CG_SIMD_BINARY_OP(name, expr)                                   \
+    inline SimdFloat name(const SimdFloat &a, const SimdFloat &b)       \
+    {                                                                   \
+        SimdFloat r;                                                    \
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i) r.v[i] = (expr);       \
+        return r;                                                       \
+    }
+#define CG_SIMD_COMPARE_OP(name, op)                                    \
+    inline SimdMask name(const SimdFloat &a, const SimdFloat &b)        \
+    {                                                                   \
+        SimdMask r;                                                     \
+        for(uint32_t i = 0; i < SIMD_WIDTH; ++i)                        \
+            if(a.v[i] op b.v[i]) r.m |= 1u << i;                        \
+        return r;                                                       \
+    }
+
+CG_SIMD_BINARY_OP(operator+, a.v[i] + b.v[i])
+CG_SIMD_BINARY_OP(operator-, a.v[i] - b.v[i])
+CG_SIMD_BINARY_OP(operator*, a.v[i] * b.v[i])
+CG_SIMD_BINARY_OP(operator/, a.v[i] / b.v[i])
+// Same NaN behavior as SSE: the second operand is returned if either is NaN
+CG_SIMD_BINARY_OP(min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+CG_SIMD_BINARY_OP(max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+CG_SIMD_COMPARE_OP(operator<, <)
+CG_SIMD_COMPARE_OP(operator<=, <=)
+CG_SIMD_COMPARE_OP(operator>, >)
+CG_SIMD_COMPARE_OP(operator>=, >=)
+
+#undef CG_SIMD_BINARY_OP
+#undef CG_SIMD_COMPARE_OP
+
+inline SimdFloat sqrt(const SimdFloat &a)
+{
+    SimdFloat r;
+    for(uint32_t i = 0; i < SIMD_WIDTH; ++i) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+inline SimdMask operator&(const SimdMask &a, const SimdMask &b) { return SimdMask::from_bits(a.m & b.m); }
+inline SimdMask operator|(const SimdMask &a, const SimdMask &b) { return SimdMask::from_bits(a.m | b.m); }
+inline SimdMask andnot(const SimdMask &a, const SimdMask &b) { return SimdMask::from_bits(a.m & ~b.m); }
+
+inline SimdFloat select(const SimdMask &m, const SimdFloat &a, const SimdFloat &b)
+{
+    SimdFloat r;
+    for(uint32_t i = 0; i < SIMD_WIDTH; ++i) r.v[i] = (m.m & (1u << i)) ? a.v[i] : b.v[i];
+    return r;
+}
+
+#endif
+
+// Operations common to all implementations
+
+inline bool any(const SimdMask &m) { return m.bits() != 0; }
+inline bool none(const SimdMask &m) { return m.bits() == 0; }
+
+/**
+ * Get a single lane of a SimdFloat.
+ */
+inline float lane(const SimdFloat &a, uint32_t i)
+{
+    float f[SIMD_WIDTH];
+    a.store(f);
+    return f[i];
+}
+
+} // namespace cg
+
+#endif
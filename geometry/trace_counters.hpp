@@ -0,0 +1,81 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    trace_counters.hpp
+//	Purpose: Per thread counts of BVH traversal steps and ray / primitive
+//           intersection tests. Compiled in only when RENDER_METRICS is
+//           defined (CMake option ENABLE_RENDER_METRICS).
+//============================================================================
+
+#ifndef __GEOMETRY_TRACE_COUNTERS_HPP__
+#define __GEOMETRY_TRACE_COUNTERS_HPP__
+
+#include <cstdint>
+
+namespace cg
+{
+
+/**
+ * Traversal and intersection test counts. A packet test counts once however
+ * many lanes are active.
+ */
+struct TraceCounters
+{
+    uint64_t node_visits = 0;    // BVH nodes the ray entered
+    uint64_t aabb_tests = 0;     // BVH node bounds tested
+    uint64_t sphere_tests = 0;
+    uint64_t quad_tests = 0;
+    uint64_t triangle_tests = 0; // Mesh triangles tested
+    uint64_t hits = 0;           // Closer hits recorded
+    uint64_t early_outs = 0;     // Any hit queries stopped at the first hit, and
+                                 // convex objects skipped by their own shadow rays
+
+    TraceCounters &operator+=(const TraceCounters &counters)
+    {
+        node_visits += counters.node_visits;
+        aabb_tests += counters.aabb_tests;
+        sphere_tests += counters.sphere_tests;
+        quad_tests += counters.quad_tests;
+        triangle_tests += counters.triangle_tests;
+        hits += counters.hits;
+        early_outs += counters.early_outs;
+        return *this;
+    }
+};
+
+#ifdef RENDER_METRICS
+
+constexpr bool TRACE_COUNTERS_ENABLED = true;
+
+// Counts of the calling thread since they were last taken
+inline thread_local TraceCounters t_trace_counters;
+
+#define COUNT_TRACE(field, n) (::cg::t_trace_counters.field += (n))
+
+#else
+
+constexpr bool TRACE_COUNTERS_ENABLED = false;
+
+#define COUNT_TRACE(field, n) ((void)(n))
+
+#endif
+
+/**
+ * Get the counts of the calling thread since the last call, and reset them.
+ * Returns zero counts when the counters are compiled out.
+ */
+inline TraceCounters take_thread_trace_counters()
+{
+#ifdef RENDER_METRICS
+    TraceCounters counters = t_trace_counters;
+    t_trace_counters = TraceCounters();
+    return counters;
+#else
+    return TraceCounters();
+#endif
+}
+
+} // namespace cg
+
+#endif
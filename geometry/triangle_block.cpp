@@ -0,0 +1,37 @@
+#include "geometry/triangle_block.hpp"
+
+namespace cg
+{
+
+TriangleBlock::TriangleBlock() : count(0)
+{
+    for(uint32_t i = 0; i < TRIANGLE_BLOCK_SIZE; ++i)
+    {
+        v0x[i] = v0y[i] = v0z[i] = 0.0f;
+        e1x[i] = e1y[i] = e1z[i] = 0.0f;
+        e2x[i] = e2y[i] = e2z[i] = 0.0f;
+        face_index[i] = 0;
+    }
+}
+
+void TriangleBlock::add(const Point3 &v0, const Point3 &v1, const Point3 &v2, uint32_t face)
+{
+    // Edges are computed exactly as Ray3::intersect(v0, v1, v2) does so both
+    // tests give identical results
+    Vector3 edge1(v0, v1);
+    Vector3 edge2(v0, v2);
+
+    uint32_t i = count++;
+    v0x[i] = v0.x;
+    v0y[i] = v0.y;
+    v0z[i] = v0.z;
+    e1x[i] = edge1.x;
+    e1y[i] = edge1.y;
+    e1z[i] = edge1.z;
+    e2x[i] = edge2.x;
+    e2y[i] = edge2.y;
+    e2z[i] = edge2.z;
+    face_index[i] = face;
+}
+
+} // namespace cg
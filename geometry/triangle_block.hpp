@@ -0,0 +1,81 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    triangle_block.hpp
+//	Purpose: Structure of arrays storage for groups of triangles. Each block
+//           holds the first vertex and both edge vectors of up to 8
+//           triangles so a ray can be tested against all of them with SIMD.
+//============================================================================
+
+#ifndef __GEOMETRY_TRIANGLE_BLOCK_HPP__
+#define __GEOMETRY_TRIANGLE_BLOCK_HPP__
+
+#include "geometry/point3.hpp"
+#include "geometry/vector3.hpp"
+
+#include <cstdint>
+
+namespace cg
+{
+
+// Number of triangles in a block
+constexpr uint32_t TRIANGLE_BLOCK_SIZE = 8;
+
+/**
+ * Block of up to TRIANGLE_BLOCK_SIZE triangles stored as v0, edge1 = v1 - v0
+ * and edge2 = v2 - v0, one array per component. Unused slots hold degenerate
+ * (zero edge) triangles that are never hit.
+ */
+struct alignas(32) TriangleBlock
+{
+    float    v0x[TRIANGLE_BLOCK_SIZE];
+    float    v0y[TRIANGLE_BLOCK_SIZE];
+    float    v0z[TRIANGLE_BLOCK_SIZE];
+    float    e1x[TRIANGLE_BLOCK_SIZE];
+    float    e1y[TRIANGLE_BLOCK_SIZE];
+    float    e1z[TRIANGLE_BLOCK_SIZE];
+    float    e2x[TRIANGLE_BLOCK_SIZE];
+    float    e2y[TRIANGLE_BLOCK_SIZE];
+    float    e2z[TRIANGLE_BLOCK_SIZE];
+    uint32_t face_index[TRIANGLE_BLOCK_SIZE]; // Face each slot came from
+    uint32_t count;                           // Number of slots in use
+
+    /**
+     * Constructor. Creates an empty block.
+     */
+    TriangleBlock();
+
+    /**
+     * Add a triangle to the next free slot. The block must not be full.
+     * @param  v0    Vertex of the triangle.
+     * @param  v1    Vertex of the triangle.
+     * @param  v2    Vertex of the triangle.
+     * @param  face  Index of the face, returned by intersection queries.
+     */
+    void add(const Point3 &v0, const Point3 &v1, const Point3 &v2, uint32_t face);
+
+    /**
+     * Is the block full.
+     */
+    bool full() const { return count == TRIANGLE_BLOCK_SIZE; }
+
+    /**
+     * Get the first vertex of a slot.
+     */
+    Point3 get_v0(uint32_t slot) const { return Point3(v0x[slot], v0y[slot], v0z[slot]); }
+
+    /**
+     * Get the edge v1 - v0 of a slot.
+     */
+    Vector3 get_edge1(uint32_t slot) const { return Vector3(e1x[slot], e1y[slot], e1z[slot]); }
+
+    /**
+     * Get the edge v2 - v0 of a slot.
+     */
+    Vector3 get_edge2(uint32_t slot) const { return Vector3(e2x[slot], e2y[slot], e2z[slot]); }
+};
+
+} // namespace cg
+
+#endif
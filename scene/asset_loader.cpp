@@ -0,0 +1,143 @@
+#include "scene/asset_loader.hpp"
+
+#include "scene/texture_cache.hpp"
+
+#include <iostream>
+
+namespace cg
+{
+
+AssetLoader::AssetLoader(uint32_t num_workers) : pending_(0), stop_(false)
+{
+    if(num_workers == 0)
+    {
+        uint32_t hw = std::thread::hardware_concurrency();
+        num_workers = hw > 1 ? hw - 1 : 1;
+    }
+
+    for(uint32_t i = 0; i < num_workers; ++i) { workers_.emplace_back(&AssetLoader::worker_main, this); }
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        queued_.clear();
+    }
+    load_cv_.notify_all();
+    for(auto &worker : workers_) { worker.join(); }
+}
+
+void AssetLoader::add(std::function<void()> load, std::function<void()> finish)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back({std::move(load), std::move(finish)});
+        ++pending_;
+    }
+    load_cv_.notify_one();
+}
+
+void AssetLoader::load_texture(std::shared_ptr<PresentationNode> material,
+                               const std::string                &filename,
+                               GLuint                            s_wrap,
+                               GLuint                            t_wrap,
+                               GLuint                            min_filter,
+                               GLuint                            mag_filter)
+{
+    // Filters are set now and read back when the texture is set, so a filter
+    // change made while the image loads is kept
+    material->update_texture_filters(min_filter, mag_filter);
+
+    // The decoded image is held from the load step until the texture is set,
+    // where the texture cache finds it already decoded
+    auto image = std::make_shared<std::shared_ptr<const CachedImage>>();
+    add([image, filename]() { *image = acquire_image(filename); },
+        [image, material, filename, s_wrap, t_wrap]() {
+            if(*image)
+            {
+                material->set_texture(filename,
+                                      s_wrap,
+                                      t_wrap,
+                                      material->get_texture_min_filter(),
+                                      material->get_texture_mag_filter());
+            }
+            image->reset();
+        });
+}
+
+void AssetLoader::load_model(std::shared_ptr<ModelNode> model,
+                             const std::string         &filename,
+                             int32_t                    position_loc,
+                             int32_t                    normal_loc,
+                             int32_t                    texture_loc)
+{
+    // A model that fails to import is reported and left empty
+    auto imported = std::make_shared<bool>(false);
+    add([imported, model, filename]() { *imported = model->import_model(filename); },
+        [imported, model, filename, position_loc, normal_loc, texture_loc]() {
+            if(*imported) { model->create_buffers(position_loc, normal_loc, texture_loc); }
+            else { std::cout << "Error loading model " << filename << '\n'; }
+        });
+}
+
+uint32_t AssetLoader::update()
+{
+    std::deque<std::function<void()>> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loaded.swap(loaded_);
+    }
+
+    // Finish outside the lock so workers can keep handing over loaded assets
+    for(auto &finish : loaded) { finish(); }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ -= static_cast<uint32_t>(loaded.size());
+    return static_cast<uint32_t>(loaded.size());
+}
+
+void AssetLoader::finish()
+{
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            loaded_cv_.wait(lock, [this] { return pending_ == 0 || !loaded_.empty(); });
+            if(pending_ == 0) { return; }
+        }
+        update();
+    }
+}
+
+uint32_t AssetLoader::get_pending_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void AssetLoader::worker_main()
+{
+    while(true)
+    {
+        Asset asset;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            load_cv_.wait(lock, [this] { return stop_ || !queued_.empty(); });
+            if(stop_) { return; }
+            asset = std::move(queued_.front());
+            queued_.pop_front();
+        }
+
+        asset.load();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loaded_.push_back(std::move(asset.finish));
+        }
+        loaded_cv_.notify_one();
+    }
+}
+
+} // namespace cg
@@ -0,0 +1,142 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.667 Computer Graphics and 605.767 Applied Computer Graphics
+//
+//	File:    asset_loader.hpp
+//	Purpose: Pool of worker threads that decode images and import models in
+//           the background. Only the OpenGL upload of each asset is left
+//           for the thread that owns the GL context.
+//============================================================================
+
+#ifndef __SCENE_ASSET_LOADER_HPP__
+#define __SCENE_ASSET_LOADER_HPP__
+
+#include "scene/model_node.hpp"
+#include "scene/presentation_node.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cg
+{
+
+/**
+ * Asynchronous asset loader. Each asset is loaded in two steps: a load step
+ * run on a worker thread (file reading, image decoding, model import) and a
+ * finish step run on the GL thread by update() or finish() (texture and
+ * buffer creation). Until its asset is finished a material draws with its
+ * own colors and no texture, and a model draws nothing.
+ */
+class AssetLoader
+{
+  public:
+    /**
+     * Constructor. Starts the worker threads.
+     * @param  num_workers  Number of worker threads (0 uses all hardware threads but one).
+     */
+    explicit AssetLoader(uint32_t num_workers = 0);
+
+    /**
+     * Destructor. Stops and joins the worker threads. Assets not yet loaded
+     * are dropped; loads in progress are completed but not finished.
+     */
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    /**
+     * Queue an asset.
+     * @param  load    Function called on a worker thread. Must not use OpenGL.
+     * @param  finish  Function called on the GL thread once load has returned.
+     */
+    void add(std::function<void()> load, std::function<void()> finish);
+
+    /**
+     * Queue a texture for a material. The image is decoded on a worker thread
+     * and the texture set once it is uploaded (see PresentationNode::set_texture).
+     * The filters are set on the material right away, so later calls to
+     * update_texture_filters take effect even before the texture is set.
+     * @param  material    Material to set the texture of.
+     * @param  filename    Texture image filename
+     * @param  s_wrap      OpenGL wrap option (s)
+     * @param  t_wrap      OpenGL wrap option (t)
+     * @param  min_filter  OpenGL filter to use for minification
+     * @param  mag_filter  OpenGL filter to use for magnification
+     */
+    void load_texture(std::shared_ptr<PresentationNode> material,
+                      const std::string                &filename,
+                      GLuint                            s_wrap,
+                      GLuint                            t_wrap,
+                      GLuint                            min_filter,
+                      GLuint                            mag_filter);
+
+    /**
+     * Queue a model. The model and its textures are imported on a worker
+     * thread and its buffers created once that is done. If the import fails
+     * the error is reported and the model left empty.
+     * @param  model         Empty model node to load into.
+     * @param  filename      Model file path/name.
+     * @param  position_loc  Vertex position attribute location.
+     * @param  normal_loc    Vertex normal attribute location.
+     * @param  texture_loc   Vertex texture coordinate attribute location.
+     */
+    void load_model(std::shared_ptr<ModelNode> model,
+                    const std::string         &filename,
+                    int32_t                    position_loc,
+                    int32_t                    normal_loc,
+                    int32_t                    texture_loc);
+
+    /**
+     * Finish the assets whose load step is done without waiting for any
+     * others. Call on the GL thread (e.g. once per frame).
+     * @return Returns the number of assets finished by this call.
+     */
+    uint32_t update();
+
+    /**
+     * Wait for every queued asset to load and finish them. Call on the GL thread.
+     */
+    void finish();
+
+    /**
+     * Get the number of assets queued and not yet finished.
+     */
+    uint32_t get_pending_count() const;
+
+    /**
+     * Get the number of worker threads.
+     */
+    uint32_t get_worker_count() const { return static_cast<uint32_t>(workers_.size()); }
+
+  private:
+    struct Asset
+    {
+        std::function<void()> load;
+        std::function<void()> finish;
+    };
+
+    std::vector<std::thread> workers_;
+
+    // Guarded by mutex_
+    mutable std::mutex                mutex_;
+    std::condition_variable           load_cv_;   // Signalled when an asset is queued
+    std::condition_variable           loaded_cv_; // Signalled when a load step is done
+    std::deque<Asset>                 queued_;    // Assets waiting for a worker
+    std::deque<std::function<void()>> loaded_;    // Finish steps of the assets loaded
+    uint32_t                          pending_;   // Assets queued and not yet finished
+    bool                              stop_;
+
+    void worker_main();
+};
+
+} // namespace cg
+
+#endif
@@ -23,11 +23,11 @@ void AABBNode::update(SceneState &scene_state)
     SceneNode::update(scene_state);
 }
 
-void AABBNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+void AABBNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     // Complete in 605.767 - ray tracing project
 }
 
-bool AABBNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state) { return false; }
+bool AABBNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) { return false; }
 
 } // namespace cg
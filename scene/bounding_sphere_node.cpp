@@ -31,14 +31,14 @@ void BoundingSphereNode::update(SceneState &scene_state)
     SceneNode::update(scene_state);
 }
 
-void BoundingSphereNode::find_closest_intersect(Ray3        ray,
-                                                SceneState &current_state,
-                                                SceneState &closest)
+void BoundingSphereNode::find_closest_intersect(Ray3              ray,
+                                                RayTraversalState &current_state,
+                                                RayTraversalState &closest)
 {
     // Complete in 605.767 - ray tracing project
 }
 
-bool BoundingSphereNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state)
+bool BoundingSphereNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
 {
     return false;
 }
@@ -56,9 +56,9 @@ class BoundingSphereNode : public BoundingNode
      */
     void update(SceneState &scene_state) override;
 
-    void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest) override;
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
 
-    bool does_intersect_exist(Ray3 ray, float d, SceneState &current_state) override;
+    bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) override;
 
   protected:
     BoundingSphere bounding_sphere_;
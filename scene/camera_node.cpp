@@ -218,6 +218,11 @@ Ray3 CameraNode::construct_ray(float x, float y) const
     return Ray3(vrp_, direction, true);
 }
 
+float CameraNode::get_pixel_spread() const
+{
+    return std::atan(2.0f * half_height_ / (near_clip_ * static_cast<float>(image_height_)));
+}
+
 void CameraNode::look_at()
 {
     // Set the VPN, which is the vector vp - vc
@@ -193,6 +193,12 @@ class CameraNode : public SceneNode
      */
     Ray3 construct_ray(float x, float y) const;
 
+    /**
+     * Get the angle spanned by a pixel at the center of the view.
+     * @return Returns the angle in radians.
+     */
+    float get_pixel_spread() const;
+
   protected:
     // Image resolution (number of pixels on the view plane)
     uint32_t image_width_;
@@ -12,16 +12,38 @@ GeometryNode::~GeometryNode() {}
 
 void GeometryNode::draw(SceneState &scene_state) {}
 
-Vector3 GeometryNode::get_normal(const Point3 &int_pt)
+Vector3 GeometryNode::get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Default implementation - ray tracing geometry nodes should override this
     return Vector3(0.0f, 1.0f, 0.0f);
 }
 
-Point2 GeometryNode::get_texture_coord(const Point3 &int_pt)
+Point2 GeometryNode::get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const
 {
     // Default implementation - ray tracing geometry nodes should override this
     return Point2(0.0f, 0.0f);
 }
 
+float GeometryNode::get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const { return 0.0f; }
+
+void GeometryNode::find_closest_intersect_packet(const RayPacket   &packet,
+                                                 const SimdMask    &mask,
+                                                 RayTraversalState &current_state,
+                                                 PacketHit         &closest)
+{
+    uint32_t lanes = mask.bits();
+    for(uint32_t i = 0; i < packet.count; ++i)
+    {
+        if(!(lanes & (1u << i))) continue;
+
+        RayTraversalState lane_closest;
+        lane_closest.t_min = closest.t_min[i];
+        lane_closest.geometry_node = nullptr;
+        find_closest_intersect(packet.get_ray(i), current_state, lane_closest);
+        if(lane_closest.geometry_node != nullptr) { closest.record(i, lane_closest); }
+    }
+}
+
+AABB GeometryNode::get_bounding_box() const { return AABB(); }
+
 } // namespace cg
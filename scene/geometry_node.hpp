@@ -12,6 +12,8 @@
 #ifndef __SCENE_GEOMETRY_NODE_HPP__
 #define __SCENE_GEOMETRY_NODE_HPP__
 
+#include "geometry/aabb.hpp"
+#include "geometry/ray_packet.hpp"
 #include "scene/scene_node.hpp"
 
 namespace cg
@@ -43,18 +45,53 @@ class GeometryNode : public SceneNode
      * Get the surface normal at a point on the geometry.
      * Override this method in ray tracing geometry nodes.
      * @param  int_pt  Intersection point on the surface
+     * @param  hit     Surface interaction recorded when the ray hit this node
      * @return Returns the unit length surface normal at the intersection point
      */
-    virtual Vector3 get_normal(const Point3 &int_pt);
+    virtual Vector3 get_normal(const Point3 &int_pt, const SurfaceInteraction &hit) const;
 
     /**
      * Get the texture coordinate at an intersection point.
      * For spheres, use spherical mapping. For meshes, interpolate using barycentric coordinates.
      * Override this method in ray tracing geometry nodes.
      * @param  int_pt  Intersection point on the surface
+     * @param  hit     Surface interaction recorded when the ray hit this node
      * @return Returns the texture coordinate (s, t) at the intersection point
      */
-    virtual Point2 get_texture_coord(const Point3 &int_pt);
+    virtual Point2 get_texture_coord(const Point3 &int_pt, const SurfaceInteraction &hit) const;
+
+    /**
+     * Get how fast the texture coordinate changes along the surface near an
+     * intersection point, used to size texture filters. Override this method
+     * in ray tracing geometry nodes.
+     * @param  int_pt  Intersection point on the surface
+     * @param  hit     Surface interaction recorded when the ray hit this node
+     * @return Returns the change in texture coordinate per unit of length.
+     *         The default is 0, which always samples the full resolution.
+     */
+    virtual float get_texture_scale(const Point3 &int_pt, const SurfaceInteraction &hit) const;
+
+    /**
+     * Find the closest intersection of a packet of rays with this geometry.
+     * The default traces each ray of the packet with find_closest_intersect.
+     * Override this method in ray tracing geometry nodes with packet tests.
+     * @param  packet         Rays to intersect.
+     * @param  mask           Lanes of the packet to test.
+     * @param  current_state  State holding the current material and texture.
+     * @param  closest        (IN/OUT) Closest intersection of each lane.
+     */
+    virtual void find_closest_intersect_packet(const RayPacket   &packet,
+                                               const SimdMask    &mask,
+                                               RayTraversalState &current_state,
+                                               PacketHit         &closest);
+
+    /**
+     * Get the bounding box of the geometry. Used to build ray tracing acceleration
+     * structures. Override this method in ray tracing geometry nodes.
+     * @return Returns the bounding box. The default is an empty box, which
+     *         excludes the node from ray tracing.
+     */
+    virtual AABB get_bounding_box() const;
 };
 
 } // namespace cg
@@ -42,7 +42,7 @@ void flip_image_data(ImageData &im_data)
     delete[] tmp_row_buffer;
 }
 
-void load_image_data(ImageData &im_data, const std::string &filename, bool include_alpha)
+std::string locate_image_file(const std::string &filename)
 {
     auto file_info = locate_path_for_filename(filename, 5);
 
@@ -53,13 +53,24 @@ void load_image_data(ImageData &im_data, const std::string &filename, bool inclu
         file_info = locate_path_for_filename(tex_fname, 5);
     }
 
-    if(!file_info.found)
+    return file_info.found ? file_info.file_path : std::string();
+}
+
+void load_image_data(ImageData &im_data, const std::string &filename, bool include_alpha)
+{
+    std::string path = locate_image_file(filename);
+    if(path.empty())
     {
         std::cout << "Error getting finding file " << filename << '\n';
         return;
     }
 
-    im_data.data = stbi_load(file_info.file_path.c_str(),
+    load_image_file(im_data, path, include_alpha);
+}
+
+void load_image_file(ImageData &im_data, const std::string &path, bool include_alpha)
+{
+    im_data.data = stbi_load(path.c_str(),
                              &im_data.w,
                              &im_data.h,
                              &im_data.channels,
@@ -70,7 +81,7 @@ void load_image_data(ImageData &im_data, const std::string &filename, bool inclu
 
     if(im_data.data == nullptr)
     {
-        std::cout << "Error getting image data for " << filename << '\n';
+        std::cout << "Error getting image data for " << path << '\n';
         return;
     }
 
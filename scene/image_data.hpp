@@ -26,8 +26,15 @@ struct ImageData
 
 void flip_image_data(ImageData &im_data);
 
+// Find an image file, trying a directory called textures if it is not found
+// as named. Returns an empty string if it is not found.
+std::string locate_image_file(const std::string &filename);
+
 void load_image_data(ImageData &im_data, const std::string &filename, bool include_alpha = true);
 
+// Load an image from a path returned by locate_image_file
+void load_image_file(ImageData &im_data, const std::string &path, bool include_alpha = true);
+
 void free_image_data(ImageData &im_data);
 
 } // namespace cg
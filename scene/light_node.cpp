@@ -18,6 +18,7 @@ LightNode::LightNode(uint32_t idx)
     const_atten_ = 1.0f;
     lin_atten_ = 0.0f;
     quad_atten_ = 0.0f;
+    attenuate_ = false;
     is_spotlight_ = false;
 
     // Note: color constructors default rgb to 0 and alpha to 1
@@ -79,6 +80,7 @@ void LightNode::set_attenuation(float constant, float linear, float quadratic)
     const_atten_ = constant;
     lin_atten_ = linear;
     quad_atten_ = quadratic;
+    attenuate_ = true;
 }
 
 bool LightNode::is_attenuation_enabled() const { return attenuate_; }
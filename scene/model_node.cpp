@@ -1,7 +1,6 @@
 #include "scene/model_node.hpp"
 
 #include "filesystem_support/file_locator.hpp"
-#include "scene/image_data.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -12,25 +11,31 @@ namespace cg
 // Note - this does not handle node hierarchy and transformations
 // It does handle multiple meshes and textures.
 
+ModelNode::ModelNode() : ai_scene_(nullptr) {}
+
 ModelNode::ModelNode(int32_t            position_loc,
                      int32_t            normal_loc,
                      int32_t            texture_loc,
-                     const std::string &filename)
+                     const std::string &filename) :
+    ai_scene_(nullptr)
 {
-    import_model_from_file(filename);
-    gen_vaos_and_uniform_buffer(ai_scene_, position_loc, normal_loc, texture_loc);
+    if(!import_model(filename))
+    {
+        system("pause");
+        exit(1);
+    }
+    create_buffers(position_loc, normal_loc, texture_loc);
 }
 
 ModelNode::~ModelNode()
 {
     for(uint32_t n = 0; n < meshes_.size(); ++n)
     {
-        // Delete vertex buffer objects, VAO, and texture objects
+        // Delete vertex buffer objects and VAO (textures are released with the mesh)
         if(meshes_[n].position_vbo > 0) glDeleteBuffers(1, &meshes_[n].position_vbo);
         if(meshes_[n].normal_vbo > 0) glDeleteBuffers(1, &meshes_[n].normal_vbo);
         if(meshes_[n].texture_vbo > 0) glDeleteBuffers(1, &meshes_[n].texture_vbo);
         glDeleteVertexArrays(1, &meshes_[n].vao);
-        if(meshes_[n].has_texture) { glDeleteTextures(1, &meshes_[n].texture_id); }
     }
 }
 
@@ -43,6 +48,10 @@ void ModelNode::draw(SceneState &scene_state)
         {
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, meshes_[n].texture_id);
+
+            // The texture may be shared, so set the model's filters
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
             glUniform1i(scene_state.use_texture_loc, 1);  // Tell shader we are using textures
             glUniform1i(scene_state.texture_unit_loc, 0); // Texture unit 0
         }
@@ -52,7 +61,36 @@ void ModelNode::draw(SceneState &scene_state)
     }
 }
 
-void ModelNode::import_model_from_file(const std::string &filename)
+bool ModelNode::import_model(const std::string &filename)
+{
+    if(!import_model_from_file(filename)) { return false; }
+
+    // Decode the textures now so creating the buffers only has to upload them
+    for(uint32_t n = 0; n < ai_scene_->mNumMeshes; ++n)
+    {
+        aiMaterial *mtl = ai_scene_->mMaterials[ai_scene_->mMeshes[n]->mMaterialIndex];
+        aiString    texPath;
+        if(AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
+        {
+            auto image = acquire_image(get_texture_filename(texPath));
+            if(image) { decoded_textures_.push_back(image); }
+        }
+    }
+    return true;
+}
+
+void ModelNode::create_buffers(int32_t position_loc, int32_t normal_loc, int32_t texture_loc)
+{
+    // Nothing to create if the import failed
+    if(!ai_scene_) { return; }
+
+    gen_vaos_and_uniform_buffer(ai_scene_, position_loc, normal_loc, texture_loc);
+
+    // The textures are held by the meshes now
+    decoded_textures_.clear();
+}
+
+bool ModelNode::import_model_from_file(const std::string &filename)
 {
     auto file_info = locate_path_for_filename(filename, 5);
 
@@ -66,8 +104,7 @@ void ModelNode::import_model_from_file(const std::string &filename)
     if(!file_info.found)
     {
         std::cout << "Error getting finding file " << filename << '\n';
-        system("pause");
-        exit(1);
+        return false;
     }
 
     model_filename_ = file_info.file_path;
@@ -79,12 +116,12 @@ void ModelNode::import_model_from_file(const std::string &filename)
     if(!ai_scene_)
     {
         std::cout << ai_importer_.GetErrorString() << '\n';
-        system("pause");
-        exit(1);
+        return false;
     }
 
     // Now we can access the file's contents. Everything will be cleaned up
     // by the importer destructor
+    return true;
 }
 
 void ModelNode::gen_vaos_and_uniform_buffer(const aiScene *sc,
@@ -180,49 +217,21 @@ void ModelNode::gen_vaos_and_uniform_buffer(const aiScene *sc,
         aiString    texPath; // contains filename of texture
         if(AI_SUCCESS == mtl->GetTexture(aiTextureType_DIFFUSE, 0, &texPath))
         {
-            std::string tex_filename(texPath.data);
-            if(!file_exists(tex_filename))
+            // Meshes using the same image share one texture
+            model_mesh.texture =
+                acquire_gl_texture(get_texture_filename(texPath), GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+            // Draw the mesh without its texture if the image is missing
+            if(model_mesh.texture)
             {
-                tex_filename = model_directory_;
-                tex_filename += "/";
-                tex_filename += texPath.data;
+                model_mesh.texture_id = model_mesh.texture->get_id();
+                model_mesh.has_texture = true;
             }
-
-            // Load the image file
-            ImageData im_data;
-            load_image_data(im_data, tex_filename);
-
-            if(im_data.data == nullptr)
+            else
             {
                 printf("Error getting image data\n");
-                system("pause");
-                exit(1);
+                model_mesh.has_texture = false;
             }
-
-            // Open GL stuff to generate texture ID, bind texture, load image data, generate
-            // mipmaps, set wrapping and filter modes...
-            glGenTextures(1, &model_mesh.texture_id);
-            glBindTexture(GL_TEXTURE_2D, model_mesh.texture_id);
-            glTexImage2D(GL_TEXTURE_2D,
-                         0,
-                         GL_RGBA,
-                         im_data.w,
-                         im_data.h,
-                         0,
-                         GL_RGBA,
-                         GL_UNSIGNED_BYTE,
-                         im_data.data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            // Set wrap, repeat mode
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-            model_mesh.has_texture = true;
-
-            free_image_data(im_data);
         }
         else { model_mesh.has_texture = false; }
         meshes_.push_back(model_mesh);
@@ -231,6 +240,18 @@ void ModelNode::gen_vaos_and_uniform_buffer(const aiScene *sc,
     }
 }
 
+std::string ModelNode::get_texture_filename(const aiString &tex_path)
+{
+    std::string tex_filename(tex_path.data);
+    if(!file_exists(tex_filename))
+    {
+        tex_filename = model_directory_;
+        tex_filename += "/";
+        tex_filename += tex_path.data;
+    }
+    return tex_filename;
+}
+
 std::string ModelNode::get_file_path(const std::string &str)
 {
     size_t found = str.find_last_of("/\\");
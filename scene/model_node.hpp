@@ -13,13 +13,16 @@
 #define __MODEL_NODE_HPP__
 
 #include "scene/scene_node.hpp"
+#include "scene/texture_cache.hpp"
 
 // Assimp include files. These three are usually needed.
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace cg
 {
@@ -37,6 +40,8 @@ struct ModelMesh
     GLuint  position_vbo;
     GLuint  normal_vbo;
     GLuint  texture_vbo;
+
+    std::shared_ptr<const CachedGLTexture> texture; // Shared texture (holds texture_id)
 };
 
 /**
@@ -57,8 +62,29 @@ class ModelNode : public SceneNode
               int32_t            texture_loc,
               const std::string &filename);
 
+    /**
+     * Constructor. Creates an empty model (which draws nothing) to be loaded
+     * later with import_model and create_buffers.
+     */
+    ModelNode();
+
     ~ModelNode();
 
+    /**
+     * Import the model and decode its textures. Does not use OpenGL, so it
+     * may be called from a worker thread. Failures are reported, not fatal.
+     * @param filename : Model file path/name
+     * @return Returns false if the model file could not be found or imported.
+     */
+    bool import_model(const std::string &filename);
+
+    /**
+     * Create the vertex buffers and textures of the imported model. Call with
+     * the GL context current, after import_model. Does nothing (the model
+     * stays empty) if the import failed.
+     */
+    void create_buffers(int32_t position_loc, int32_t normal_loc, int32_t texture_loc);
+
     /**
      * Draw this model node.
      * @param  scene_state   Current scene state
@@ -72,10 +98,14 @@ class ModelNode : public SceneNode
     std::string            model_filename_;
     std::string            model_directory_;
 
+    // Textures decoded by import_model, held until they are uploaded
+    std::vector<std::shared_ptr<const CachedImage>> decoded_textures_;
+
     /**
      * Import the model into a Assimp scene
+     * @return Returns false (with ai_scene_ null) if the import failed.
      */
-    void import_model_from_file(const std::string &filename);
+    bool import_model_from_file(const std::string &filename);
 
     /**
      * Load the model from a Assimp scene into VBOs.
@@ -85,6 +115,8 @@ class ModelNode : public SceneNode
                                      int32_t        normal_loc,
                                      int32_t        texture_loc);
 
+    std::string get_texture_filename(const aiString &tex_path);
+
     std::string get_file_path(const std::string &str);
 
     bool file_exists(const std::string &name);
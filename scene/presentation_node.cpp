@@ -1,6 +1,6 @@
 #include "scene/presentation_node.hpp"
 
-#include "scene/image_data.hpp"
+#include "scene/texture_cache.hpp"
 
 #include <iostream>
 
@@ -12,6 +12,8 @@ PresentationNode::PresentationNode()
     node_type_ = SceneNodeType::PRESENTATION;
     material_shininess_ = 1.0f;
     texture_id_ = 0; // Default to no texture
+    texture_min_filter_ = GL_LINEAR_MIPMAP_LINEAR;
+    texture_mag_filter_ = GL_LINEAR;
 }
 
 PresentationNode::PresentationNode(const Color4 &ambient,
@@ -24,7 +26,9 @@ PresentationNode::PresentationNode(const Color4 &ambient,
     material_specular_(specular),
     material_emission_(emission),
     material_shininess_(shininess),
-    texture_id_(0)
+    texture_id_(0),
+    texture_min_filter_(GL_LINEAR_MIPMAP_LINEAR),
+    texture_mag_filter_(GL_LINEAR)
 {
     node_type_ = SceneNodeType::PRESENTATION;
 }
@@ -48,54 +52,24 @@ void PresentationNode::set_material_shininess(float s) { material_shininess_ = s
 void PresentationNode::set_texture(
     const std::string &fname, GLuint s_wrap, GLuint t_wrap, GLuint min_filter, GLuint mag_filter)
 {
-    ImageData im_data;
-    load_image_data(im_data, fname);
-
-    if(im_data.data == nullptr)
+    // Materials using the same image and wrap modes share one texture
+    texture_min_filter_ = min_filter;
+    texture_mag_filter_ = mag_filter;
+    texture_ = acquire_gl_texture(fname, s_wrap, t_wrap);
+    if(!texture_)
     {
         std::cout << "Error getting image data\n";
+        texture_id_ = 0;
         return;
     }
-
-    // Generate an OpenGL textureID, bind it
-    glGenTextures(1, &texture_id_);
-    glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-    // Load image data and generate mipmaps
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGBA,
-                 im_data.w,
-                 im_data.h,
-                 0,
-                 GL_RGBA,
-                 GL_UNSIGNED_BYTE,
-                 im_data.data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // Set wrapping mode
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, s_wrap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t_wrap);
-
-    // Set texture filters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-
-    // Bind null texture
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    // Free the image data; it is no longer needed
-    free_image_data(im_data);
+    texture_id_ = texture_->get_id();
 }
 
 void PresentationNode::update_texture_filters(GLuint min_filter, GLuint mag_filter)
 {
-    if(texture_id_)
-    {
-        glBindTexture(GL_TEXTURE_2D, texture_id_);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
-    }
+    // Applied when the texture is bound in draw
+    texture_min_filter_ = min_filter;
+    texture_mag_filter_ = mag_filter;
 }
 
 void PresentationNode::draw(SceneState &scene_state)
@@ -114,6 +88,10 @@ void PresentationNode::draw(SceneState &scene_state)
         //   glUniform1i(scene_state.texture_unit_loc, 0);  // Texture unit 0
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture_id_);
+
+        // The texture may be shared, so set this material's filters
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture_mag_filter_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture_min_filter_);
     }
     else
     {
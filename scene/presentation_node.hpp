@@ -14,7 +14,9 @@
 
 #include "scene/color4.hpp"
 #include "scene/scene_node.hpp"
+#include "scene/texture_cache.hpp"
 
+#include <memory>
 #include <string>
 
 namespace cg
@@ -97,12 +99,23 @@ class PresentationNode : public SceneNode
                      GLuint             mag_filter);
 
     /**
-     * Update texture filtering for this material
+     * Update texture filtering for this material. Other materials sharing the
+     * texture keep their own filters, since filters are set when binding.
      * @param  min_filter  OpenGL filter to use for minification
      * @param  mag_filter  OpenGL filter to use for magnification
      */
     void update_texture_filters(GLuint min_filter, GLuint mag_filter);
 
+    /**
+     * Get the texture minification filter of this material.
+     */
+    GLuint get_texture_min_filter() const { return texture_min_filter_; }
+
+    /**
+     * Get the texture magnification filter of this material.
+     */
+    GLuint get_texture_mag_filter() const { return texture_mag_filter_; }
+
     /**
      * Draw. Sets the material properties.
      * @param  scene_state  Scene state (holds material uniform locations)
@@ -116,6 +129,10 @@ class PresentationNode : public SceneNode
     Color4  material_emission_;
     GLfloat material_shininess_;
     GLuint  texture_id_;
+    GLuint  texture_min_filter_;
+    GLuint  texture_mag_filter_;
+
+    std::shared_ptr<const CachedGLTexture> texture_; // Shared texture (holds texture_id_)
 };
 
 } // namespace cg
@@ -0,0 +1,73 @@
+#include "scene/ray_traversal_state.hpp"
+
+namespace cg
+{
+
+RayTraversalState::RayTraversalState()
+    : transform_required(false), t_min(1e30f), t_scale(1.0f), material_node(nullptr),
+      geometry_node(nullptr), texture_node(nullptr), instance_index(NO_INSTANCE_INDEX)
+{
+}
+
+void RayTraversalState::push_material() { material_stack.push(material_node); }
+
+void RayTraversalState::pop_material() { material_stack.pop(material_node); }
+
+void RayTraversalState::push_texture() { texture_stack.push(texture_node); }
+
+void RayTraversalState::pop_texture() { texture_stack.pop(texture_node); }
+
+PacketHit::PacketHit(float t_max)
+{
+    for(uint32_t i = 0; i < SIMD_WIDTH; ++i)
+    {
+        t_min[i] = t_max;
+        geometry_node[i] = nullptr;
+        material_node[i] = nullptr;
+        texture_node[i] = nullptr;
+        instance_index[i] = NO_INSTANCE_INDEX;
+        face_index[i] = 0;
+        barycentric_u[i] = 0.0f;
+        barycentric_v[i] = 0.0f;
+        inverse_matrix[i] = nullptr;
+        normal_matrix[i] = nullptr;
+    }
+}
+
+void PacketHit::record(uint32_t                 lanes,
+                       const SimdFloat         &t,
+                       SceneNode               *geometry,
+                       const RayTraversalState &current_state)
+{
+    float t_lanes[SIMD_WIDTH];
+    t.store(t_lanes);
+    for(uint32_t i = 0; i < SIMD_WIDTH; ++i)
+    {
+        if(lanes & (1u << i))
+        {
+            t_min[i] = t_lanes[i];
+            geometry_node[i] = geometry;
+            material_node[i] = current_state.material_node;
+            texture_node[i] = current_state.texture_node;
+            instance_index[i] = current_state.instance_index;
+            inverse_matrix[i] = nullptr;
+            normal_matrix[i] = nullptr;
+        }
+    }
+}
+
+void PacketHit::record(uint32_t lane, const RayTraversalState &hit)
+{
+    t_min[lane] = hit.t_min;
+    geometry_node[lane] = hit.geometry_node;
+    material_node[lane] = hit.material_node;
+    texture_node[lane] = hit.texture_node;
+    instance_index[lane] = hit.instance_index;
+    face_index[lane] = hit.hit.face_index;
+    barycentric_u[lane] = hit.hit.barycentric_u;
+    barycentric_v[lane] = hit.hit.barycentric_v;
+    inverse_matrix[lane] = nullptr;
+    normal_matrix[lane] = nullptr;
+}
+
+} // namespace cg
@@ -0,0 +1,198 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.767 Applied Computer Graphics
+//
+//	File:    ray_traversal_state.hpp
+//	Purpose: State propagated while a ray traverses the scene and the record
+//           of its closest hit. Kept separate from the OpenGL SceneState so
+//           it is small and never touches the heap.
+//============================================================================
+
+#ifndef __SCENE_RAY_TRAVERSAL_STATE_HPP__
+#define __SCENE_RAY_TRAVERSAL_STATE_HPP__
+
+#include "geometry/matrix.hpp"
+#include "geometry/point2.hpp"
+#include "geometry/simd.hpp"
+#include "geometry/vector3.hpp"
+
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace cg
+{
+
+// Forward reference
+class SceneNode;
+
+// Nesting depth of materials and textures held by a traversal state
+constexpr uint32_t RAY_TRAVERSAL_STACK_DEPTH = 16;
+
+// Instance index of a state not tied to a particular instance
+constexpr uint32_t NO_INSTANCE_INDEX = 0xFFFFFFFF;
+
+/**
+ * Fixed capacity stack stored inline (no heap allocation, and no element is
+ * constructed until it is pushed). Pushes past the capacity are counted but
+ * not stored; popping them leaves the current value unchanged.
+ */
+template <typename T, uint32_t N> class InlineStack
+{
+    static_assert(std::is_trivially_destructible<T>::value, "InlineStack elements are never destroyed");
+
+  public:
+    InlineStack() : depth_(0) {}
+
+    /**
+     * Push a value.
+     * @param  value  Value to push.
+     */
+    void push(const T &value)
+    {
+        if(depth_ < N) { new(&items_[depth_]) T(value); }
+        ++depth_;
+    }
+
+    /**
+     * Pop the most recently pushed value.
+     * @param  value  (OUT) Popped value. Unchanged if the stack is empty or
+     *                the value was pushed past the capacity.
+     * @return Returns the number of values still on the stack.
+     */
+    uint32_t pop(T &value)
+    {
+        if(depth_ == 0) { return 0; }
+        if(--depth_ < N) { value = *reinterpret_cast<const T *>(&items_[depth_]); }
+        return depth_;
+    }
+
+    /**
+     * Get the number of values on the stack.
+     */
+    uint32_t size() const { return depth_; }
+
+  private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type items_[N];
+    uint32_t                                                   depth_;
+};
+
+/**
+ * Surface interaction record for a ray hit. The geometry node that is hit fills
+ * in the face and barycentric coordinates; the ray tracer then fills in the
+ * normal and texture coordinate. Keeping this per ray (rather than in the
+ * geometry node) lets render threads share geometry without writing to it.
+ */
+struct SurfaceInteraction
+{
+    uint32_t face_index = 0;      // Face (triangle) hit within a mesh
+    float    barycentric_u = 0.0f; // Barycentric coordinates within the face
+    float    barycentric_v = 0.0f;
+    Vector3  normal;               // Unit length normal at the hit
+    Point2   texture_coord;        // Texture coordinate at the hit
+};
+
+/**
+ * Ray traversal state. Used both for the state in effect while traversing
+ * (current material, texture and transform) and for the closest hit found
+ * (distance, geometry and the state in effect where it was hit). Only the
+ * current transform is held; a TransformNode saves its parent's transform
+ * in its own stack frame while it traverses its children, which keeps this
+ * state (and every copy of it) small.
+ */
+struct RayTraversalState
+{
+    bool               transform_required; // Object is under a transform
+    float              t_min;              // Closest hit distance
+    float              t_scale;            // Object space distance per world space distance
+    SceneNode         *material_node;
+    SceneNode         *geometry_node;
+    SceneNode         *texture_node;
+    uint32_t           instance_index; // Instance of geometry_node (several may share it)
+    SurfaceInteraction hit;
+    Matrix4x4          inverse_matrix; // World to object
+    Matrix4x4          normal_matrix;  // Object normals to world
+
+    InlineStack<SceneNode *, RAY_TRAVERSAL_STACK_DEPTH> material_stack;
+    InlineStack<SceneNode *, RAY_TRAVERSAL_STACK_DEPTH> texture_stack;
+
+    /**
+     * Constructor. No material, texture, transform or hit.
+     */
+    RayTraversalState();
+
+    /**
+     * Copy the current material onto the stack.
+     */
+    void push_material();
+
+    /**
+     * Revert to the material prior to the last push (or none).
+     */
+    void pop_material();
+
+    /**
+     * Copy the current texture onto the stack.
+     */
+    void push_texture();
+
+    /**
+     * Revert to the texture prior to the last push (or none).
+     */
+    void pop_texture();
+};
+
+/**
+ * Closest intersections of a packet of rays, one entry per lane. Packet
+ * versions of find_closest_intersect fill this in place of a RayTraversalState.
+ */
+struct PacketHit
+{
+    float      t_min[SIMD_WIDTH]; // Closest distance (initialize to the maximum)
+    SceneNode *geometry_node[SIMD_WIDTH];
+    SceneNode *material_node[SIMD_WIDTH];
+    SceneNode *texture_node[SIMD_WIDTH];
+    uint32_t   instance_index[SIMD_WIDTH];
+
+    // Face and barycentric coordinates of each hit (see SurfaceInteraction)
+    uint32_t face_index[SIMD_WIDTH];
+    float    barycentric_u[SIMD_WIDTH];
+    float    barycentric_v[SIMD_WIDTH];
+
+    // World to object and normal matrices of hits on transformed objects
+    // (null for untransformed objects)
+    const Matrix4x4 *inverse_matrix[SIMD_WIDTH];
+    const Matrix4x4 *normal_matrix[SIMD_WIDTH];
+
+    /**
+     * Constructor. No lane has a hit.
+     * @param  t_max  Maximum distance along each ray.
+     */
+    explicit PacketHit(float t_max);
+
+    /**
+     * Get the closest distances as SIMD lanes.
+     */
+    SimdFloat get_t_min() const { return SimdFloat::load(t_min); }
+
+    /**
+     * Record a closer hit in a set of lanes.
+     * @param  lanes          Bit mask of the lanes to update.
+     * @param  t              Distance of the hit in each lane.
+     * @param  geometry       Geometry node that was hit.
+     * @param  current_state  State holding the current material, texture and
+     *                        instance.
+     */
+    void record(uint32_t lanes, const SimdFloat &t, SceneNode *geometry, const RayTraversalState &current_state);
+
+    /**
+     * Record the closest hit of a single ray in one lane.
+     * @param  lane  Lane to update.
+     * @param  hit   Closest intersection found for the ray of that lane.
+     */
+    void record(uint32_t lane, const RayTraversalState &hit);
+};
+
+} // namespace cg
+
+#endif
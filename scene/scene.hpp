@@ -27,6 +27,8 @@
 #include "scene/camera_node.hpp"
 #include "scene/image_data.hpp"
 #include "scene/model_node.hpp"
+#include "scene/texture_cache.hpp"
+#include "scene/asset_loader.hpp"
 #include "scene/view_frustum.hpp"
 // clang-format on
 
@@ -1,8 +1,16 @@
 #include "scene/scene_node.hpp"
 
+#include <atomic>
+
 namespace cg
 {
 
+// Version of the scene graph structure, shared by all nodes
+static std::atomic<uint32_t> s_graph_version(0);
+
+// Version of the transforms within the scene graph
+static std::atomic<uint32_t> s_transform_version(0);
+
 std::ostream &operator<<(std::ostream &out, const SceneNodeType &type)
 {
     switch(type)
@@ -35,9 +43,27 @@ void SceneNode::update(SceneState &scene_state)
     for(auto c : children_) { c->update(scene_state); }
 }
 
-void SceneNode::destroy() { children_.clear(); }
+void SceneNode::destroy()
+{
+    if(!children_.empty()) { graph_changed(); }
+    children_.clear();
+}
+
+void SceneNode::add_child(std::shared_ptr<SceneNode> node)
+{
+    children_.push_back(node);
+    graph_changed();
+}
+
+const std::vector<std::shared_ptr<SceneNode>> &SceneNode::get_children() const { return children_; }
+
+uint32_t SceneNode::get_graph_version() { return s_graph_version.load(std::memory_order_acquire); }
+
+void SceneNode::graph_changed() { s_graph_version.fetch_add(1, std::memory_order_release); }
+
+uint32_t SceneNode::get_transform_version() { return s_transform_version.load(std::memory_order_acquire); }
 
-void SceneNode::add_child(std::shared_ptr<SceneNode> node) { children_.push_back(node); }
+void SceneNode::transform_version_changed() { s_transform_version.fetch_add(1, std::memory_order_release); }
 
 SceneNodeType SceneNode::node_type() const { return node_type_; }
 
@@ -45,13 +71,13 @@ void SceneNode::set_name(const char *nm) { name_ = nm; }
 
 const std::string &SceneNode::get_name() const { return name_; }
 
-void SceneNode::find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest)
+void SceneNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
 {
     // Loop through the list and check intersections with children
     for(auto &child : children_) { child->find_closest_intersect(ray, current_state, closest); }
 }
 
-bool SceneNode::does_intersect_exist(Ray3 ray, float d, SceneState &current_state)
+bool SceneNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
 {
     // Loop through the list and check intersections with children
     for(auto &child : children_)
@@ -14,6 +14,7 @@
 #define __SCENE_SCENE_NODE_HPP__
 
 #include "scene/graphics.hpp"
+#include "scene/ray_traversal_state.hpp"
 #include "scene/scene_state.hpp"
 
 #include <iostream>
@@ -81,6 +82,29 @@ class SceneNode
      */
     void add_child(std::shared_ptr<SceneNode> node);
 
+    /**
+     * Get the children of this node.
+     * @return  Returns the list of child nodes.
+     */
+    const std::vector<std::shared_ptr<SceneNode>> &get_children() const;
+
+    /**
+     * Get the scene graph version. The version changes whenever a child is
+     * added or removed anywhere in the graph, so copies derived from the
+     * graph (e.g. the compiled ray tracing scene) can tell when they must be
+     * rebuilt.
+     * @return  Returns the current graph version.
+     */
+    static uint32_t get_graph_version();
+
+    /**
+     * Get the transform version. The version changes whenever a transform
+     * node is modified. Copies derived from the graph only need to update
+     * their transforms if the graph version is unchanged.
+     * @return  Returns the current transform version.
+     */
+    static uint32_t get_transform_version();
+
     /**
      * Get the type of scene node
      * @return  Returns the type of hte scene node.
@@ -107,7 +131,7 @@ class SceneNode
      * @param  current_state Current state, updated as the scene is traversed
      * @param  closest       Closest object information
      */
-    virtual void find_closest_intersect(Ray3 ray, SceneState &current_state, SceneState &closest);
+    virtual void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest);
 
     /**
      * Intersection method - checks if an object in the scene graph
@@ -119,11 +143,21 @@ class SceneNode
      * @return  Returns true if an intersection is found closer than distance d, false
      *          if no intersections occur.
      */
-    virtual bool does_intersect_exist(Ray3 ray, float d, SceneState &current_state);
+    virtual bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state);
 
     void print_graph(std::ostream &out = std::cout, int32_t level = 0) const;
 
   protected:
+    /**
+     * Mark the scene graph as changed (advances the graph version).
+     */
+    static void graph_changed();
+
+    /**
+     * Mark a transform as changed (advances the transform version).
+     */
+    static void transform_version_changed();
+
     std::string                             name_;
     SceneNodeType                           node_type_;
     std::vector<std::shared_ptr<SceneNode>> children_;
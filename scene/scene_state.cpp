@@ -24,20 +24,4 @@ void SceneState::pop_transforms()
     else model_matrix.set_identity();
 }
 
-void SceneState::push_material() { material_stack.push_back(material_node); }
-
-void SceneState::pop_material()
-{
-    material_stack.pop_back();
-    material_node = (material_stack.size() > 0) ? material_stack.back() : nullptr;
-}
-
-void SceneState::push_texture() { texture_stack.push_back(texture_node); }
-
-void SceneState::pop_texture()
-{
-    texture_stack.pop_back();
-    texture_node = (texture_stack.size() > 0) ? texture_stack.back() : nullptr;
-}
-
 } // namespace cg
@@ -92,21 +92,6 @@ struct SceneState
     // Retained state to push/pop modeling matrix
     std::list<Matrix4x4> model_matrix_stack;
 
-    // Intersection/ray-tracing additions
-    bool                                    transform_required;
-    float                                   t_min;
-    float                                   t_scale;
-    SceneNode                              *material_node;
-    SceneNode                              *geometry_node;
-    SceneNode                              *texture_node;
-    Matrix4x4                               inverse_matrix;
-    std::list<float>                        t_scale_stack;
-    std::list<SceneNode *>                  material_stack;
-    std::list<SceneNode *>                  texture_stack;
-    std::list<Matrix4x4>                    inverse_matrix_stack;
-    std::list<Matrix4x4>                    normal_transform_stack;
-    std::vector<std::shared_ptr<SceneNode>> light_nodes;
-
     /**
      * Initialize scene state prior to drawing.
      */
@@ -122,28 +107,6 @@ struct SceneState
      * (or 0 if none are set at this node)
      */
     void pop_transforms();
-
-    /**
-     * Copy current material onto stack
-     */
-    void push_material();
-
-    /**
-     * Remove the current material from the stack and revert to prior
-     * (or 0 if none are set at this node)
-     */
-    void pop_material();
-
-    /**
-     * Copy current texture onto stack
-     **/
-    void push_texture();
-
-    /**
-     * Remove the current texture from the stack and revert to prior
-     * (or 0 if none are set at this node)
-     **/
-    void pop_texture();
 };
 
 } // namespace cg
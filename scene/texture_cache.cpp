@@ -0,0 +1,210 @@
+#include "scene/texture_cache.hpp"
+
+#include "common/logging.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace cg
+{
+
+namespace
+{
+
+// Images are keyed by resolved path and whether they hold alpha
+using ImageKey = std::pair<std::string, bool>;
+
+// GL textures are keyed by resolved path and wrap modes (s, t). Filters are
+// not part of the key since each user sets its own when binding the texture.
+using GLTextureKey = std::tuple<std::string, GLuint, GLuint>;
+
+// Entries are held weakly so an image is freed once its last user releases it
+struct TextureRegistry
+{
+    std::mutex                                            mutex;
+    std::unordered_map<std::string, std::string>          resolved_paths; // Filename as given to resolved path
+    std::map<ImageKey, std::weak_ptr<CachedImage>>        images;
+    std::map<GLTextureKey, std::weak_ptr<CachedGLTexture>> gl_textures;
+    uint64_t                                              requests = 0;
+    std::atomic<uint64_t>                                 decodes{0}; // Counted without the lock
+};
+
+TextureRegistry &get_registry()
+{
+    static TextureRegistry registry;
+    return registry;
+}
+
+// Resolve a filename to a path that is the same however the file is named.
+// Call with the registry locked. Returns an empty string if not found.
+std::string resolve_path(TextureRegistry &registry, const std::string &filename)
+{
+    auto found = registry.resolved_paths.find(filename);
+    if(found != registry.resolved_paths.end()) { return found->second; }
+
+    std::string path = locate_image_file(filename);
+    if(path.empty()) { return path; }
+
+    std::error_code       error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    if(!error) { path = canonical.string(); }
+    registry.resolved_paths.emplace(filename, path);
+    return path;
+}
+
+} // namespace
+
+CachedImage::CachedImage(const std::string &path, bool include_alpha) : path_(path), include_alpha_(include_alpha) {}
+
+CachedImage::~CachedImage() { free_image_data(image_); }
+
+const ImageData &CachedImage::get_image() const
+{
+    std::call_once(decoded_, [this]() {
+        load_image_file(image_, path_, include_alpha_);
+        ++get_registry().decodes;
+    });
+    return image_;
+}
+
+size_t CachedImage::get_size() const
+{
+    const ImageData &image = get_image();
+    return image.data != nullptr ? static_cast<size_t>(image.w) * image.h * image.channels : 0;
+}
+
+CachedGLTexture::CachedGLTexture(const CachedImage &image, GLuint s_wrap, GLuint t_wrap) :
+    path_(image.get_path()),
+    id_(0),
+    width_(image.get_image().w),
+    height_(image.get_image().h)
+{
+    // Generate an OpenGL textureID, bind it
+    glGenTextures(1, &id_);
+    glBindTexture(GL_TEXTURE_2D, id_);
+
+    // Load image data and generate mipmaps
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.get_image().data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Set wrapping mode
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, s_wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, t_wrap);
+
+    // Set default texture filters (users set their own when binding)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    // Bind null texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+CachedGLTexture::~CachedGLTexture()
+{
+    if(id_ != 0) { glDeleteTextures(1, &id_); }
+}
+
+size_t CachedGLTexture::get_size() const
+{
+    // RGBA texels; the mipmaps add a third of the base level
+    return static_cast<size_t>(width_) * height_ * 4 * 4 / 3;
+}
+
+std::shared_ptr<const CachedImage> acquire_image(const std::string &filename, bool include_alpha)
+{
+    std::shared_ptr<CachedImage> image;
+    {
+        TextureRegistry            &registry = get_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        ++registry.requests;
+
+        std::string path = resolve_path(registry, filename);
+        if(path.empty())
+        {
+            std::cout << "Error getting finding file " << filename << '\n';
+            return nullptr;
+        }
+
+        ImageKey key(path, include_alpha);
+        image = registry.images[key].lock();
+        if(!image)
+        {
+            remove_expired(registry.images);
+            image = std::make_shared<CachedImage>(path, include_alpha);
+            registry.images[key] = image;
+        }
+    }
+
+    // Decode outside the lock so different files decode in parallel
+    if(image->get_image().data == nullptr) { return nullptr; }
+    return image;
+}
+
+std::shared_ptr<const CachedGLTexture> acquire_gl_texture(const std::string &filename, GLuint s_wrap, GLuint t_wrap)
+{
+    // The decoded image is only held until it is uploaded (unless others hold it)
+    std::shared_ptr<const CachedImage> image = acquire_image(filename);
+    if(!image) { return nullptr; }
+
+    TextureRegistry            &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    GLTextureKey                     key(image->get_path(), s_wrap, t_wrap);
+    std::shared_ptr<CachedGLTexture> texture = registry.gl_textures[key].lock();
+    if(!texture)
+    {
+        remove_expired(registry.gl_textures);
+        texture = std::make_shared<CachedGLTexture>(*image, s_wrap, t_wrap);
+        registry.gl_textures[key] = texture;
+    }
+    return texture;
+}
+
+void log_texture_cache_report()
+{
+    TextureRegistry            &registry = get_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    // Use counts exclude the reference taken here to read the entry
+    size_t image_bytes = 0;
+    for(const auto &entry : registry.images)
+    {
+        std::shared_ptr<CachedImage> image = entry.second.lock();
+        if(!image) { continue; }
+        const ImageData &data = image->get_image();
+        image_bytes += image->get_size();
+        log_msg("Texture cache: image %s (%d x %d x %d) %zu bytes, %ld users",
+                image->get_path().c_str(),
+                data.w,
+                data.h,
+                data.channels,
+                image->get_size(),
+                image.use_count() - 1);
+    }
+
+    size_t gl_bytes = 0;
+    for(const auto &entry : registry.gl_textures)
+    {
+        std::shared_ptr<CachedGLTexture> texture = entry.second.lock();
+        if(!texture) { continue; }
+        gl_bytes += texture->get_size();
+        log_msg("Texture cache: GL texture %u %s %zu bytes, %ld users",
+                texture->get_id(),
+                texture->get_path().c_str(),
+                texture->get_size(),
+                texture.use_count() - 1);
+    }
+
+    log_msg("Texture cache: %zu bytes of images, %zu bytes of GL textures, %llu requests, %llu decodes",
+            image_bytes,
+            gl_bytes,
+            static_cast<unsigned long long>(registry.requests),
+            static_cast<unsigned long long>(registry.decodes.load()));
+}
+
+} // namespace cg
@@ -0,0 +1,157 @@
+//============================================================================
+//	Johns Hopkins University Engineering Programs for Professionals
+//	605.667 Computer Graphics and 605.767 Applied Computer Graphics
+//
+//	File:    texture_cache.hpp
+//	Purpose: Process wide registry of texture images keyed by resolved path,
+//           so each file is decoded and uploaded once however many
+//           materials, meshes and ray traced textures use it.
+//============================================================================
+
+#ifndef __SCENE_TEXTURE_CACHE_HPP__
+#define __SCENE_TEXTURE_CACHE_HPP__
+
+#include "scene/graphics.hpp"
+#include "scene/image_data.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace cg
+{
+
+/**
+ * Decoded image shared by every user of a file. The pixel data is freed when
+ * the last user releases it.
+ */
+class CachedImage
+{
+  public:
+    /**
+     * Constructor. The image is not decoded until it is first read.
+     * @param  path           Resolved path of the image file.
+     * @param  include_alpha  Decode as RGBA rather than RGB.
+     */
+    CachedImage(const std::string &path, bool include_alpha);
+
+    CachedImage(const CachedImage &) = delete;
+    CachedImage &operator=(const CachedImage &) = delete;
+
+    ~CachedImage();
+
+    /**
+     * Get the decoded image, decoding it on the first call. Threads reading
+     * the image at the same time wait for that one decode. The data is null
+     * if the file could not be decoded.
+     */
+    const ImageData &get_image() const;
+
+    /**
+     * Get the resolved path of the image file.
+     */
+    const std::string &get_path() const { return path_; }
+
+    /**
+     * Get the size of the decoded pixel data in bytes.
+     */
+    size_t get_size() const;
+
+  private:
+    std::string            path_;
+    bool                   include_alpha_;
+    mutable std::once_flag decoded_;
+    mutable ImageData      image_;
+};
+
+/**
+ * OpenGL texture (with mipmaps) shared by every user of a file with the same
+ * wrap modes. Filters are left to each user to set when it binds the texture.
+ * The texture is deleted when the last user releases it, so it must be
+ * released while the GL context is current.
+ */
+class CachedGLTexture
+{
+  public:
+    /**
+     * Constructor. Uploads the image and generates mipmaps.
+     * @param  image   Image to upload (RGBA).
+     * @param  s_wrap  OpenGL wrap option (s)
+     * @param  t_wrap  OpenGL wrap option (t)
+     */
+    CachedGLTexture(const CachedImage &image, GLuint s_wrap, GLuint t_wrap);
+
+    CachedGLTexture(const CachedGLTexture &) = delete;
+    CachedGLTexture &operator=(const CachedGLTexture &) = delete;
+
+    ~CachedGLTexture();
+
+    /**
+     * Get the OpenGL texture ID.
+     */
+    GLuint get_id() const { return id_; }
+
+    /**
+     * Get the resolved path of the image file.
+     */
+    const std::string &get_path() const { return path_; }
+
+    /**
+     * Get the approximate GPU memory used by the texture and its mipmaps in bytes.
+     */
+    size_t get_size() const;
+
+  private:
+    std::string path_;
+    GLuint      id_;
+    int32_t     width_;
+    int32_t     height_;
+};
+
+/**
+ * Get the decoded image for a file, decoding it only if no one holds it
+ * already. Safe to call from any thread.
+ * @param  filename       Image file (located as by load_image_data).
+ * @param  include_alpha  Decode as RGBA rather than RGB.
+ * @return  Returns the shared image, or null if the file could not be found
+ *          or decoded.
+ */
+std::shared_ptr<const CachedImage> acquire_image(const std::string &filename, bool include_alpha = true);
+
+/**
+ * Get the OpenGL texture for a file, creating it only if no one holds a
+ * texture of that file with the same wrap modes already. Must be called with
+ * the GL context current. The texture filters are shared state, so users set
+ * the filters they want each time they bind it.
+ * @param  filename  Image file (located as by load_image_data).
+ * @param  s_wrap    OpenGL wrap option (s)
+ * @param  t_wrap    OpenGL wrap option (t)
+ * @return  Returns the shared texture, or null if the file could not be found
+ *          or decoded.
+ */
+std::shared_ptr<const CachedGLTexture> acquire_gl_texture(const std::string &filename, GLuint s_wrap, GLuint t_wrap);
+
+/**
+ * Remove the entries of a map of weak pointers whose users have all released
+ * them. Used by registries of shared data to drop stale entries.
+ * @param  entries  Map whose values are std::weak_ptr.
+ */
+template <typename Map> void remove_expired(Map &entries)
+{
+    for(auto entry = entries.begin(); entry != entries.end();)
+    {
+        if(entry->second.expired()) { entry = entries.erase(entry); }
+        else { ++entry; }
+    }
+}
+
+/**
+ * Write the images and GL textures currently held, with their size and
+ * number of users, and the number of requests and decodes so far to the log.
+ */
+void log_texture_cache_report();
+
+} // namespace cg
+
+#endif
@@ -11,19 +11,62 @@ TransformNode::TransformNode()
 
 TransformNode::~TransformNode() {}
 
-void TransformNode::load_identity() { model_matrix_.set_identity(); }
+void TransformNode::load_identity()
+{
+    model_matrix_.set_identity();
+    transform_changed();
+}
 
-void TransformNode::translate(float x, float y, float z) { model_matrix_.translate(x, y, z); }
+void TransformNode::translate(float x, float y, float z)
+{
+    model_matrix_.translate(x, y, z);
+    transform_changed();
+}
 
-void TransformNode::rotate(float deg, Vector3 &v) { model_matrix_.rotate(deg, v.x, v.y, v.z); }
+void TransformNode::rotate(float deg, Vector3 &v)
+{
+    model_matrix_.rotate(deg, v.x, v.y, v.z);
+    transform_changed();
+}
 
-void TransformNode::rotate_x(float deg) { model_matrix_.rotate_x(deg); }
+void TransformNode::rotate_x(float deg)
+{
+    model_matrix_.rotate_x(deg);
+    transform_changed();
+}
+
+void TransformNode::rotate_y(float deg)
+{
+    model_matrix_.rotate_y(deg);
+    transform_changed();
+}
+
+void TransformNode::rotate_z(float deg)
+{
+    model_matrix_.rotate_z(deg);
+    transform_changed();
+}
 
-void TransformNode::rotate_y(float deg) { model_matrix_.rotate_y(deg); }
+void TransformNode::scale(float x, float y, float z)
+{
+    model_matrix_.scale(x, y, z);
+    transform_changed();
+}
 
-void TransformNode::rotate_z(float deg) { model_matrix_.rotate_z(deg); }
+void TransformNode::transform_changed()
+{
+    inverse_matrix_ = model_matrix_.get_inverse();
+    normal_matrix_ = inverse_matrix_.get_transpose();
+    transform_version_changed();
+}
 
-void TransformNode::scale(float x, float y, float z) { model_matrix_.scale(x, y, z); }
+Ray3 TransformNode::to_local(const Ray3 &ray, float &scale) const
+{
+    Ray3 local = inverse_matrix_ * ray;
+    scale = local.d.norm();
+    local.d.normalize();
+    return local;
+}
 
 void TransformNode::draw(SceneState &scene_state)
 {
@@ -54,4 +97,43 @@ void TransformNode::draw(SceneState &scene_state)
 
 void TransformNode::update(SceneState &scene_state) {}
 
+void TransformNode::find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest)
+{
+    // Save the parent's transform here rather than in the traversal state, so
+    // the state does not carry a stack of matrices
+    const bool      parent_transform_required = current_state.transform_required;
+    const float     parent_t_scale = current_state.t_scale;
+    const Matrix4x4 parent_inverse_matrix = current_state.inverse_matrix;
+    const Matrix4x4 parent_normal_matrix = current_state.normal_matrix;
+
+    // Compose this transform with the current one. World to object is this
+    // inverse times the parent's; the normal matrix is its transpose.
+    current_state.inverse_matrix = inverse_matrix_ * current_state.inverse_matrix;
+    current_state.normal_matrix = current_state.normal_matrix * normal_matrix_;
+    current_state.transform_required = true;
+
+    // Intersect the children in their own space, with the closest distance
+    // converted to that space and back
+    float scale;
+    Ray3  local = to_local(ray, scale);
+    current_state.t_scale *= scale;
+    float t_parent = closest.t_min;
+    float t_local = t_parent * scale;
+    closest.t_min = t_local;
+    SceneNode::find_closest_intersect(local, current_state, closest);
+    closest.t_min = (closest.t_min < t_local) ? closest.t_min / scale : t_parent;
+
+    current_state.transform_required = parent_transform_required;
+    current_state.t_scale = parent_t_scale;
+    current_state.inverse_matrix = parent_inverse_matrix;
+    current_state.normal_matrix = parent_normal_matrix;
+}
+
+bool TransformNode::does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state)
+{
+    float scale;
+    Ray3  local = to_local(ray, scale);
+    return SceneNode::does_intersect_exist(local, d * scale, current_state);
+}
+
 } // namespace cg
@@ -21,7 +21,8 @@ namespace cg
 
 /**
  * Transform node. Applies a transformation. This class allows OpenGL style
- * transforms applied to the scene graph.
+ * transforms applied to the scene graph. For ray tracing, rays are moved
+ * into the space of the children using a cached inverse of the transform.
  */
 class TransformNode : public SceneNode
 {
@@ -82,6 +83,24 @@ class TransformNode : public SceneNode
      */
     void scale(float x, float y, float z);
 
+    /**
+     * Get the local modeling transformation.
+     * @return  Returns the matrix applied to the children of this node.
+     */
+    const Matrix4x4 &get_matrix() const { return model_matrix_; }
+
+    /**
+     * Get the inverse of the local modeling transformation (cached).
+     * @return  Returns the matrix taking points into the space of the children.
+     */
+    const Matrix4x4 &get_inverse_matrix() const { return inverse_matrix_; }
+
+    /**
+     * Get the normal transformation (transpose of the inverse, cached).
+     * @return  Returns the matrix taking normals of the children to this space.
+     */
+    const Matrix4x4 &get_normal_matrix() const { return normal_matrix_; }
+
     /**
      * Draw this transformation node and its children
      * @param  scene_state   Current scene state
@@ -94,8 +113,40 @@ class TransformNode : public SceneNode
      */
     void update(SceneState &scene_state) override;
 
+    /**
+     * Ray tracing intersect method. Transforms the ray into the space of the
+     * children and composes this transform into the current state so hits
+     * can be mapped back to world space.
+     * @param  ray            Ray in the space of this node's parent.
+     * @param  current_state  Current traversal state.
+     * @param  closest        Closest intersection. t_min is in the space of
+     *                        this node's parent.
+     */
+    void find_closest_intersect(Ray3 ray, RayTraversalState &current_state, RayTraversalState &closest) override;
+
+    /**
+     * Ray tracing intersect method - checks if an intersection exists within
+     * distance d (measured in the space of this node's parent).
+     */
+    bool does_intersect_exist(Ray3 ray, float d, RayTraversalState &current_state) override;
+
   protected:
-    Matrix4x4 model_matrix_; // Local modeling transformation
+    Matrix4x4 model_matrix_;   // Local modeling transformation
+    Matrix4x4 inverse_matrix_; // Inverse of the local transformation
+    Matrix4x4 normal_matrix_;  // Transpose of the inverse
+
+    /**
+     * Update the cached inverse and normal matrices after a change and
+     * advance the transform version.
+     */
+    void transform_changed();
+
+    /**
+     * Move a ray into the space of the children. The direction is
+     * renormalized, so distances along the new ray are scale times distances
+     * along the original.
+     */
+    Ray3 to_local(const Ray3 &ray, float &scale) const;
 };
 
 } // namespace cg